@@ -0,0 +1,58 @@
+#!/bin/sh
+
+PATH=/bin:/usr/bin
+WORKDIR=/tmp/benchmark.$LOGNAME
+SCC=`pwd`/phase6/scc
+RUNS=5
+
+die() {
+    rm -rf $WORKDIR
+    exit 1
+}
+
+trap die 2
+
+if [ $# -lt 1 ] || [ $# -gt 2 ]; then
+    echo "$0 examples-directory [runs]" 1>&2
+    exit 1
+fi
+
+test -n "$2" && RUNS=$2
+EXAMPLES=`cd $1 && pwd` || exit 1
+
+rm -rf $WORKDIR && mkdir -m 700 $WORKDIR || die
+
+echo "Compiling project ..."
+(cd phase6 && make) >/dev/null || die
+
+# Print the average time in milliseconds of running the given command
+# $RUNS times, or "failed" if its output does not match the expected output.
+
+measure() {
+    START=`date +%s%N`
+    COUNT=0
+
+    while [ $COUNT -lt $RUNS ]; do
+	sh -c "$1" < $BASE.in > $WORKDIR/$BASE.out 2>/dev/null
+	cmp -s $WORKDIR/$BASE.out $BASE.out || { echo failed; return; }
+	COUNT=`expr $COUNT + 1`
+    done
+
+    echo `expr \( \`date +%s%N\` - $START \) / $RUNS / 1000000`ms
+}
+
+echo "Running examples ..."
+printf "%-12s %10s %10s %10s\n" example native -O0 interpret
+(cd $EXAMPLES && for FILE in *.c; do
+    BASE=`basename $FILE .c`
+    test -r $BASE.in && test -r $BASE.out || continue
+    NATIVE="$SCC < $FILE > $WORKDIR/$BASE.s &&
+	gcc -m32 -o $WORKDIR/a.out $WORKDIR/$BASE.s && $WORKDIR/a.out"
+    printf "%-12s %10s %10s %10s\n" $BASE "`measure "$NATIVE"`" \
+	"`measure "$SCC -O0 < $FILE > $WORKDIR/$BASE.s &&
+	    gcc -m32 -o $WORKDIR/a.out $WORKDIR/$BASE.s && $WORKDIR/a.out"`" \
+	"`measure "$SCC --interpret $FILE"`"
+done)
+
+rm -rf $WORKDIR
+exit 0
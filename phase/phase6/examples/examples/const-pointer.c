@@ -0,0 +1,42 @@
+/* const-pointer.c */
+
+const int k = 3;
+const int squares[5] = {0, 1, 4, 9, 16};
+int *p;
+const int *q;
+
+int *address(void)
+{
+    return &k;
+}
+
+int store(int *x)
+{
+    *x = 4;
+    return 0;
+}
+
+int load(const int *x)
+{
+    return *x;
+}
+
+int main(void)
+{
+    const int m = 5;
+    int n;
+
+    p = &k;
+    p = &m;
+    p = squares;
+    store(&squares[2]);
+
+    q = &k;
+    q = squares;
+    n = load(&k) + load(squares);
+    p = q;
+
+    *q = 4;
+    q[1] = 2;
+    p = (int *) q;
+}
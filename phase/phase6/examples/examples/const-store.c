@@ -0,0 +1,17 @@
+/* const-store.c */
+
+const int size = 5;
+const int squares[5] = {0, 1, 4, 9, 16};
+const double scale = 2.5;
+
+int main(void)
+{
+    const int k = 3;
+    const char c = 'c';
+
+    size = 3;
+    squares[1] = 2;
+    scale = scale * 2;
+    k = k + 1;
+    c = 'd';
+}
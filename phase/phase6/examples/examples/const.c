@@ -0,0 +1,72 @@
+/* const.c */
+
+int printf(char *s, ...), scanf(char *s, ...);
+
+const int size = 5;
+const int squares[5] = {0, 1, 4, 9, 16};
+const double scale = 2.5;
+const char letter = 'q';
+const int negative = -7;
+
+int h[3] = {1, 2};
+int counter = 100;
+double ratio = -0.5;
+char *greeting = "hello";
+char name[8] = "const";
+char *words[3] = {"zero", "one", "two"};
+static const int base = 10;
+
+
+/*
+ * sum the table of squares, which is read from memory only once
+ */
+
+int total(void)
+{
+    int i, sum;
+
+    sum = 0;
+    i = 0;
+
+    while (i < size) {
+	sum = sum + squares[i];
+	i = i + 1;
+    }
+
+    return sum;
+}
+
+
+/*
+ * use a const local computed from the argument
+ */
+
+int twice(int n)
+{
+    const int k = n * 2;
+    int m = k + 1;
+
+    counter = counter + k;
+    return m * base;
+}
+
+
+int main(void)
+{
+    int n;
+
+    scanf("%d", &n);
+
+    printf("total %d\n", total());
+    printf("twice %d\n", twice(n));
+    printf("counter %d\n", counter);
+    printf("h %d %d %d\n", h[0], h[1], h[2]);
+    printf("ratio %f scale %f\n", ratio, scale * n);
+    printf("%s %s %c%c\n", greeting, name, letter, name[1]);
+    printf("%s %s %s\n", words[0], words[1], words[2]);
+    printf("negative %d\n", negative * squares[n % size]);
+
+    h[2] = squares[4] + h[0];
+    counter = h[2] - counter;
+    printf("h %d counter %d\n", h[2], counter);
+}
@@ -0,0 +1,125 @@
+/* static.c */
+
+int printf(char *s, ...), scanf(char *s, ...);
+
+static int calls;
+static int table[10];
+
+
+/*
+ * add two integers, which are both passed in registers
+ */
+
+static int add(int a, int b)
+{
+    calls = calls + 1;
+    return a + b;
+}
+
+
+/*
+ * combine five digits, so that the last two are passed on the stack
+ */
+
+static int digits(int a, int b, int c, int d, int e)
+{
+    calls = calls + 1;
+    return a * 10000 + b * 1000 + c * 100 + d * 10 + e;
+}
+
+
+/*
+ * find the greatest common divisor with a self tail call
+ */
+
+static int gcd(int a, int b)
+{
+    calls = calls + 1;
+
+    if (b == 0)
+	return a;
+
+    return gcd(b, a % b);
+}
+
+
+/*
+ * sum an array with a self tail call that passes a pointer in a register
+ */
+
+static int sum(int *p, int n, int total)
+{
+    if (n == 0)
+	return total;
+
+    return sum(p + 1, n - 1, total + *p);
+}
+
+
+/*
+ * return the nth fibonacci number, whose argument must survive a call
+ */
+
+static int fib(int n)
+{
+    if (n < 2)
+	return n;
+
+    return fib(n - 1) + fib(n - 2);
+}
+
+
+/*
+ * scale a double, so that only the first argument is passed in a register
+ */
+
+static double scale(int n, double x, int m)
+{
+    return n * x + m;
+}
+
+
+/*
+ * take a double first, so that every argument is passed on the stack
+ */
+
+static double offset(double x, int n)
+{
+    return x - n;
+}
+
+
+/*
+ * take a character, which stops the arguments passed in registers
+ */
+
+static int shift(int n, char c, int m)
+{
+    return n * 256 + c - m;
+}
+
+
+int main(void)
+{
+    int i, n;
+
+    scanf("%d", &n);
+
+    i = 0;
+
+    while (i < 10) {
+	table[i] = i * n;
+	i = i + 1;
+    }
+
+    printf("add %d\n", add(n, 7));
+    printf("nested %d\n", add(add(1, n), digits(1, 2, 3, 4, n % 10)));
+    printf("digits %d\n", digits(n % 10, 9, 8, 7, 6));
+    printf("gcd %d\n", gcd(n * 84, 360));
+    printf("sum %d\n", sum(table, 10, 0));
+    printf("fib %d\n", fib(n));
+    printf("scale %f\n", scale(n, 2.5, 3));
+    printf("offset %f\n", offset(10.25, n));
+    printf("shift %d\n", shift(n, 'A', 1));
+    printf("calls %d\n", calls);
+}
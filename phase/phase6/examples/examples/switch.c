@@ -0,0 +1,140 @@
+/* switch.c */
+
+int printf(char *s, ...), scanf(char *s, ...);
+
+/*
+ * classify a digit, falling through from the odd digits to the even ones
+ */
+
+int digit(int n)
+{
+    int odd;
+
+    odd = 0;
+
+    switch (n) {
+    case 1: case 3: case 5: case 7: case 9:
+	odd = 1;
+
+    case 0: case 2: case 4: case 6: case 8:
+	printf("digit %d odd %d\n", n, odd);
+	break;
+
+    default:
+	printf("%d is not a digit\n", n);
+    }
+
+    return odd;
+}
+
+
+/*
+ * compare against a few values, with the default case placed first
+ */
+
+int sign(int n)
+{
+    int s;
+
+    switch (n) {
+    default:
+	s = 1;
+	break;
+
+    case -1:
+	s = -1;
+	break;
+
+    case 0:
+	s = 0;
+    }
+
+    if (s == 1 && n < 0)
+	s = -1;
+
+    return s;
+}
+
+
+/*
+ * search sparse values, with the default case placed in the middle
+ */
+
+int rank(int n)
+{
+    int r;
+
+    r = 0;
+
+    switch (n) {
+    case -1000: r = 1; break;
+    case 7: r = 2; break;
+    case 64: r = 3; break;
+    case 500: r = 4; break;
+    default: r = -1; break;
+    case 4096: r = 5; break;
+    case 65536: r = 6; break;
+    case 1000000: r = 7; break;
+    case 2000000000: r = 8; break;
+    }
+
+    return r;
+}
+
+
+/*
+ * classify a value using labels that are constant expressions
+ */
+
+int kind(int n)
+{
+    switch (n) {
+    case 2 + 3:
+	return 1;
+
+    case 'z' - 'a':
+	return 2;
+
+    case -2147483647 - 1:
+	return 3;
+
+    case 2 * 3 * 7:
+	return 4;
+    }
+
+    return 0;
+}
+
+
+/*
+ * read numbers until a negative one that is not ranked, using break both
+ * to leave the switch and to leave the loop
+ */
+
+int main(void)
+{
+    int n, odds, ranks;
+
+    odds = 0;
+    ranks = 0;
+
+    while (scanf("%d", &n) == 1) {
+	switch (rank(n)) {
+	case -1:
+	    odds = odds + digit(n);
+	    printf("%d has sign %d\n", n, sign(n));
+	    break;
+
+	default:
+	    ranks = ranks + rank(n);
+	    printf("%d has rank %d\n", n, rank(n));
+	}
+
+	if (rank(n) < 0 && sign(n) < 0)
+	    break;
+    }
+
+    printf("odds %d ranks %d\n", odds, ranks);
+    printf("kinds %d %d %d", kind(5), kind(25), kind(-2147483647 - 1));
+    printf(" %d %d\n", kind(42), kind(n));
+}
@@ -3,12 +3,17 @@
  *
  * Description:	This file contains the class definition for symbols in
  *		Simple C.  At this point, a symbol merely consists of a
- *		name and a type, neither of which you can change.
+ *		name and a type, neither of which you can change.  A symbol
+ *		declared static has internal linkage and is not visible to
+ *		other translation units.  A global variable may have an
+ *		initializer, which is a list of literals, and so may a
+ *		local variable that is const.
  */
 
 # ifndef SYMBOL_H
 # define SYMBOL_H
 # include <string>
+# include <vector>
 # include "Type.h"
 
 class Symbol {
@@ -18,6 +23,9 @@ class Symbol {
 
 public:
     int offset;
+    string reg;
+    bool internal;
+    std::vector<class Expression *> initializer;
 
     Symbol(const string &name, const Type &type);
     const string &name() const;
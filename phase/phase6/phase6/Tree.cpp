@@ -31,11 +31,12 @@ using namespace std;
  * Function:	Expression::Expression (constructor)
  *
  * Description:	Initialize the expression object to not be an lvalue and to
- *		have the specified type.
+ *		have the specified type.  Its value is kept in our own frame
+ *		until the generator decides otherwise.
  */
 
 Expression::Expression(const Type &type)
-    : _type(type), _lvalue(false), offset(0)
+    : _type(type), _lvalue(false), offset(0), outgoing(false)
 {
 }
 
@@ -77,6 +78,30 @@ Binary::Binary(Expression *left, Expression *right, const Type &type)
 }
 
 
+/*
+ * Function:	Binary::left (accessor)
+ *
+ * Description:	Return the left operand of this binary expression.
+ */
+
+Expression *&Binary::left()
+{
+    return _left;
+}
+
+
+/*
+ * Function:	Binary::right (accessor)
+ *
+ * Description:	Return the right operand of this binary expression.
+ */
+
+Expression *&Binary::right()
+{
+    return _right;
+}
+
+
 /*
  * Function:	Unary::Unary (constructor)
  *
@@ -90,6 +115,18 @@ Unary::Unary(Expression *expr, const Type &type)
 }
 
 
+/*
+ * Function:	Unary::expr (accessor)
+ *
+ * Description:	Return the operand of this unary expression.
+ */
+
+Expression *&Unary::expr()
+{
+    return _expr;
+}
+
+
 /*
  * Function:	String::String (constructor)
  *
@@ -223,12 +260,37 @@ const string &Real::value() const
 /*
  * Function:	Call::Call (constructor)
  *
- * Description:	Initialize a function call expression.
+ * Description:	Initialize a function call expression, which is not a tail
+ *		call and whose value is used until we find otherwise.
  */
 
 Call::Call(const Symbol *id, const Expressions &args, const Type &type)
-    : Expression(type), _id(id), _args(args)
+    : Expression(type), _id(id), _args(args), tail(false), discard(false)
+{
+}
+
+
+/*
+ * Function:	Call::id (accessor)
+ *
+ * Description:	Return the symbol of the function being called.
+ */
+
+const Symbol *Call::id() const
 {
+    return _id;
+}
+
+
+/*
+ * Function:	Call::args (accessor)
+ *
+ * Description:	Return the arguments of this function call.
+ */
+
+Expressions &Call::args()
+{
+    return _args;
 }
 
 
@@ -476,6 +538,31 @@ LogicalOr::LogicalOr(Expression *left, Expression *right, const Type &type)
 }
 
 
+/*
+ * Function:	Common::Common (constructor)
+ *
+ * Description:	Initialize a common subexpression that refers to the given
+ *		earlier expression.
+ */
+
+Common::Common(Expression *expr)
+    : Expression(expr->type()), _expr(expr)
+{
+}
+
+
+/*
+ * Function:	Common::expr (accessor)
+ *
+ * Description:	Return the earlier expression of this common subexpression.
+ */
+
+Expression *Common::expr() const
+{
+    return _expr;
+}
+
+
 /*
  * Function:	Assignment::Assignment (constructor)
  *
@@ -488,6 +575,30 @@ Assignment::Assignment(Expression *left, Expression *right)
 }
 
 
+/*
+ * Function:	Assignment::left (accessor)
+ *
+ * Description:	Return the left-hand side of this assignment.
+ */
+
+Expression *&Assignment::left()
+{
+    return _left;
+}
+
+
+/*
+ * Function:	Assignment::right (accessor)
+ *
+ * Description:	Return the right-hand side of this assignment.
+ */
+
+Expression *&Assignment::right()
+{
+    return _right;
+}
+
+
 /*
  * Function:	Break::Break (constructor)
  *
@@ -511,6 +622,18 @@ Return::Return(Expression *expr)
 }
 
 
+/*
+ * Function:	Return::expr (accessor)
+ *
+ * Description:	Return the expression of this return statement.
+ */
+
+Expression *&Return::expr()
+{
+    return _expr;
+}
+
+
 /*
  * Function:	Block::Block (constructor)
  *
@@ -535,27 +658,113 @@ Scope *Block::declarations() const
 }
 
 
+/*
+ * Function:	Block::statements (accessor)
+ *
+ * Description:	Return the statements of this block.
+ */
+
+Statements &Block::statements()
+{
+    return _stmts;
+}
+
+
 /*
  * Function:	While::While (constructor)
  *
- * Description:	Initialize a while statement.
+ * Description:	Initialize a while statement, which is not vectorized
+ *		until we find otherwise.
  */
 
 While::While(Expression *expr, Statement *stmt)
-    : _expr(expr), _stmt(stmt)
+    : _expr(expr), _stmt(stmt), simd(nullptr)
+{
+}
+
+
+/*
+ * Function:	While::expr (accessor)
+ *
+ * Description:	Return the test expression of this while statement.
+ */
+
+Expression *&While::expr()
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	While::stmt (accessor)
+ *
+ * Description:	Return the body of this while statement.
+ */
+
+Statement *&While::stmt()
 {
+    return _stmt;
 }
 
 
 /*
  * Function:	For::For (constructor)
  *
- * Description:	Initialize a for statement.
+ * Description:	Initialize a for statement, which is not vectorized until
+ *		we find otherwise.
  */
 
 For::For(Statement *init, Expression *expr, Statement *incr, Statement *stmt)
-    : _init(init), _expr(expr), _incr(incr), _stmt(stmt)
+    : _init(init), _expr(expr), _incr(incr), _stmt(stmt), simd(nullptr)
+{
+}
+
+
+/*
+ * Function:	For::init (accessor)
+ *
+ * Description:	Return the initialization of this for statement.
+ */
+
+Statement *&For::init()
+{
+    return _init;
+}
+
+
+/*
+ * Function:	For::expr (accessor)
+ *
+ * Description:	Return the test expression of this for statement.
+ */
+
+Expression *&For::expr()
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	For::incr (accessor)
+ *
+ * Description:	Return the increment of this for statement.
+ */
+
+Statement *&For::incr()
 {
+    return _incr;
+}
+
+
+/*
+ * Function:	For::stmt (accessor)
+ *
+ * Description:	Return the body of this for statement.
+ */
+
+Statement *&For::stmt()
+{
+    return _stmt;
 }
 
 
@@ -571,6 +780,81 @@ If::If(Expression *expr, Statement *thenStmt, Statement *elseStmt)
 }
 
 
+/*
+ * Function:	If::expr (accessor)
+ *
+ * Description:	Return the test expression of this if statement.
+ */
+
+Expression *&If::expr()
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	If::thenStmt (accessor)
+ *
+ * Description:	Return the then statement of this if statement.
+ */
+
+Statement *&If::thenStmt()
+{
+    return _thenStmt;
+}
+
+
+/*
+ * Function:	If::elseStmt (accessor)
+ *
+ * Description:	Return the else statement of this if statement, which
+ *		may be a null pointer.
+ */
+
+Statement *&If::elseStmt()
+{
+    return _elseStmt;
+}
+
+
+/*
+ * Function:	Switch::Switch (constructor)
+ *
+ * Description:	Initialize a switch statement.
+ */
+
+Switch::Switch(Expression *expr, const Cases &cases)
+    : _expr(expr), _cases(cases)
+{
+}
+
+
+/*
+ * Function:	Switch::expr (accessor)
+ *
+ * Description:	Return the expression of this switch statement.
+ */
+
+Expression *&Switch::expr()
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	Switch::cases (accessor)
+ *
+ * Description:	Return the sections of this switch statement, in the order
+ *		in which they appear, since control falls through from one
+ *		to the next.
+ */
+
+Cases &Switch::cases()
+{
+    return _cases;
+}
+
+
 /*
  * Function:	Function::Function (constructor)
  *
@@ -581,3 +865,27 @@ Function::Function(const Symbol *id, Block *body)
     : _id(id), _body(body)
 {
 }
+
+
+/*
+ * Function:	Function::id (accessor)
+ *
+ * Description:	Return the symbol of this function.
+ */
+
+const Symbol *Function::id() const
+{
+    return _id;
+}
+
+
+/*
+ * Function:	Function::body (accessor)
+ *
+ * Description:	Return the body of this function.
+ */
+
+Block *Function::body() const
+{
+    return _body;
+}
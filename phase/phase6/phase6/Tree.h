@@ -22,6 +22,26 @@
  *		allocator.cpp - member functions to do storage allocation
  *		generator.cpp - member functions to do code generation
  *		writer.cpp - member functions to write the tree to a stream
+ *		copier.cpp - member functions to copy the tree
+ *		optimizer.cpp - functions to analyze and transform the tree
+ *		inliner.cpp - functions to inline function calls
+ *		unroller.cpp - functions to unroll counted loops
+ *		reducer.cpp - functions to do strength reduction in loops
+ *		eliminator.cpp - functions to remove dead and unreachable code
+ *		jumper.cpp - functions to find calls in tail position
+ *		numberer.cpp - functions to do local value numbering
+ *		vectorizer.cpp - functions to vectorize loops using SSE2
+ *		promoter.cpp - functions to promote variables to registers
+ *		aliaser.cpp - functions to decide if loads and stores may alias
+ *		profiler.cpp - functions to instrument and read profiles
+ *		propagator.cpp - functions to propagate constants across calls
+ *		folder.cpp - functions to fold loads of constant objects
+ *		evaluator.cpp - functions to do conditional constant propagation
+ *		placer.cpp - functions to eliminate partial redundancies
+ *		predictor.cpp - functions to predict the direction of branches
+ *		assembler.cpp - functions to assemble code into an object
+ *		runner.cpp - functions to run an object in memory
+ *		interpreter.cpp - functions to interpret the tree as bytecode
  */
 
 # ifndef TREE_H
@@ -57,7 +77,12 @@ public:
 
 class Statement : public Node {
 protected:
-    Statement() {}
+    Statement() : counter(-1) {}
+
+public:
+    int counter;
+
+    virtual Statement *clone() const = 0;
 };
 
 
@@ -71,9 +96,11 @@ protected:
 
 public:
     int offset;
+    bool outgoing;
     const Type &type() const;
     bool lvalue() const;
     virtual void operand(ostream &ostr) const;
+    virtual Expression *clone() const = 0;
 	virtual void test(const Label &label, bool ifTrue);
 	virtual Expression* isDereference();
 	//virtual void generate();
@@ -86,6 +113,10 @@ class Binary : public Expression {
 protected:
     Expression *_left, *_right;
     Binary(Expression *left, Expression *right, const Type &type);
+
+public:
+    Expression *&left();
+    Expression *&right();
 };
 
 
@@ -95,6 +126,9 @@ class Unary : public Expression {
 protected:
     Expression *_expr;
     Unary(Expression *expr, const Type &type);
+
+public:
+    Expression *&expr();
 };
 
 
@@ -107,9 +141,8 @@ public:
     String(const string &value);
     string &value();
     virtual void write(ostream &ostr) const;  
-	virtual void generate();
-
-
+    virtual Expression *clone() const;
+    virtual void operand(ostream &ostr) const;
 };
 
 
@@ -122,6 +155,7 @@ public:
     Identifier(const Symbol *symbol);
     const Symbol *symbol() const;
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void operand(ostream &ostr) const;
 };
 
@@ -136,6 +170,7 @@ public:
     Integer(const string &value);
     const string &value() const;
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void operand(ostream &ostr) const;
 	//virtual void generate();
 };
@@ -151,7 +186,8 @@ public:
     Real(const string &value);
     const string &value() const;
     virtual void write(ostream &ostr) const;
-	virtual void generate();
+    virtual Expression *clone() const;
+    virtual void operand(ostream &ostr) const;
 };
 
 
@@ -162,8 +198,13 @@ class Call : public Expression {
     Expressions _args;
 
 public:
+    bool tail, discard;
+
     Call(const Symbol *id, const Expressions &args, const Type &type);
+    const Symbol *id() const;
+    Expressions &args();
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void generate();
 };
 
@@ -174,6 +215,7 @@ class Not : public Unary {
 public:
     Not(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -186,6 +228,7 @@ class Negate : public Unary {
 public:
     Negate(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -198,6 +241,7 @@ class Dereference : public Unary {
 public:
     Dereference(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 	virtual Expression* isDereference();
 
@@ -210,6 +254,7 @@ class Address : public Unary {
 public:
     Address(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -224,6 +269,7 @@ public:
 
     Increment(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -238,6 +284,7 @@ public:
 
     Decrement(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -251,6 +298,7 @@ public:
     Cast(const Type &type, Expression *expr);
     //Cast(Expression *expr, const
 	virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 	//const Type getType();
 
@@ -264,6 +312,7 @@ class Multiply : public Binary {
 public:
     Multiply(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -276,6 +325,7 @@ class Divide : public Binary {
 public:
     Divide(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -288,6 +338,7 @@ class Remainder : public Binary {
 public:
     Remainder(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -302,6 +353,7 @@ public:
 
     Add(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -316,6 +368,7 @@ public:
 
     Subtract(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -328,6 +381,7 @@ class LessThan : public Binary {
 public:
     LessThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -340,6 +394,7 @@ class GreaterThan : public Binary {
 public:
     GreaterThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -352,6 +407,7 @@ class LessOrEqual : public Binary {
 public:
     LessOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -364,6 +420,7 @@ class GreaterOrEqual : public Binary {
 public:
     GreaterOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -376,6 +433,7 @@ class Equal : public Binary {
 public:
     Equal(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -388,6 +446,7 @@ class NotEqual : public Binary {
 public:
     NotEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -400,6 +459,7 @@ class LogicalAnd: public Binary {
 public:
     LogicalAnd(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;  
+    virtual Expression *clone() const;
 	virtual void generate();
 
 
@@ -412,6 +472,7 @@ class LogicalOr : public Binary {
 public:
     LogicalOr(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
    
 	virtual void generate();
 
@@ -419,6 +480,24 @@ public:
 };
 
 
+/*
+ * A common subexpression: a reference to an earlier expression in the
+ * same basic block that computes the same value.  No code is generated;
+ * the operand is simply that of the earlier expression.
+ */
+
+class Common : public Expression {
+    Expression *_expr;
+
+public:
+    Common(Expression *expr);
+    Expression *expr() const;
+    virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual void operand(ostream &ostr) const;
+};
+
+
 /* An assignment statement: left = right */
 
 class Assignment : public Statement {
@@ -426,7 +505,10 @@ class Assignment : public Statement {
 
 public:
     Assignment(Expression *left, Expression *right);
+    Expression *&left();
+    Expression *&right();
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
     virtual void generate();
 
 };
@@ -438,6 +520,7 @@ class Break : public Statement {
 public:
     Break();
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
 	virtual void generate();
 };
 
@@ -449,7 +532,9 @@ class Return : public Statement {
 
 public:
     Return(Expression *expr);
+    Expression *&expr();
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
 	virtual void generate();
 };
 
@@ -463,7 +548,9 @@ class Block : public Statement {
 public:
     Block(Scope *decls, const Statements &stmts);
     Scope *declarations() const;
+    Statements &statements();
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
     virtual void allocate(int &offset) const;
     virtual void generate();
 };
@@ -476,8 +563,13 @@ class While : public Statement {
     Statement *_stmt;
 
 public:
+    struct Simd *simd;
+
     While(Expression *expr, Statement *stmt);
+    Expression *&expr();
+    Statement *&stmt();
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
     virtual void allocate(int &offset) const;  
 	virtual void generate();
 
@@ -494,8 +586,15 @@ class For : public Statement {
     Statement *_stmt;
 
 public:
+    struct Simd *simd;
+
     For(Statement *init, Expression *expr, Statement *incr, Statement *stmt);
+    Statement *&init();
+    Expression *&expr();
+    Statement *&incr();
+    Statement *&stmt();
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
     virtual void allocate(int &offset) const;  
 	virtual void generate();
 
@@ -511,7 +610,11 @@ class If : public Statement {
 
 public:
     If(Expression *expr, Statement *thenStmt, Statement *elseStmt);
+    Expression *&expr();
+    Statement *&thenStmt();
+    Statement *&elseStmt();
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
     virtual void allocate(int &offset) const;  
 	virtual void generate();
 
@@ -519,6 +622,34 @@ public:
 };
 
 
+/* A section of a switch statement: case values : stmt, or default : stmt */
+
+struct Case {
+    std::vector<int> values;
+    bool isDefault;
+    Statement *stmt;
+};
+
+typedef std::vector<Case> Cases;
+
+
+/* A switch statement: switch ( expr ) { cases } */
+
+class Switch : public Statement {
+    Expression *_expr;
+    Cases _cases;
+
+public:
+    Switch(Expression *expr, const Cases &cases);
+    Expression *&expr();
+    Cases &cases();
+    virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual void allocate(int &offset) const;
+    virtual void generate();
+};
+
+
 /* A function definition: id() { body } */
 
 class Function : public Node {
@@ -527,6 +658,8 @@ class Function : public Node {
 
 public:
     Function(const Symbol *id, Block *body);
+    const Symbol *id() const;
+    Block *body() const;
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
     virtual void generate();
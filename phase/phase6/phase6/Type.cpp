@@ -33,7 +33,7 @@ using namespace std;
  */
 
 Type::Type()
-    : _declarator(ERROR)
+    : _declarator(ERROR), _constant(false)
 {
 }
 
@@ -45,7 +45,7 @@ Type::Type()
  */
 
 Type::Type(int specifier, unsigned indirection)
-    : _specifier(specifier), _indirection(indirection)
+    : _specifier(specifier), _constant(false), _indirection(indirection)
 {
     _declarator = SCALAR;
 }
@@ -58,7 +58,8 @@ Type::Type(int specifier, unsigned indirection)
  */
 
 Type::Type(int specifier, unsigned indirection, unsigned length)
-    : _specifier(specifier), _indirection(indirection), _length(length)
+    : _specifier(specifier), _constant(false), _indirection(indirection),
+      _length(length)
 {
     _declarator = ARRAY;
 }
@@ -71,7 +72,8 @@ Type::Type(int specifier, unsigned indirection, unsigned length)
  */
 
 Type::Type(int specifier, unsigned indirection, Parameters *parameters)
-    : _specifier(specifier), _indirection(indirection), _parameters(parameters)
+    : _specifier(specifier), _constant(false), _indirection(indirection),
+      _parameters(parameters)
 {
     _declarator = FUNCTION;
 }
@@ -174,6 +176,32 @@ bool Type::isError() const
 }
 
 
+/*
+ * Function:	Type::isConst
+ *
+ * Description:	Return whether an object of this type is const, which is
+ *		when the specifier is qualified and there is no indirection.
+ */
+
+bool Type::isConst() const
+{
+    return _constant && _indirection == 0 && _declarator != FUNCTION;
+}
+
+
+/*
+ * Function:	Type::isQualified
+ *
+ * Description:	Return whether the specifier of this type is qualified as
+ *		const.  For a pointer type, the object pointed to is const.
+ */
+
+bool Type::isQualified() const
+{
+    return _constant;
+}
+
+
 /*
  * Function:	Type::specifier (accessor)
  *
@@ -312,18 +340,24 @@ bool Type::isCompatibleWith(const Type &that) const
  *
  * Description:	Return the result of performing type promotion on this
  *		type.  In Simple C, a character is promoted to an integer,
- *		and an array is promoted to a pointer.
+ *		and an array is promoted to a pointer.  The qualifier is
+ *		kept, so that a const array becomes a pointer to const.
  */
 
 Type Type::promote() const
 {
+    Type type = *this;
+
+
     if (_declarator == SCALAR && _indirection == 0 && _specifier == CHAR)
 	return Type(INT, 0);
 
-    if (_declarator == ARRAY)
-	return Type(_specifier, _indirection + 1);
+    if (_declarator == ARRAY) {
+	type._declarator = SCALAR;
+	type._indirection ++;
+    }
 
-    return *this;
+    return type;
 }
 
 
@@ -331,13 +365,34 @@ Type Type::promote() const
  * Function:	Type::deref
  *
  * Description:	Return the result of dereferencing this type, which must be
- *		a pointer type.
+ *		a pointer type.  The qualifier is kept, so that a pointer
+ *		to const yields a const object.
  */
 
 Type Type::deref() const
 {
+    Type type = *this;
+
+
     assert(_declarator == SCALAR && _indirection > 0);
-    return Type(_specifier, _indirection - 1);
+    type._indirection --;
+    return type;
+}
+
+
+/*
+ * Function:	Type::qualify
+ *
+ * Description:	Return this type qualified as const.
+ */
+
+Type Type::qualify() const
+{
+    Type type = *this;
+
+
+    type._constant = true;
+    return type;
 }
 
 
@@ -357,6 +412,9 @@ ostream &operator <<(ostream &ostr, const Type &type)
 	ostr << "error";
 
     else {
+	if (type.isQualified())
+	    ostr << "const ";
+
 	if (type.specifier() == CHAR)
 	    ostr << "char";
 	else if (type.specifier() == INT)
@@ -9,6 +9,13 @@
  *		An error type is also supported for use in undeclared
  *		identifiers and the results of type checking.
  *
+ *		The specifier of a type may also be qualified as const.
+ *		An object is then const if there is no indirection, and
+ *		otherwise a pointer points to a const object.  The
+ *		qualifier only matters when storing to an object or
+ *		converting a pointer, so it is ignored when comparing
+ *		types.
+ *
  *		No subclassing is used to avoid the problem of object
  *		slicing (since we'll be treating types as value types) and
  *		the proliferation of small member functions.
@@ -32,6 +39,7 @@ class Type {
     enum {ARRAY, ERROR, FUNCTION, SCALAR};
 
     short _declarator, _specifier;
+    bool _constant;
     unsigned _indirection;
     unsigned _length;
     Parameters *_parameters;
@@ -49,6 +57,8 @@ public:
     bool isScalar() const;
     bool isFunction() const;
     bool isError() const;
+    bool isConst() const;
+    bool isQualified() const;
 
     int specifier() const;
     unsigned indirection() const;
@@ -64,6 +74,7 @@ public:
 
     Type promote() const;
     Type deref() const;
+    Type qualify() const;
 
     unsigned size() const;
 };
@@ -0,0 +1,194 @@
+/*
+ * File:	aliaser.cpp
+ *
+ * Description:	This file contains the function definitions for deciding
+ *		whether two memory references in Simple C may refer to the
+ *		same object, which the passes use to keep a value across a
+ *		store without assuming that the store changes everything.
+ *
+ *		A reference is either a variable or a load through a
+ *		pointer.  Two variables are the same object only if they
+ *		are the same symbol.  A pointer can only refer to a
+ *		variable that is global or whose address is taken, so a
+ *		local variable whose address is never taken is never
+ *		changed through a pointer.  A pointer into an array whose
+ *		address is computed directly from its name can only refer
+ *		to that array, so references into two different arrays are
+ *		different objects.
+ *
+ *		Finally, an object is only ever accessed using its own type,
+ *		so a store of an integer cannot change a double or a
+ *		pointer.  The exception is a character, which may be used to
+ *		access the bytes of any object.  A const object is never
+ *		changed at all.
+ */
+
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+
+/*
+ * Function:	base (private)
+ *
+ * Description:	Return the array into which the given pointer points, if
+ *		the pointer is computed from the address of a variable by
+ *		adding and subtracting integers, and a null pointer
+ *		otherwise.
+ */
+
+static const Symbol *base(Expression *expr)
+{
+    Binary *binary;
+
+
+    expr = strip(expr);
+
+    if (dynamic_cast<Address *>(expr) != nullptr)
+	return identifier(strip(((Unary *) expr)->expr()));
+
+    if (dynamic_cast<Add *>(expr) != nullptr ||
+	    dynamic_cast<Subtract *>(expr) != nullptr) {
+	binary = (Binary *) expr;
+
+	if (binary->left()->type().isPointer())
+	    if (!binary->right()->type().isPointer())
+		return base(binary->left());
+
+	if (binary->right()->type().isPointer())
+	    if (!binary->left()->type().isPointer())
+		return base(binary->right());
+    }
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	compatible (private)
+ *
+ * Description:	Return whether objects of the two given types may overlap.
+ */
+
+static bool compatible(const Type &left, const Type &right)
+{
+    if (left == Type(CHAR) || right == Type(CHAR))
+	return true;
+
+    return left == right;
+}
+
+
+/*
+ * Function:	constant (private)
+ *
+ * Description:	Return whether the given reference is to a const object,
+ *		either a const variable or an element of a const array.
+ */
+
+static bool constant(Expression *expr)
+{
+    const Symbol *symbol;
+
+
+    if ((symbol = identifier(expr)) == nullptr)
+	symbol = base(((Unary *) expr)->expr());
+
+    return symbol != nullptr && symbol->type().isConst();
+}
+
+
+/*
+ * Function:	aliases
+ *
+ * Description:	Return whether the two given references may refer to the
+ *		same object.  The local variables whose address is never
+ *		taken are given.
+ */
+
+bool aliases(Expression *left, Expression *right, const SymbolSet &privates)
+{
+    const Symbol *symbol, *x, *y;
+    Expression *pointer;
+
+
+    left = strip(left);
+    right = strip(right);
+
+    if (identifier(left) != nullptr && identifier(right) != nullptr)
+	return identifier(left) == identifier(right);
+
+    if (constant(left) || constant(right))
+	return false;
+
+    if (!compatible(left->type(), right->type()))
+	return false;
+
+    if ((symbol = identifier(left)) != nullptr)
+	pointer = ((Unary *) right)->expr();
+    else if ((symbol = identifier(right)) != nullptr)
+	pointer = ((Unary *) left)->expr();
+    else
+	pointer = nullptr;
+
+    if (symbol != nullptr) {
+	if (privates.count(symbol) > 0)
+	    return false;
+
+	return base(pointer) == nullptr || base(pointer) == symbol;
+    }
+
+    x = base(((Unary *) left)->expr());
+    y = base(((Unary *) right)->expr());
+    return x == nullptr || y == nullptr || x == y;
+}
+
+
+/*
+ * Function:	clobbers
+ *
+ * Description:	Return whether a store to the given reference may change
+ *		the value of the given expression, by changing any variable
+ *		that it reads or any object that it loads through a pointer.
+ *		The operand of an address expression is not read, and a
+ *		call that is not pure may read any object but our own
+ *		private variables.
+ */
+
+bool clobbers(Expression *target, Expression *expr, const SymbolSet &privates)
+{
+    vector<Expression **> operands;
+    Expression *operand;
+
+
+    expr = strip(expr);
+
+    if (identifier(expr) != nullptr)
+	return aliases(target, expr, privates);
+
+    if (dynamic_cast<Address *>(expr) != nullptr) {
+	operand = strip(((Unary *) expr)->expr());
+
+	if (identifier(operand) != nullptr)
+	    return false;
+
+	return clobbers(target, ((Unary *) operand)->expr(), privates);
+    }
+
+    if (dynamic_cast<Dereference *>(expr) != nullptr)
+	if (aliases(target, expr, privates))
+	    return true;
+
+    if (dynamic_cast<Call *>(expr) != nullptr && !isPure(((Call *) expr)->id()))
+	if (privates.count(identifier(target)) == 0)
+	    return true;
+
+    children(expr, operands);
+
+    for (auto slot : operands)
+	if (clobbers(target, *slot, privates))
+	    return true;
+
+    return false;
+}
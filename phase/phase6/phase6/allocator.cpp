@@ -13,6 +13,7 @@
 # include <cassert>
 # include <iostream>
 # include "checker.h"
+# include "generator.h"
 # include "machine.h"
 # include "tokens.h"
 # include "Tree.h"
@@ -58,7 +59,8 @@ unsigned Type::size() const
  *		then for all symbols declared within any nested block.
  *		Only symbols that have not already been allocated an
  *		offset will be assigned one, since the parameters are
- *		already assigned special offsets.
+ *		already assigned special offsets.  A symbol that lives in
+ *		a register needs no offset at all.
  */
 
 void Block::allocate(int &offset) const
@@ -71,7 +73,7 @@ void Block::allocate(int &offset) const
     symbols = _decls->symbols();
 
     for (i = 0; i < symbols.size(); i ++)
-	if (symbols[i]->offset == 0) {
+	if (symbols[i]->offset == 0 && symbols[i]->reg.empty()) {
 	    offset -= symbols[i]->type().size();
 	    symbols[i]->offset = offset;
 	}
@@ -138,12 +140,36 @@ void If::allocate(int &offset) const
 }
 
 
+/*
+ * Function:	Switch::allocate
+ *
+ * Description:	Allocate storage for this switch statement, which
+ *		essentially means allocating storage for variables declared
+ *		as part of its sections.
+ */
+
+void Switch::allocate(int &offset) const
+{
+    int saved, temp;
+
+
+    saved = offset;
+
+    for (auto &section : _cases) {
+	temp = saved;
+	section.stmt->allocate(temp);
+	offset = min(offset, temp);
+    }
+}
+
+
 /*
  * Function:	Function::allocate
  *
  * Description:	Allocate storage for this function and return the number of
  *		bytes required.  The parameters are allocated offsets as
- *		well, starting with the given offset.
+ *		well, starting with the given offset.  A parameter passed in
+ *		a register is instead allocated along with the locals.
  */
 
 void Function::allocate(int &offset) const
@@ -156,6 +182,9 @@ void Function::allocate(int &offset) const
     symbols = _body->declarations()->symbols();
 
     for (unsigned i = 0; i < params->types.size(); i ++) {
+	if (i < registerArguments(_id))
+	    continue;
+
 	symbols[i]->offset = offset;
 	offset += params->types[i].promote().size();
     }
@@ -0,0 +1,1537 @@
+/*
+ * File:	assembler.cpp
+ *
+ * Description:	This file contains the function definitions for the
+ *		integrated assembler for Simple C, which turns the assembly
+ *		code written by the generator into an ELF relocatable
+ *		object without running a separate assembler.
+ *
+ *		Only the instructions and directives that the generator
+ *		writes are understood.  Every instruction is given its
+ *		final size as soon as it is read: a jump or call always has
+ *		a 32-bit displacement, and an operand involving a symbol
+ *		always has a 32-bit field.  The value of a symbol is then
+ *		never needed to encode an instruction, so a single pass
+ *		suffices, after which the fields referring to symbols are
+ *		fixed up.  A relative field referring to a label in the
+ *		same section is resolved directly, and any other field
+ *		referring to a label is relocated against the section of
+ *		the label.  A field referring to an undefined or common
+ *		symbol is relocated against the symbol itself.  As usual
+ *		for the i386, the addend of a relocation is stored in the
+ *		field.  The constants defined by .set, such as the frame
+ *		sizes of functions, are simply substituted.
+ *
+ *		The symbol table of the object contains the labels other
+ *		than the local labels that the generator makes up, so that
+ *		it has the same symbols as an object written by the system
+ *		assembler.
+ */
+
+# include <cctype>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include <set>
+# include <sstream>
+# include "assembler.h"
+# include "machine.h"
+
+using namespace std;
+
+enum { REGISTER, IMMEDIATE, MEMORY };
+enum { EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI };
+
+enum {
+    SHT_PROGBITS = 1, SHT_SYMTAB = 2, SHT_STRTAB = 3, SHT_NOBITS = 8,
+    SHT_REL = 9, SHT_FINI_ARRAY = 15
+};
+
+enum {
+    STB_GLOBAL = 0x10, STT_OBJECT = 1, STT_SECTION = 3,
+    ET_REL = 1, EM_386 = 3, EV_CURRENT = 1, R_386_32 = 1, R_386_PC32 = 2,
+    SHF_INFO_LINK = 0x40, SHN_COMMON = 0xfff2
+};
+
+
+/* A constant, or a symbol plus a constant */
+
+struct Value {
+    string symbol;
+    long long addend;
+};
+
+
+/* An operand of an instruction, where the value is the immediate or the
+   displacement of a memory reference */
+
+struct Operand {
+    int kind, reg, size;
+    int base, index, scale;
+    bool indirect;
+    Value value;
+};
+
+
+/* A field referring to a symbol, which is filled in at the end */
+
+struct Fixup {
+    int section;
+    unsigned offset;
+    Value value;
+    bool relative;
+};
+
+
+/* The encoding of a vector instruction, whose store form is zero if the
+   destination must be a register */
+
+struct Vector {
+    unsigned prefix, load, store;
+};
+
+static const string registers[] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"
+};
+
+static const string bytes[] = {
+    "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh"
+};
+
+static const string conditions[] = {
+    "o", "no", "b", "ae", "e", "ne", "be", "a",
+    "s", "ns", "p", "np", "l", "ge", "le", "g"
+};
+
+static map<string, unsigned> arithmetic = {
+    {"addl", 0}, {"orl", 1}, {"adcl", 2}, {"sbbl", 3},
+    {"andl", 4}, {"subl", 5}, {"xorl", 6}, {"cmpl", 7}
+};
+
+static map<string, unsigned> shifts = {
+    {"roll", 0}, {"rorl", 1}, {"shll", 4}, {"sall", 4},
+    {"shrl", 5}, {"sarl", 7}
+};
+
+static map<string, unsigned> unary = {
+    {"notl", 2}, {"negl", 3}, {"mull", 4}, {"imull", 5},
+    {"divl", 6}, {"idivl", 7}
+};
+
+static map<string, unsigned> simple = {
+    {"ret", 0xc3}, {"leave", 0xc9}, {"cltd", 0x99}, {"cdq", 0x99},
+    {"sahf", 0x9e}, {"nop", 0x90}, {"fld1", 0xd9e8}, {"fldz", 0xd9ee},
+    {"fchs", 0xd9e0}, {"fabs", 0xd9e1}, {"ftst", 0xd9e4},
+    {"fcompp", 0xded9}, {"fucompp", 0xdae9}
+};
+
+static map<string, pair<unsigned, unsigned>> floats = {
+    {"flds", {0xd9, 0}}, {"fsts", {0xd9, 2}}, {"fstps", {0xd9, 3}},
+    {"fldl", {0xdd, 0}}, {"fstl", {0xdd, 2}}, {"fstpl", {0xdd, 3}},
+    {"fildl", {0xdb, 0}}, {"fisttpl", {0xdb, 1}}, {"fistl", {0xdb, 2}},
+    {"fistpl", {0xdb, 3}}, {"fild", {0xdf, 0}}, {"filds", {0xdf, 0}},
+    {"fildll", {0xdf, 5}}, {"faddl", {0xdc, 0}}, {"fmull", {0xdc, 1}},
+    {"fcoml", {0xdc, 2}}, {"fcompl", {0xdc, 3}}, {"fsubl", {0xdc, 4}},
+    {"fsubrl", {0xdc, 5}}, {"fdivl", {0xdc, 6}}, {"fdivrl", {0xdc, 7}}
+};
+
+static map<string, unsigned> popping = {
+    {"faddp", 0xc0}, {"fmulp", 0xc8}, {"fsubrp", 0xe0},
+    {"fsubp", 0xe8}, {"fdivrp", 0xf0}, {"fdivp", 0xf8}
+};
+
+static map<string, Vector> vectors = {
+    {"movdqu", {0xf3, 0x6f, 0x7f}}, {"movdqa", {0x66, 0x6f, 0x7f}},
+    {"movupd", {0x66, 0x10, 0x11}}, {"movapd", {0x66, 0x28, 0x29}},
+    {"movsd", {0xf2, 0x10, 0x11}}, {"addpd", {0x66, 0x58, 0}},
+    {"mulpd", {0x66, 0x59, 0}}, {"subpd", {0x66, 0x5c, 0}},
+    {"divpd", {0x66, 0x5e, 0}}, {"unpcklpd", {0x66, 0x14, 0}},
+    {"paddd", {0x66, 0xfe, 0}}, {"psubd", {0x66, 0xfa, 0}},
+    {"pxor", {0x66, 0xef, 0}}
+};
+
+static Object *object;
+static int current;
+static vector<Fixup> fixups;
+static map<string, long long> constants;
+static set<string> globals;
+static string line;
+
+
+/*
+ * Function:	error (private)
+ *
+ * Description:	Report that the current line cannot be assembled and exit.
+ *		The generator should never write such a line.
+ */
+
+static void error(const string &message)
+{
+    cerr << "cannot assemble \"" << line << "\": " << message << endl;
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	trim (private)
+ *
+ * Description:	Return a copy of the given string without any leading or
+ *		trailing white space.
+ */
+
+static string trim(const string &s)
+{
+    size_t first = s.find_first_not_of(" \t\r");
+
+
+    if (first == string::npos)
+	return "";
+
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+
+/*
+ * Function:	split (private)
+ *
+ * Description:	Split the given string at each comma that is outside of
+ *		parentheses and quotes.
+ */
+
+static vector<string> split(const string &s)
+{
+    vector<string> result;
+    unsigned depth = 0, start = 0;
+    bool quoted = false;
+
+
+    if (trim(s).empty())
+	return result;
+
+    for (unsigned i = 0; i < s.size(); i ++)
+	if (quoted) {
+	    if (s[i] == '\\')
+		i ++;
+	    else if (s[i] == '"')
+		quoted = false;
+
+	} else if (s[i] == '"')
+	    quoted = true;
+	else if (s[i] == '(')
+	    depth ++;
+	else if (s[i] == ')')
+	    depth --;
+	else if (s[i] == ',' && depth == 0) {
+	    result.push_back(trim(s.substr(start, i - start)));
+	    start = i + 1;
+	}
+
+    result.push_back(trim(s.substr(start)));
+    return result;
+}
+
+
+/*
+ * Function:	symbolic (private)
+ *
+ * Description:	Return whether the given character may appear in a symbol,
+ *		at its start if so indicated.
+ */
+
+static bool symbolic(char c, bool start)
+{
+    return isalpha(c) || c == '_' || c == '.' || (!start && isdigit(c));
+}
+
+
+/*
+ * Function:	evaluate (private)
+ *
+ * Description:	Return the value of the given expression, which is a sum
+ *		of numbers and at most one symbol.
+ */
+
+static Value evaluate(const string &s)
+{
+    Value result;
+    bool negative;
+    unsigned long long number;
+    unsigned i, j;
+    string digits;
+    char *end;
+
+
+    result.addend = 0;
+    negative = false;
+
+    for (i = 0; i < s.size(); i = j) {
+	if (s[i] == ' ' || s[i] == '+' || s[i] == '-') {
+	    negative = s[i] == '-' ? !negative : negative;
+	    j = i + 1;
+	    continue;
+	}
+
+	if (isdigit(s[i])) {
+	    for (j = i; j < s.size() && isalnum(s[j]); j ++)
+		continue;
+
+	    digits = s.substr(i, j - i);
+	    number = strtoull(digits.c_str(), &end, 0);
+
+	    if (*end != '\0')
+		error("invalid number");
+
+	    result.addend += negative ? -number : number;
+
+	} else if (symbolic(s[i], true)) {
+	    for (j = i; j < s.size() && symbolic(s[j], false); j ++)
+		continue;
+
+	    if (!result.symbol.empty() || negative)
+		error("invalid expression");
+
+	    result.symbol = s.substr(i, j - i);
+
+	} else
+	    error("invalid expression");
+
+	negative = false;
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	lookup (private)
+ *
+ * Description:	Look up the given register and fill in its number and size
+ *		in the given operand.  The size of an x87 register is that
+ *		of a double.
+ */
+
+static void lookup(const string &name, Operand &op)
+{
+    op.kind = REGISTER;
+
+    for (int i = 0; i < 8; i ++)
+	if (name == registers[i]) {
+	    op.reg = i;
+	    op.size = 4;
+	    return;
+
+	} else if (name == bytes[i]) {
+	    op.reg = i;
+	    op.size = 1;
+	    return;
+	}
+
+    if (name == "ax") {
+	op.reg = 0;
+	op.size = 2;
+
+    } else if (name == "st") {
+	op.reg = 0;
+	op.size = 8;
+
+    } else if (name.compare(0, 3, "st(") == 0 && name.size() == 5) {
+	op.reg = name[3] - '0';
+	op.size = 8;
+
+    } else if (name.compare(0, 3, "xmm") == 0 && name.size() == 4) {
+	op.reg = name[3] - '0';
+	op.size = 16;
+
+    } else
+	error("unknown register");
+}
+
+
+/*
+ * Function:	parse (private)
+ *
+ * Description:	Parse the given operand of an instruction.
+ */
+
+static Operand parse(string s)
+{
+    vector<string> parts;
+    Operand result;
+    Operand reg;
+    size_t paren;
+
+
+    result.kind = MEMORY;
+    result.reg = result.base = result.index = -1;
+    result.size = 0;
+    result.scale = 1;
+    result.indirect = false;
+    result.value.addend = 0;
+
+    if (!s.empty() && s[0] == '*') {
+	result.indirect = true;
+	s = s.substr(1);
+    }
+
+    if (!s.empty() && s[0] == '$') {
+	result.kind = IMMEDIATE;
+	result.value = evaluate(s.substr(1));
+
+    } else if (!s.empty() && s[0] == '%')
+	lookup(s.substr(1), result);
+
+    else {
+	paren = s.find('(');
+	result.value = evaluate(s.substr(0, paren));
+
+	if (paren != string::npos) {
+	    parts = split(s.substr(paren + 1, s.find(')') - paren - 1));
+
+	    if (!parts[0].empty()) {
+		lookup(parts[0].substr(1), reg);
+		result.base = reg.reg;
+	    }
+
+	    if (parts.size() > 1) {
+		lookup(parts[1].substr(1), reg);
+		result.index = reg.reg;
+	    }
+
+	    if (parts.size() > 2)
+		result.scale = atoi(parts[2].c_str());
+	}
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Append the given value to the current section, using the
+ *		given number of bytes.
+ */
+
+static void emit(unsigned long long value, unsigned size = 1)
+{
+    for (unsigned i = 0; i < size; i ++)
+	object->sections[current].bytes += (char) (i < 8 ? value >> 8 * i : 0);
+}
+
+
+/*
+ * Function:	field (private)
+ *
+ * Description:	Append a 32-bit field with the given value to the current
+ *		section, to be fixed up later if it refers to a symbol.
+ */
+
+static void field(const Value &value, bool relative = false)
+{
+    Fixup fixup;
+
+
+    if (value.symbol.empty() && !relative) {
+	emit(value.addend, 4);
+	return;
+    }
+
+    fixup.section = current;
+    fixup.offset = object->sections[current].bytes.size();
+    fixup.value = value;
+    fixup.relative = relative;
+
+    fixups.push_back(fixup);
+    emit(0, 4);
+}
+
+
+/*
+ * Function:	small (private)
+ *
+ * Description:	Return whether the given value fits in a signed byte.
+ */
+
+static bool small(const Value &value)
+{
+    return value.symbol.empty() && value.addend >= -128 && value.addend < 128;
+}
+
+
+/*
+ * Function:	modrm (private)
+ *
+ * Description:	Append the ModR/M byte with the given register field and
+ *		the given register or memory operand, followed by any SIB
+ *		byte and displacement.  A displacement involving a symbol
+ *		always has 32 bits.
+ */
+
+static void modrm(unsigned reg, const Operand &rm)
+{
+    unsigned mod;
+
+
+    if (rm.kind == REGISTER) {
+	emit(0xc0 | reg << 3 | rm.reg);
+	return;
+    }
+
+    if (rm.kind != MEMORY)
+	error("invalid operand");
+
+    if (rm.base < 0 && rm.index < 0) {
+	emit(0x05 | reg << 3);
+	field(rm.value);
+	return;
+    }
+
+    if (rm.base < 0 || (small(rm.value) && rm.value.addend == 0 &&
+	    rm.base != EBP))
+	mod = 0;
+    else if (small(rm.value))
+	mod = 1;
+    else
+	mod = 2;
+
+    if (rm.index < 0 && rm.base != ESP)
+	emit(mod << 6 | reg << 3 | rm.base);
+    else {
+	emit(mod << 6 | reg << 3 | 4);
+	emit((rm.scale == 8 ? 3 : rm.scale == 4 ? 2 : rm.scale == 2 ? 1 : 0)
+	    << 6 | (rm.index < 0 ? ESP : rm.index) << 3
+	    | (rm.base < 0 ? EBP : rm.base));
+    }
+
+    if (rm.base < 0 || mod == 2)
+	field(rm.value);
+    else if (mod == 1)
+	emit(rm.value.addend);
+}
+
+
+/*
+ * Function:	immediate (private)
+ *
+ * Description:	Append an instruction with the given short and long
+ *		opcodes for an immediate operand, using the short one and a
+ *		byte if the immediate fits.
+ */
+
+static void immediate(unsigned shortcode, unsigned longcode, unsigned reg,
+    const Operand &rm, const Value &value)
+{
+    if (small(value)) {
+	emit(shortcode);
+	modrm(reg, rm);
+	emit(value.addend);
+    } else {
+	emit(longcode);
+	modrm(reg, rm);
+	field(value);
+    }
+}
+
+
+/*
+ * Function:	condition (private)
+ *
+ * Description:	Return the number of the condition that follows the given
+ *		prefix of the given mnemonic, or a negative number if there
+ *		is none.
+ */
+
+static int condition(const string &name, const string &prefix)
+{
+    if (name.compare(0, prefix.size(), prefix) != 0)
+	return -1;
+
+    for (int i = 0; i < 16; i ++)
+	if (name.substr(prefix.size()) == conditions[i])
+	    return i;
+
+    return -1;
+}
+
+
+/*
+ * Function:	encodeInteger (private)
+ *
+ * Description:	Encode an integer instruction, returning whether the
+ *		mnemonic is one.
+ */
+
+static bool encodeInteger(const string &name, vector<Operand> &ops)
+{
+    unsigned n = ops.size();
+
+
+    if (arithmetic.count(name) > 0 && n == 2) {
+	if (ops[0].kind == IMMEDIATE)
+	    immediate(0x83, 0x81, arithmetic[name], ops[1], ops[0].value);
+	else if (ops[0].kind == REGISTER) {
+	    emit(arithmetic[name] << 3 | 0x01);
+	    modrm(ops[0].reg, ops[1]);
+	} else {
+	    emit(arithmetic[name] << 3 | 0x03);
+	    modrm(ops[1].reg, ops[0]);
+	}
+
+    } else if (name == "imull" && n > 1) {
+	if (ops[0].kind == IMMEDIATE)
+	    immediate(0x6b, 0x69, ops[n - 1].reg, ops[1], ops[0].value);
+	else {
+	    emit(0x0f);
+	    emit(0xaf);
+	    modrm(ops[1].reg, ops[0]);
+	}
+
+    } else if (unary.count(name) > 0 && n == 1) {
+	emit(0xf7);
+	modrm(unary[name], ops[0]);
+
+    } else if (shifts.count(name) > 0) {
+	if (n == 1 || (ops[0].kind == IMMEDIATE && ops[0].value.addend == 1
+		&& ops[0].value.symbol.empty())) {
+	    emit(0xd1);
+	    modrm(shifts[name], ops[n - 1]);
+	} else if (ops[0].kind == REGISTER) {
+	    emit(0xd3);
+	    modrm(shifts[name], ops[1]);
+	} else {
+	    emit(0xc1);
+	    modrm(shifts[name], ops[1]);
+	    emit(ops[0].value.addend);
+	}
+
+    } else if ((name == "incl" || name == "decl") && n == 1) {
+	if (ops[0].kind == REGISTER)
+	    emit((name == "incl" ? 0x40 : 0x48) + ops[0].reg);
+	else {
+	    emit(0xff);
+	    modrm(name == "incl" ? 0 : 1, ops[0]);
+	}
+
+    } else if (name == "testl" && n == 2) {
+	if (ops[0].kind == IMMEDIATE) {
+	    emit(0xf7);
+	    modrm(0, ops[1]);
+	    field(ops[0].value);
+	} else if (ops[0].kind == REGISTER) {
+	    emit(0x85);
+	    modrm(ops[0].reg, ops[1]);
+	} else {
+	    emit(0x85);
+	    modrm(ops[1].reg, ops[0]);
+	}
+
+    } else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	encodeMove (private)
+ *
+ * Description:	Encode a move or stack instruction, returning whether the
+ *		mnemonic is one.
+ */
+
+static bool encodeMove(const string &name, vector<Operand> &ops)
+{
+    unsigned n = ops.size();
+    bool byte = name == "movb";
+
+
+    if ((name == "movl" || byte) && n == 2) {
+	if (ops[0].kind == IMMEDIATE) {
+	    if (ops[1].kind == REGISTER)
+		emit((byte ? 0xb0 : 0xb8) + ops[1].reg);
+	    else {
+		emit(byte ? 0xc6 : 0xc7);
+		modrm(0, ops[1]);
+	    }
+
+	    if (byte)
+		emit(ops[0].value.addend);
+	    else
+		field(ops[0].value);
+
+	} else if (ops[0].kind == REGISTER) {
+	    emit(byte ? 0x88 : 0x89);
+	    modrm(ops[0].reg, ops[1]);
+	} else {
+	    emit(byte ? 0x8a : 0x8b);
+	    modrm(ops[1].reg, ops[0]);
+	}
+
+    } else if ((name == "movzbl" || name == "movsbl" || name == "movzwl"
+	    || name == "movswl") && n == 2) {
+	emit(0x0f);
+	emit(name == "movzbl" ? 0xb6 : name == "movsbl" ? 0xbe
+	    : name == "movzwl" ? 0xb7 : 0xbf);
+	modrm(ops[1].reg, ops[0]);
+
+    } else if (name == "leal" && n == 2 && ops[0].kind == MEMORY) {
+	emit(0x8d);
+	modrm(ops[1].reg, ops[0]);
+
+    } else if (name == "pushl" && n == 1) {
+	if (ops[0].kind == REGISTER)
+	    emit(0x50 + ops[0].reg);
+	else if (ops[0].kind == IMMEDIATE && small(ops[0].value)) {
+	    emit(0x6a);
+	    emit(ops[0].value.addend);
+	} else if (ops[0].kind == IMMEDIATE) {
+	    emit(0x68);
+	    field(ops[0].value);
+	} else {
+	    emit(0xff);
+	    modrm(6, ops[0]);
+	}
+
+    } else if (name == "popl" && n == 1) {
+	if (ops[0].kind == REGISTER)
+	    emit(0x58 + ops[0].reg);
+	else {
+	    emit(0x8f);
+	    modrm(0, ops[0]);
+	}
+
+    } else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	encodeControl (private)
+ *
+ * Description:	Encode a jump, call, or conditional set, returning whether
+ *		the mnemonic is one.  A direct jump or call always has a
+ *		32-bit displacement.
+ */
+
+static bool encodeControl(const string &name, vector<Operand> &ops)
+{
+    int cc;
+
+
+    if (ops.size() != 1)
+	return false;
+
+    if (name == "call" || name == "jmp") {
+	if (ops[0].indirect) {
+	    emit(0xff);
+	    modrm(name == "call" ? 2 : 4, ops[0]);
+	} else {
+	    emit(name == "call" ? 0xe8 : 0xe9);
+	    field(ops[0].value, true);
+	}
+
+    } else if ((cc = condition(name, "j")) >= 0) {
+	emit(0x0f);
+	emit(0x80 + cc);
+	field(ops[0].value, true);
+
+    } else if ((cc = condition(name, "set")) >= 0) {
+	emit(0x0f);
+	emit(0x90 + cc);
+	modrm(0, ops[0]);
+
+    } else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	encodeFloat (private)
+ *
+ * Description:	Encode an x87 instruction with operands, returning whether
+ *		the mnemonic is one.  As with the system assembler, a
+ *		commutative popping instruction may name its operands in
+ *		either order.
+ */
+
+static bool encodeFloat(const string &name, vector<Operand> &ops)
+{
+    unsigned n = ops.size();
+
+
+    if (floats.count(name) > 0 && n == 1 && ops[0].kind == MEMORY) {
+	emit(floats[name].first);
+	modrm(floats[name].second, ops[0]);
+
+    } else if (popping.count(name) > 0 && n <= 2) {
+	emit(0xde);
+
+	if (n == 0)
+	    emit(popping[name] + 1);
+	else if (n == 2 && ops[0].reg == 0 && ops[1].size == 8)
+	    emit(popping[name] + ops[1].reg);
+	else if (n == 2 && ops[1].reg == 0 && ops[0].size == 8 &&
+		(name == "faddp" || name == "fmulp"))
+	    emit(popping[name] + ops[0].reg);
+	else
+	    error("invalid operands");
+
+    } else if ((name == "fstp" || name == "fld") && n == 1 &&
+	    ops[0].kind == REGISTER && ops[0].size == 8) {
+	emit(name == "fstp" ? 0xdd : 0xd9);
+	emit((name == "fstp" ? 0xd8 : 0xc0) + ops[0].reg);
+
+    } else if (name == "fnstsw" && n == 1 && ops[0].kind == REGISTER) {
+	emit(0xdf);
+	emit(0xe0);
+
+    } else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	encodeVector (private)
+ *
+ * Description:	Encode an SSE instruction, returning whether the mnemonic
+ *		is one.
+ */
+
+static bool encodeVector(const string &name, vector<Operand> &ops)
+{
+    unsigned n = ops.size();
+    Vector code;
+
+
+    if (vectors.count(name) > 0 && n == 2) {
+	code = vectors[name];
+	emit(code.prefix);
+	emit(0x0f);
+
+	if (ops[1].kind == REGISTER && ops[1].size == 16) {
+	    emit(code.load);
+	    modrm(ops[1].reg, ops[0]);
+	} else if (code.store != 0) {
+	    emit(code.store);
+	    modrm(ops[0].reg, ops[1]);
+	} else
+	    error("invalid operands");
+
+    } else if (name == "movd" && n == 2) {
+	emit(0x66);
+	emit(0x0f);
+
+	if (ops[1].kind == REGISTER && ops[1].size == 16) {
+	    emit(0x6e);
+	    modrm(ops[1].reg, ops[0]);
+	} else {
+	    emit(0x7e);
+	    modrm(ops[0].reg, ops[1]);
+	}
+
+    } else if (name == "pshufd" && n == 3) {
+	emit(0x66);
+	emit(0x0f);
+	emit(0x70);
+	modrm(ops[2].reg, ops[1]);
+	emit(ops[0].value.addend);
+
+    } else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	instruction (private)
+ *
+ * Description:	Encode the given instruction into the current section.
+ */
+
+static void instruction(const string &name, const string &operands)
+{
+    vector<Operand> ops;
+    unsigned code;
+
+
+    for (auto &s : split(operands))
+	ops.push_back(parse(s));
+
+    if (simple.count(name) > 0 && ops.empty()) {
+	code = simple[name];
+
+	if (code > 0xff)
+	    emit(code >> 8);
+
+	emit(code & 0xff);
+
+    } else if (!encodeInteger(name, ops) && !encodeMove(name, ops) &&
+	    !encodeControl(name, ops) && !encodeFloat(name, ops) &&
+	    !encodeVector(name, ops))
+	error("unknown instruction");
+}
+
+
+/*
+ * Function:	select (private)
+ *
+ * Description:	Make the named section the current one, creating it with
+ *		the given type and flags if necessary.
+ */
+
+static void select(const string &name, unsigned type, unsigned flags,
+    unsigned entsize = 0)
+{
+    Section section;
+
+
+    for (unsigned i = 0; i < object->sections.size(); i ++)
+	if (object->sections[i].name == name) {
+	    current = i;
+	    return;
+	}
+
+    section.name = name;
+    section.type = type;
+    section.flags = flags;
+    section.align = 1;
+    section.entsize = entsize;
+
+    object->sections.push_back(section);
+    current = object->sections.size() - 1;
+}
+
+
+/*
+ * Function:	section (private)
+ *
+ * Description:	Make the section given by the arguments of a .section
+ *		directive the current one.  Without any flags, the type and
+ *		flags of the section follow from its name.
+ */
+
+static void section(const vector<string> &args)
+{
+    const string &name = args[0];
+    unsigned type, flags, entsize;
+
+
+    type = SHT_PROGBITS;
+    flags = SECTION_ALLOC;
+    entsize = 0;
+
+    if (name.compare(0, 5, ".text") == 0)
+	flags |= SECTION_EXEC;
+    else if (name.compare(0, 5, ".data") == 0)
+	flags |= SECTION_WRITE;
+    else if (name.compare(0, 4, ".bss") == 0) {
+	flags |= SECTION_WRITE;
+	type = SHT_NOBITS;
+    } else if (name == ".fini_array") {
+	flags |= SECTION_WRITE;
+	type = SHT_FINI_ARRAY;
+    }
+
+    if (args.size() > 1) {
+	flags = 0;
+
+	for (auto c : args[1])
+	    flags |= c == 'a' ? SECTION_ALLOC : c == 'w' ? SECTION_WRITE :
+		c == 'x' ? SECTION_EXEC : c == 'M' ? SECTION_MERGE :
+		c == 'S' ? SECTION_STRINGS : 0;
+    }
+
+    if (args.size() > 2 && args[2] == "@nobits")
+	type = SHT_NOBITS;
+
+    if (args.size() > 3)
+	entsize = evaluate(args[3]).addend;
+
+    select(name, type, flags, entsize);
+}
+
+
+/*
+ * Function:	align (private)
+ *
+ * Description:	Pad the current section to the given alignment, using
+ *		no-operation instructions in code.
+ */
+
+static void align(unsigned alignment)
+{
+    Section &section = object->sections[current];
+
+
+    if (alignment > section.align)
+	section.align = alignment;
+
+    while (section.bytes.size() % alignment != 0)
+	emit(section.flags & SECTION_EXEC ? 0x90 : 0);
+}
+
+
+/*
+ * Function:	define (private)
+ *
+ * Description:	Define the given label at the end of the current section.
+ */
+
+static void define(const string &name)
+{
+    Definition definition;
+
+
+    if (object->symbols.count(name) > 0 || constants.count(name) > 0)
+	error("symbol already defined");
+
+    definition.section = current;
+    definition.value = object->sections[current].bytes.size();
+    definition.align = 0;
+    definition.global = false;
+
+    object->symbols[name] = definition;
+}
+
+
+/*
+ * Function:	common (private)
+ *
+ * Description:	Allocate a variable of the given size, which is either a
+ *		common symbol or a local variable in the uninitialized data
+ *		section.  As with the system assembler, the alignment is
+ *		the largest power of two no greater than the size, up to
+ *		the size of a vector.
+ */
+
+static void common(const vector<string> &args, bool local)
+{
+    unsigned size, alignment;
+    Definition definition;
+    int saved;
+
+
+    if (args.size() < 2)
+	error("missing size");
+
+    size = evaluate(args[1]).addend;
+
+    if (args.size() > 2)
+	alignment = evaluate(args[2]).addend;
+    else
+	for (alignment = 1; alignment * 2 <= size; alignment *= 2)
+	    if (alignment == SIZEOF_VECTOR)
+		break;
+
+    if (local) {
+	saved = current;
+	select(".bss", SHT_NOBITS, SECTION_ALLOC | SECTION_WRITE);
+	align(alignment);
+	define(args[0]);
+	emit(0, size);
+	current = saved;
+
+    } else {
+	if (object->symbols.count(args[0]) > 0)
+	    error("symbol already defined");
+
+	definition.section = -1;
+	definition.value = size;
+	definition.align = alignment;
+	definition.global = true;
+	object->symbols[args[0]] = definition;
+    }
+}
+
+
+/*
+ * Function:	characters (private)
+ *
+ * Description:	Append the characters of the given quoted string, with
+ *		escape sequences, to the current section.
+ */
+
+static void characters(const string &s)
+{
+    unsigned i, value, digits;
+
+
+    if (s.size() < 2 || s[0] != '"' || s[s.size() - 1] != '"')
+	error("invalid string");
+
+    for (i = 1; i < s.size() - 1; i ++) {
+	if (s[i] != '\\') {
+	    emit(s[i]);
+	    continue;
+	}
+
+	i ++;
+
+	if (s[i] >= '0' && s[i] <= '7') {
+	    for (value = digits = 0; digits < 3; digits ++, i ++)
+		if (s[i] >= '0' && s[i] <= '7')
+		    value = value * 8 + s[i] - '0';
+		else
+		    break;
+
+	    emit(value);
+	    i --;
+
+	} else
+	    emit(s[i] == 'n' ? '\n' : s[i] == 't' ? '\t' : s[i] == 'r' ? '\r'
+		: s[i] == 'b' ? '\b' : s[i] == 'f' ? '\f' : s[i]);
+    }
+}
+
+
+/*
+ * Function:	directive (private)
+ *
+ * Description:	Carry out the given directive.
+ */
+
+static void directive(const string &name, const string &operands)
+{
+    vector<string> args = split(operands);
+    Value value;
+
+
+    if (name == ".text")
+	select(".text", SHT_PROGBITS, SECTION_ALLOC | SECTION_EXEC);
+
+    else if (name == ".data")
+	select(".data", SHT_PROGBITS, SECTION_ALLOC | SECTION_WRITE);
+
+    else if (name == ".bss")
+	select(".bss", SHT_NOBITS, SECTION_ALLOC | SECTION_WRITE);
+
+    else if (name == ".section" && !args.empty())
+	section(args);
+
+    else if ((name == ".globl" || name == ".global") && args.size() == 1)
+	globals.insert(args[0]);
+
+    else if (name == ".align" && args.size() == 1)
+	align(evaluate(args[0]).addend);
+
+    else if (name == ".byte" || name == ".long" || name == ".quad") {
+	for (auto &arg : args) {
+	    value = evaluate(arg);
+
+	    if (name == ".long")
+		field(value);
+	    else if (value.symbol.empty())
+		emit(value.addend, name == ".byte" ? 1 : 8);
+	    else
+		error("invalid expression");
+	}
+
+    } else if ((name == ".zero" || name == ".skip") && args.size() == 1)
+	emit(0, evaluate(args[0]).addend);
+
+    else if (name == ".ascii" || name == ".asciz" || name == ".string") {
+	for (auto &arg : args) {
+	    characters(arg);
+
+	    if (name != ".ascii")
+		emit(0);
+	}
+
+    } else if (name == ".comm" || name == ".lcomm")
+	common(args, name == ".lcomm");
+
+    else if ((name == ".set" || name == ".equ") && args.size() == 2) {
+	value = evaluate(args[1]);
+
+	if (!value.symbol.empty())
+	    error("invalid expression");
+
+	constants[args[0]] = value.addend;
+
+    } else
+	error("unknown directive");
+}
+
+
+/*
+ * Function:	statement (private)
+ *
+ * Description:	Assemble the given line, which has any number of labels
+ *		followed by an optional directive or instruction.
+ */
+
+static void statement(string s)
+{
+    size_t i, j;
+
+
+    while (true) {
+	s = trim(s);
+
+	for (j = 0; j < s.size() && symbolic(s[j], j == 0); j ++)
+	    continue;
+
+	if (j == 0 || j == s.size() || s[j] != ':')
+	    break;
+
+	define(s.substr(0, j));
+	s = s.substr(j + 1);
+    }
+
+    if (s.empty())
+	return;
+
+    i = s.find_first_of(" \t");
+    j = i == string::npos ? s.size() : i;
+
+    if (s[0] == '.')
+	directive(s.substr(0, j), s.substr(j));
+    else
+	instruction(s.substr(0, j), s.substr(j));
+}
+
+
+/*
+ * Function:	resolve (private)
+ *
+ * Description:	Fill in the fields that refer to symbols, making
+ *		relocations for those that cannot be resolved yet.
+ */
+
+static void resolve()
+{
+    Relocation relocation;
+    long long value;
+    Definition *definition;
+
+
+    for (auto &fixup : fixups) {
+	Section &section = object->sections[fixup.section];
+	const string &name = fixup.value.symbol;
+
+	value = fixup.value.addend;
+	definition = nullptr;
+
+	if (object->symbols.count(name) > 0)
+	    definition = &object->symbols[name];
+
+	if (constants.count(name) > 0) {
+	    if (fixup.relative)
+		error("relative reference to constant " + name);
+
+	    value += constants[name];
+
+	} else if (definition != nullptr && definition->section >= 0) {
+	    value += definition->value;
+
+	    if (fixup.relative && definition->section == fixup.section)
+		value -= fixup.offset + 4;
+	    else {
+		relocation.offset = fixup.offset;
+		relocation.section = definition->section;
+		relocation.symbol.clear();
+		relocation.relative = fixup.relative;
+		section.relocations.push_back(relocation);
+		value -= fixup.relative ? 4 : 0;
+	    }
+
+	} else {
+	    relocation.offset = fixup.offset;
+	    relocation.section = -1;
+	    relocation.symbol = name;
+	    relocation.relative = fixup.relative;
+	    section.relocations.push_back(relocation);
+	    value -= fixup.relative ? 4 : 0;
+	}
+
+	for (unsigned i = 0; i < 4; i ++)
+	    section.bytes[fixup.offset + i] = (char) (value >> 8 * i);
+    }
+}
+
+
+/*
+ * Function:	assemble
+ *
+ * Description:	Assemble the given text into the given object.
+ */
+
+void assemble(const string &text, Object &result)
+{
+    istringstream stream(text);
+
+
+    object = &result;
+    fixups.clear();
+    constants.clear();
+    globals.clear();
+
+    select(".text", SHT_PROGBITS, SECTION_ALLOC | SECTION_EXEC);
+
+    while (getline(stream, line))
+	statement(line);
+
+    line.clear();
+    resolve();
+
+    for (auto &name : globals)
+	if (object->symbols.count(name) > 0)
+	    object->symbols[name].global = true;
+}
+
+
+/*
+ * Function:	put (private)
+ *
+ * Description:	Append the given value to the given buffer in little-endian
+ *		order, using the given number of bytes.
+ */
+
+static void put(string &buffer, unsigned value, unsigned size = 4)
+{
+    for (unsigned i = 0; i < size; i ++)
+	buffer += (char) (value >> 8 * i);
+}
+
+
+/*
+ * Function:	pad (private)
+ *
+ * Description:	Pad the given buffer with zeroes to the given alignment.
+ */
+
+static void pad(string &buffer, unsigned alignment)
+{
+    while (buffer.size() % alignment != 0)
+	buffer += '\0';
+}
+
+
+/*
+ * Function:	intern (private)
+ *
+ * Description:	Add the given name to the given string table and return its
+ *		offset.
+ */
+
+static unsigned intern(string &table, const string &name)
+{
+    unsigned offset = table.size();
+
+
+    table += name;
+    table += '\0';
+    return offset;
+}
+
+
+/*
+ * Function:	symbol (private)
+ *
+ * Description:	Append an entry to the given symbol table.
+ */
+
+static void symbol(string &table, unsigned name, unsigned value,
+    unsigned size, unsigned info, unsigned index)
+{
+    put(table, name);
+    put(table, value);
+    put(table, size);
+    put(table, info, 1);
+    put(table, 0, 1);
+    put(table, index, 2);
+}
+
+
+/*
+ * Function:	writeObject
+ *
+ * Description:	Write the given object as an ELF relocatable object to the
+ *		given stream.  The sections of the object come first,
+ *		followed by an empty section asking for a stack that is not
+ *		executable, the relocation sections, and finally the tables
+ *		of symbols and names.  Each section has a local symbol so
+ *		that a relocation may refer to it, and the labels and then
+ *		the global symbols follow.
+ */
+
+void writeObject(const Object &object, ostream &ostr)
+{
+    vector<Section> sections = object.sections;
+    vector<unsigned> links, infos;
+    string image, headers, symbols, strings, names;
+    map<string, unsigned> indices;
+    unsigned count, local, symtab, offset;
+    Section extra;
+
+
+    /* Make the symbol table, with the undefined symbols last. */
+
+    symbols.assign(16, '\0');
+    strings.assign(1, '\0');
+
+    for (unsigned i = 0; i < sections.size(); i ++)
+	symbol(symbols, 0, 0, 0, STT_SECTION, i + 1);
+
+    count = local = sections.size() + 1;
+
+    for (int global = 0; global < 2; global ++) {
+	local = global ? count : local;
+
+	for (auto &entry : object.symbols) {
+	    const string &name = entry.first;
+	    const Definition &def = entry.second;
+
+	    if (def.global != (global != 0))
+		continue;
+
+	    if (name.compare(0, strlen(label_prefix), label_prefix) == 0)
+		continue;
+
+	    if (def.section >= 0)
+		symbol(symbols, intern(strings, name), def.value, 0,
+		    global ? STB_GLOBAL : 0, def.section + 1);
+	    else
+		symbol(symbols, intern(strings, name), def.align, def.value,
+		    STB_GLOBAL | STT_OBJECT, SHN_COMMON);
+
+	    indices[name] = count ++;
+	}
+    }
+
+    for (auto &section : sections)
+	for (auto &relocation : section.relocations)
+	    if (relocation.section < 0 && !indices.count(relocation.symbol)) {
+		symbol(symbols, intern(strings, relocation.symbol), 0, 0,
+		    STB_GLOBAL, 0);
+		indices[relocation.symbol] = count ++;
+	    }
+
+
+    /* Add the remaining sections. */
+
+    count = sections.size();
+    links.assign(count + 1, 0);
+    infos.assign(count + 1, 0);
+
+    extra.name = ".note.GNU-stack";
+    extra.type = SHT_PROGBITS;
+    extra.flags = 0;
+    extra.align = 1;
+    extra.entsize = 0;
+    sections.push_back(extra);
+
+    symtab = sections.size() + 1;
+
+    for (auto &section : sections)
+	symtab += section.relocations.empty() ? 0 : 1;
+
+    for (unsigned i = 0; i < count; i ++)
+	if (!sections[i].relocations.empty()) {
+	    extra.name = ".rel" + sections[i].name;
+	    extra.type = SHT_REL;
+	    extra.flags = SHF_INFO_LINK;
+	    extra.align = 4;
+	    extra.entsize = 8;
+	    extra.bytes.clear();
+
+	    for (auto &relocation : sections[i].relocations) {
+		put(extra.bytes, relocation.offset);
+		put(extra.bytes, (relocation.section >= 0 ?
+		    relocation.section + 1 : indices[relocation.symbol]) << 8
+		    | (relocation.relative ? R_386_PC32 : R_386_32));
+	    }
+
+	    sections.push_back(extra);
+	    links.push_back(symtab);
+	    infos.push_back(i + 1);
+	}
+
+    extra.name = ".symtab";
+    extra.type = SHT_SYMTAB;
+    extra.flags = 0;
+    extra.align = 4;
+    extra.entsize = 16;
+    extra.bytes = symbols;
+    sections.push_back(extra);
+    links.push_back(symtab + 1);
+    infos.push_back(local);
+
+    extra.name = ".strtab";
+    extra.type = SHT_STRTAB;
+    extra.align = 1;
+    extra.entsize = 0;
+    extra.bytes = strings;
+    sections.push_back(extra);
+    links.push_back(0);
+    infos.push_back(0);
+
+    extra.name = ".shstrtab";
+    extra.bytes.assign(1, '\0');
+    sections.push_back(extra);
+    links.push_back(0);
+    infos.push_back(0);
+
+    for (auto &section : sections)
+	intern(sections.back().bytes, section.name);
+
+
+    /* Write the contents of each section followed by the headers. */
+
+    image.assign(52, '\0');
+    headers.assign(40, '\0');
+    names.assign(1, '\0');
+
+    for (unsigned i = 0; i < sections.size(); i ++) {
+	pad(image, max(sections[i].align, 1u));
+	offset = image.size();
+
+	if (sections[i].type != SHT_NOBITS)
+	    image += sections[i].bytes;
+
+	put(headers, intern(names, sections[i].name));
+	put(headers, sections[i].type);
+	put(headers, sections[i].flags);
+	put(headers, 0);
+	put(headers, offset);
+	put(headers, sections[i].bytes.size());
+	put(headers, links[i]);
+	put(headers, infos[i]);
+	put(headers, sections[i].align);
+	put(headers, sections[i].entsize);
+    }
+
+    pad(image, 4);
+    offset = image.size();
+    image += headers;
+
+
+    /* Finally, fill in the ELF header. */
+
+    headers.assign("\x7f" "ELF\x01\x01\x01");
+    headers.resize(16, '\0');
+    put(headers, ET_REL, 2);
+    put(headers, EM_386, 2);
+    put(headers, EV_CURRENT);
+    put(headers, 0);
+    put(headers, 0);
+    put(headers, offset);
+    put(headers, 0);
+    put(headers, 52, 2);
+    put(headers, 0, 2);
+    put(headers, 0, 2);
+    put(headers, 40, 2);
+    put(headers, sections.size() + 1, 2);
+    put(headers, sections.size(), 2);
+
+    image.replace(0, headers.size(), headers);
+    ostr.write(image.data(), image.size());
+}
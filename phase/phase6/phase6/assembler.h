@@ -0,0 +1,64 @@
+/*
+ * File:	assembler.h
+ *
+ * Description:	This file contains the type and function declarations for
+ *		the integrated assembler for Simple C and for running the
+ *		objects that it assembles in memory.
+ */
+
+# ifndef ASSEMBLER_H
+# define ASSEMBLER_H
+# include <map>
+# include <string>
+# include <vector>
+# include <ostream>
+
+enum {
+    SECTION_WRITE = 0x1, SECTION_ALLOC = 0x2, SECTION_EXEC = 0x4,
+    SECTION_MERGE = 0x10, SECTION_STRINGS = 0x20
+};
+
+
+/* A 32-bit field referring to a section or symbol, whose addend is stored
+   in the field itself */
+
+struct Relocation {
+    unsigned offset;
+    int section;
+    std::string symbol;
+    bool relative;
+};
+
+
+/* A section, whose contents are all zero if it occupies no space in the
+   object */
+
+struct Section {
+    std::string name;
+    unsigned type, flags, align, entsize;
+    std::string bytes;
+    std::vector<Relocation> relocations;
+};
+
+
+/* A symbol defined at an offset within a section, or a common symbol of
+   the given size if it has no section */
+
+struct Definition {
+    int section;
+    unsigned value, align;
+    bool global;
+};
+
+struct Object {
+    std::vector<Section> sections;
+    std::map<std::string, Definition> symbols;
+};
+
+void assemble(const std::string &text, Object &object);
+void writeObject(const Object &object, std::ostream &ostr);
+
+void load(const Object &object, std::vector<char *> &addresses);
+int run(const Object &object, int argc, char *argv[]);
+
+# endif /* ASSEMBLER_H */
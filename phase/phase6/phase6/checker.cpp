@@ -18,6 +18,7 @@
 # include "Symbol.h"
 # include "Scope.h"
 # include "Type.h"
+# include "optimizer.h"
 
 
 using namespace std;
@@ -31,16 +32,23 @@ static string redeclared = "redeclaration of '%s'";
 static string conflicting = "conflicting types for '%s'";
 static string undeclared = "'%s' undeclared";
 
-static string invalid_break = "break statement not within loop";
+static string invalid_break = "break statement not within loop or switch";
 static string invalid_test = "invalid type for test expression";
 static string invalid_return = "invalid return type";
 static string invalid_lvalue = "lvalue required in expression";
+static string invalid_const = "assignment of read-only object";
+static string invalid_initializer = "invalid initializer";
+static string invalid_qualifier = "conversion discards const qualifier";
 static string invalid_operands = "invalid operands to binary %s";
 static string invalid_sizeof = "invalid operand in sizeof expression";
 static string invalid_cast = "invalid operand in cast expression";
 static string invalid_operand = "invalid operand to unary %s";
 static string invalid_function = "called object is not a function";
 static string invalid_arguments = "invalid arguments to called function";
+static string invalid_switch = "switch quantity not an integer";
+static string invalid_case = "case label does not reduce to an integer constant";
+static string duplicate_case = "duplicate case value";
+static string duplicate_default = "multiple default labels in one switch";
 
 
 /*
@@ -78,6 +86,20 @@ static Type promote(Expression *&expr)
 }
 
 
+/*
+ * Function:	discards
+ *
+ * Description:	Return whether converting a value of the second type to the
+ *		first type discards the const qualifier of the object
+ *		pointed to, which would permit storing to a const object.
+ */
+
+static bool discards(const Type &to, const Type &from)
+{
+    return to.isPointer() && from.isQualified() && !to.isQualified();
+}
+
+
 /*
  * Function:	extend
  *
@@ -132,7 +154,7 @@ static Type convert(Expression *&expr, Type type)
 	return type;
     }
 
-    return expr->type() != type ? extend(expr, type) : type;
+    return expr->type() != type ? extend(expr, type) : expr->type();
 }
 
 
@@ -266,7 +288,9 @@ Symbol *checkIdentifier(const string &name)
  *
  * Description:	Check a function call expression: the type of the object
  *		being called must be a function type, and the number and
- *		types of arguments and parameters must agree.
+ *		types of arguments and parameters must agree.  An integer
+ *		argument to a double parameter is converted, and a pointer
+ *		to const may not be passed to a pointer that is not.
  */
 
 Expression *checkCall(Symbol *id, Expressions &args)
@@ -282,6 +306,7 @@ Expression *checkCall(Symbol *id, Expressions &args)
 	else {
 	    Parameters *params = t.parameters();
 	    result = Type(t.specifier(), t.indirection());
+	    result = t.isQualified() ? result.qualify() : result;
 
 	    for (auto &arg : args)
 		promote(arg);
@@ -297,7 +322,13 @@ Expression *checkCall(Symbol *id, Expressions &args)
 			    report(invalid_arguments);
 			    result = error;
 			    break;
-			}
+			} else if (discards(params->types[i],
+				args[i]->type())) {
+			    report(invalid_qualifier);
+			    result = error;
+			    break;
+			} else
+			    extend(args[i], params->types[i]);
 		}
 
 	    } else {
@@ -315,7 +346,8 @@ Expression *checkCall(Symbol *id, Expressions &args)
  *
  * Description:	Check an array index expression: the left operand must have
  *		type "pointer to T" and the right operand must have type
- *		int, and the result has type T.
+ *		int, and the result has type T.  The elements of a const
+ *		array are themselves const.
  */
 
 Expression *checkArray(Expression *left, Expression *right)
@@ -417,7 +449,8 @@ Expression *checkDereference(Expression *expr)
  *
  * Description:	Check an address expression: the operand must be an lvalue,
  *		and if the operand has type T, then the result has type
- *		"pointer to (T)."
+ *		"pointer to (T)."  The address of a const object is a
+ *		pointer to const.
  */
 
 Expression *checkAddress(Expression *expr)
@@ -427,9 +460,10 @@ Expression *checkAddress(Expression *expr)
 
 
     if (t != error) {
-	if (expr->lvalue())
+	if (expr->lvalue()) {
 	    result = Type(t.specifier(), t.indirection() + 1);
-	else
+	    result = t.isQualified() ? result.qualify() : result;
+	} else
 	    report(invalid_lvalue);
     }
 	//cout << "here" << endl;
@@ -441,7 +475,7 @@ Expression *checkAddress(Expression *expr)
  * Function:	checkIncrement
  *
  * Description:	Check an increment expression: the operand must be an
- *		lvalue, and the result has the same type.
+ *		lvalue that is not const, and the result has the same type.
  */
 
 Expression *checkIncrement(Expression *expr)
@@ -453,11 +487,16 @@ Expression *checkIncrement(Expression *expr)
 
 
     if (t != error) {
-	if (expr->lvalue()) {
+	if (!expr->lvalue())
+	    report(invalid_lvalue);
+
+	else if (t.isConst())
+	    report(invalid_const);
+
+	else {
 	    scale = (t.isPointer() ? t.deref().size() : 1);
 	    result = t;
-	} else
-	    report(invalid_lvalue);
+	}
     }
 
     incr = new Increment(expr, result);
@@ -471,7 +510,7 @@ Expression *checkIncrement(Expression *expr)
  * Function:	checkDecrement
  *
  * Description:	Check a decrement expression: the operand must be an
- *		lvalue, and the result has the same type.
+ *		lvalue that is not const, and the result has the same type.
  */
 
 Expression *checkDecrement(Expression *expr)
@@ -483,11 +522,16 @@ Expression *checkDecrement(Expression *expr)
 
 
     if (t != error) {
-	if (expr->lvalue()) {
+	if (!expr->lvalue())
+	    report(invalid_lvalue);
+
+	else if (t.isConst())
+	    report(invalid_const);
+
+	else {
 	    scale = (t.isPointer() ? t.deref().size() : 1);
 	    result = t;
-	} else
-	    report(invalid_lvalue);
+	}
     }
 
     decr = new Decrement(expr, result);
@@ -522,7 +566,8 @@ Expression *checkSizeof(Expression *expr)
  *
  * Description:	Check a cast expression: the result and operand must both
  *		have numeric types, both have pointer types, or one has
- *		type integer and the other has a pointer type.
+ *		type integer and the other has a pointer type.  A cast
+ *		may discard the const qualifier of a pointer.
  */
 
 Expression *checkCast(const Type &type, Expression *expr)
@@ -555,7 +600,7 @@ Expression *checkCast(const Type &type, Expression *expr)
 	cout << "target type = " << type << endl;
 	*/
 
-	if (result != error && result != type)
+	if (result != error && (result != type || result.isQualified()))
 	    expr = new Cast(type, expr);
     }
 
@@ -895,7 +940,9 @@ Expression *checkLogicalOr(Expression *left, Expression *right)
  * Function:	checkAssignment
  *
  * Description:	Check an assignment statement: the left operand must be an
- *		lvalue and the types of the operands must be compatible.
+ *		lvalue that is not const and the types of the operands must
+ *		be compatible.  A pointer to const may only be assigned to
+ *		a pointer to const.
  */
 
 Statement *checkAssignment(Expression *left, Expression *right)
@@ -912,18 +959,114 @@ Statement *checkAssignment(Expression *left, Expression *right)
 	if (!left->lvalue())
 	    report(invalid_lvalue);
 
+	else if (t1.isConst())
+	    report(invalid_const);
+
 	else if (!t1.isCompatibleWith(t2))
 	    report(invalid_operands, "=");
+
+	else if (discards(t1, t2))
+	    report(invalid_qualifier);
     }
 	
     return new Assignment(left, right);
 }
 
 
+/*
+ * Function:	checkInitializer
+ *
+ * Description:	Check the initializer of a global variable, which is a
+ *		list of literals.  Each literal must be compatible with the
+ *		type of the variable, or of its elements if it is an array,
+ *		and there may be no more literals than elements.  A string
+ *		may initialize a character array or pointer.
+ */
+
+void checkInitializer(Symbol *symbol, const Expressions &values)
+{
+    const Type &t = symbol->type();
+    Type element;
+    unsigned length;
+    bool valid;
+
+
+    if (t == error)
+	return;
+
+    if (!symbol->initializer.empty()) {
+	report(redefined, symbol->name());
+	return;
+    }
+
+    element = Type(t.specifier(), t.indirection());
+    length = t.isArray() ? t.length() : 1;
+    valid = values.size() <= length;
+
+    for (auto value : values) {
+	if (dynamic_cast<String *>(value) != nullptr) {
+	    String *str = (String *) value;
+
+	    if (element == character && t.isArray()) {
+		valid = valid && values.size() == 1;
+		valid = valid && str->value().size() <= length;
+	    } else
+		valid = valid && element == Type(CHAR, 1);
+
+	} else if (dynamic_cast<Real *>(value) != nullptr)
+	    valid = valid && element == real;
+
+	else if (element.isPointer())
+	    valid = valid && ((Integer *) value)->value() == "0";
+    }
+
+    if (!valid)
+	report(invalid_initializer);
+    else
+	symbol->initializer = values;
+}
+
+
+/*
+ * Function:	checkInitializer
+ *
+ * Description:	Check the initializer of a local variable, which must be a
+ *		scalar, and return the assignment that initializes it.  The
+ *		value of a const variable initialized with a literal is
+ *		known, so the variable may be replaced by the literal.
+ */
+
+Statement *checkInitializer(Symbol *symbol, Expression *expr)
+{
+    const Type &t1 = symbol->type();
+    const Type &t2 = convert(expr, t1);
+
+
+    if (t1 != error && t2 != error) {
+	if (!t1.isScalar())
+	    report(invalid_initializer);
+
+	else if (!t1.isCompatibleWith(t2))
+	    report(invalid_initializer);
+
+	else if (discards(t1, t2))
+	    report(invalid_qualifier);
+
+	else if (t1.isConst())
+	    if (dynamic_cast<Integer *>(expr) != nullptr ||
+		    dynamic_cast<Real *>(expr) != nullptr)
+		symbol->initializer.push_back(expr);
+    }
+
+    return new Assignment(new Identifier(symbol), expr);
+}
+
+
 /*
  * Function:	checkBreak
  *
- * Description:	Check if a break statement is within a loop.
+ * Description:	Check if a break statement is within a loop or switch
+ *		statement.
  */
 
 void checkBreak(unsigned depth)
@@ -938,7 +1081,8 @@ void checkBreak(unsigned depth)
  *
  * Description:	Check a return statement: the type of the expression must
  *		be compatible with the given type, which should be the
- *		return type of the enclosing function.
+ *		return type of the enclosing function, and may not discard
+ *		the const qualifier of a pointer.
  */
 
 void checkReturn(Expression *&expr, const Type &type)
@@ -947,6 +1091,9 @@ void checkReturn(Expression *&expr, const Type &type)
 
     if (t != error && !t.isCompatibleWith(type))
 	report(invalid_return);
+
+    else if (t != error && discards(type, t))
+	report(invalid_qualifier);
 }
 
 
@@ -965,3 +1112,77 @@ void checkTest(Expression *&expr)
     if (t != error && !t.isPredicate())
 	report(invalid_test);
 }
+
+
+/*
+ * Function:	checkSwitch
+ *
+ * Description:	Check if the type of the expression is a legal type in a
+ *		switch statement: the type after promotion must be integer.
+ */
+
+void checkSwitch(Expression *&expr)
+{
+    const Type &t = promote(expr);
+
+    if (t != error && t != integer)
+	report(invalid_switch);
+}
+
+
+/*
+ * Function:	checkCase
+ *
+ * Description:	Check a case label of a switch statement, given the
+ *		sections seen so far and the current section: the label
+ *		must be an integer constant expression whose value does
+ *		not already appear.  The value is returned if the label is
+ *		valid.
+ */
+
+bool checkCase(Expression *expr, const Cases &cases, const Case &section,
+	int &value)
+{
+    if (expr->type() == error)
+	return false;
+
+    if (expr->type() != integer || !evaluateConstant(expr, value)) {
+	report(invalid_case);
+	return false;
+    }
+
+    for (auto &prior : cases)
+	for (auto other : prior.values)
+	    if (other == value) {
+		report(duplicate_case);
+		return false;
+	    }
+
+    for (auto other : section.values)
+	if (other == value) {
+	    report(duplicate_case);
+	    return false;
+	}
+
+    return true;
+}
+
+
+/*
+ * Function:	checkDefault
+ *
+ * Description:	Check a default label of a switch statement, given the
+ *		sections seen so far and the current section: there may
+ *		be at most one.
+ */
+
+void checkDefault(const Cases &cases, const Case &section)
+{
+    bool found = section.isDefault;
+
+    for (auto &prior : cases)
+	found = found || prior.isDefault;
+
+    if (found)
+	report(duplicate_default);
+}
@@ -42,9 +42,15 @@ Expression *checkNotEqual(Expression *left, Expression *right);
 Expression *checkLogicalAnd(Expression *left, Expression *right);
 Expression *checkLogicalOr(Expression *left, Expression *right);
 Statement *checkAssignment(Expression *left, Expression *right);
+void checkInitializer(Symbol *symbol, const Expressions &values);
+Statement *checkInitializer(Symbol *symbol, Expression *expr);
 
 void checkBreak(unsigned depth);
 void checkReturn(Expression *&expr, const Type &type);
 void checkTest(Expression *&expr);
+void checkSwitch(Expression *&expr);
+bool checkCase(Expression *expr, const Cases &cases, const Case &section,
+	int &value);
+void checkDefault(const Cases &cases, const Case &section);
 
 # endif /* CHECKER_H */
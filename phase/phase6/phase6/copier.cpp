@@ -0,0 +1,241 @@
+/*
+ * File:	copier.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		copying abstract syntax trees.  A copy is a deep copy of
+ *		the tree nodes, but the symbols, types, and scopes are
+ *		shared with the original tree.
+ *
+ *		Any transformation that needs the same computation in more
+ *		than one place must copy it, since code generation stores
+ *		its results in the nodes themselves.  A copy keeps the
+ *		profile counter of the original, so its counts still apply.
+ */
+
+# include "Tree.h"
+
+using namespace std;
+
+
+/*
+ * From this point on are the member functions for copying the tree, one
+ * for each type of tree node that can be instantiated.  They are no more
+ * interesting than the constructors they call.
+ */
+
+Expression *String::clone() const
+{
+    return new String(_value);
+}
+
+Expression *Identifier::clone() const
+{
+    return new Identifier(_symbol);
+}
+
+Expression *Integer::clone() const
+{
+    return new Integer(_value);
+}
+
+Expression *Real::clone() const
+{
+    return new Real(_value);
+}
+
+Expression *Call::clone() const
+{
+    Expressions args;
+    Call *call;
+
+    for (auto arg : _args)
+	args.push_back(arg->clone());
+
+    call = new Call(_id, args, _type);
+    call->counter = counter;
+    return call;
+}
+
+Expression *Not::clone() const
+{
+    return new Not(_expr->clone(), _type);
+}
+
+Expression *Negate::clone() const
+{
+    return new Negate(_expr->clone(), _type);
+}
+
+Expression *Dereference::clone() const
+{
+    return new Dereference(_expr->clone(), _type);
+}
+
+Expression *Address::clone() const
+{
+    return new Address(_expr->clone(), _type);
+}
+
+Expression *Increment::clone() const
+{
+    Increment *incr = new Increment(_expr->clone(), _type);
+
+    incr->scale = scale;
+    return incr;
+}
+
+Expression *Decrement::clone() const
+{
+    Decrement *decr = new Decrement(_expr->clone(), _type);
+
+    decr->scale = scale;
+    return decr;
+}
+
+Expression *Cast::clone() const
+{
+    return new Cast(_type, _expr->clone());
+}
+
+Expression *Multiply::clone() const
+{
+    return new Multiply(_left->clone(), _right->clone(), _type);
+}
+
+Expression *Divide::clone() const
+{
+    return new Divide(_left->clone(), _right->clone(), _type);
+}
+
+Expression *Remainder::clone() const
+{
+    return new Remainder(_left->clone(), _right->clone(), _type);
+}
+
+Expression *Add::clone() const
+{
+    Add *add = new Add(_left->clone(), _right->clone(), _type);
+
+    add->scaleLeft = scaleLeft;
+    add->scaleRight = scaleRight;
+    return add;
+}
+
+Expression *Subtract::clone() const
+{
+    Subtract *sub = new Subtract(_left->clone(), _right->clone(), _type);
+
+    sub->scaleResult = scaleResult;
+    sub->scaleRight = scaleRight;
+    return sub;
+}
+
+Expression *LessThan::clone() const
+{
+    return new LessThan(_left->clone(), _right->clone(), _type);
+}
+
+Expression *GreaterThan::clone() const
+{
+    return new GreaterThan(_left->clone(), _right->clone(), _type);
+}
+
+Expression *LessOrEqual::clone() const
+{
+    return new LessOrEqual(_left->clone(), _right->clone(), _type);
+}
+
+Expression *GreaterOrEqual::clone() const
+{
+    return new GreaterOrEqual(_left->clone(), _right->clone(), _type);
+}
+
+Expression *Equal::clone() const
+{
+    return new Equal(_left->clone(), _right->clone(), _type);
+}
+
+Expression *NotEqual::clone() const
+{
+    return new NotEqual(_left->clone(), _right->clone(), _type);
+}
+
+Expression *LogicalAnd::clone() const
+{
+    return new LogicalAnd(_left->clone(), _right->clone(), _type);
+}
+
+Expression *LogicalOr::clone() const
+{
+    return new LogicalOr(_left->clone(), _right->clone(), _type);
+}
+
+Expression *Common::clone() const
+{
+    return _expr->clone();
+}
+
+Statement *Assignment::clone() const
+{
+    return new Assignment(_left->clone(), _right->clone());
+}
+
+Statement *Break::clone() const
+{
+    return new Break();
+}
+
+Statement *Return::clone() const
+{
+    return new Return(_expr->clone());
+}
+
+Statement *Block::clone() const
+{
+    Statements stmts;
+
+    for (auto stmt : _stmts)
+	stmts.push_back(stmt->clone());
+
+    return new Block(_decls, stmts);
+}
+
+Statement *While::clone() const
+{
+    While *loop;
+
+    loop = new While(_expr->clone(), _stmt->clone());
+    loop->counter = counter;
+    return loop;
+}
+
+Statement *For::clone() const
+{
+    For *loop;
+
+    loop = new For(_init->clone(), _expr->clone(), _incr->clone(),
+	    _stmt->clone());
+    loop->counter = counter;
+    return loop;
+}
+
+Statement *If::clone() const
+{
+    Statement *elseStmt;
+    If *cond;
+
+    elseStmt = _elseStmt != nullptr ? _elseStmt->clone() : nullptr;
+    cond = new If(_expr->clone(), _thenStmt->clone(), elseStmt);
+    cond->counter = counter;
+    return cond;
+}
+
+Statement *Switch::clone() const
+{
+    Cases cases = _cases;
+
+    for (auto &section : cases)
+	section.stmt = section.stmt->clone();
+
+    return new Switch(_expr->clone(), cases);
+}
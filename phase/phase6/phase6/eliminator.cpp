@@ -0,0 +1,240 @@
+/*
+ * File:	eliminator.cpp
+ *
+ * Description:	This file contains the function definitions for the
+ *		elimination of dead and unreachable code in Simple C.
+ *
+ *		Statements following a return or break in the same block
+ *		can never be executed and are removed.  An assignment to a
+ *		local variable that is not live afterwards is a dead store.
+ *		If its right-hand side has no side effects, the assignment
+ *		is removed; otherwise, only the side effects are kept.
+ *		Similarly, an expression statement is reduced to just its
+ *		side effects, which removes statements such as "c;" along
+ *		with the conversions inserted by the checker.
+ *
+ *		Removing a dead store may make other stores dead, so we
+ *		repeat until nothing changes.  Only local variables that do
+ *		not escape are considered.
+ */
+
+# include "optimizer.h"
+
+using namespace std;
+
+static SymbolSet locals, escaped;
+static Liveness live;
+static unsigned unreachable, dead;
+
+
+/*
+ * Function:	effects (private)
+ *
+ * Description:	Append the subexpressions of the given expression that
+ *		have side effects to the list, in the order in which they
+ *		are evaluated.  A call, increment, or decrement is kept
+ *		whole, as is a logical operator whose right operand has
+ *		side effects, since that operand is evaluated conditionally.
+ */
+
+static void effects(Expression *expr, Statements &stmts)
+{
+    vector<Expression **> operands;
+    Statements right;
+    Binary *binary;
+
+
+    if (dynamic_cast<Call *>(expr) != nullptr ||
+	    dynamic_cast<Increment *>(expr) != nullptr ||
+	    dynamic_cast<Decrement *>(expr) != nullptr) {
+	stmts.push_back(expr);
+	return;
+    }
+
+    if (dynamic_cast<LogicalAnd *>(expr) != nullptr ||
+	    dynamic_cast<LogicalOr *>(expr) != nullptr) {
+	binary = (Binary *) expr;
+	effects(binary->right(), right);
+
+	if (!right.empty()) {
+	    stmts.push_back(expr);
+	    return;
+	}
+    }
+
+    children(expr, operands);
+
+    for (auto slot : operands)
+	effects(*slot, stmts);
+}
+
+
+/*
+ * Function:	replace (private)
+ *
+ * Description:	Replace the given statement with the side effects of the
+ *		given expression, and return whether anything changed.
+ */
+
+static bool replace(Statement *&stmt, Expression *expr)
+{
+    Statements stmts;
+
+
+    effects(expr, stmts);
+
+    if (stmts.size() == 1 && stmts[0] == stmt)
+	return false;
+
+    if (stmts.size() == 1)
+	stmt = stmts[0];
+    else
+	stmt = new Block(new Scope(), stmts);
+
+    return true;
+}
+
+
+/*
+ * Function:	tracked (private)
+ *
+ * Description:	Return whether the given expression is a local variable
+ *		whose liveness is known exactly.
+ */
+
+static bool tracked(Expression *expr)
+{
+    const Symbol *symbol = identifier(expr);
+    return locals.count(symbol) > 0 && escaped.count(symbol) == 0;
+}
+
+
+/*
+ * Function:	eliminate (private)
+ *
+ * Description:	Remove the dead stores and useless expressions within the
+ *		given statement, and return whether anything changed.
+ */
+
+static bool eliminate(Statement *&stmt)
+{
+    vector<Statement **> slots;
+    Expression *expr;
+    Assignment *assign;
+    Unary *unary;
+    bool changed;
+
+
+    changed = false;
+    statements(stmt, slots);
+
+    for (auto slot : slots) {
+	if ((assign = dynamic_cast<Assignment *>(*slot)) != nullptr) {
+	    if (!tracked(assign->left()))
+		continue;
+
+	    if (live[*slot].count(identifier(assign->left())) > 0)
+		continue;
+
+	    replace(*slot, assign->right());
+	    changed = true;
+	    dead ++;
+
+	} else if ((expr = dynamic_cast<Expression *>(*slot)) != nullptr) {
+	    if (dynamic_cast<Increment *>(expr) != nullptr ||
+		    dynamic_cast<Decrement *>(expr) != nullptr) {
+		unary = (Unary *) expr;
+
+		if (!tracked(unary->expr()))
+		    continue;
+
+		if (live[*slot].count(identifier(unary->expr())) > 0)
+		    continue;
+
+		*slot = new Block(new Scope(), Statements());
+		changed = true;
+		dead ++;
+
+	    } else if (replace(*slot, expr)) {
+		changed = true;
+		dead ++;
+	    }
+	}
+    }
+
+    return changed;
+}
+
+
+/*
+ * Function:	prune (private)
+ *
+ * Description:	Remove the unreachable statements and the empty blocks
+ *		within the given statement.
+ */
+
+static void prune(Statement *stmt)
+{
+    vector<Statement **> slots;
+    Statements stmts;
+    Block *block, *child;
+    unsigned i;
+
+
+    statements(stmt, slots);
+
+    for (auto slot : slots) {
+	if ((block = dynamic_cast<Block *>(*slot)) == nullptr)
+	    continue;
+
+	stmts.clear();
+
+	for (i = 0; i < block->statements().size(); i ++) {
+	    child = dynamic_cast<Block *>(block->statements()[i]);
+
+	    if (child == nullptr || !child->statements().empty() ||
+		    !child->declarations()->symbols().empty())
+		stmts.push_back(block->statements()[i]);
+
+	    if (!completes(block->statements()[i]))
+		break;
+	}
+
+	while (++ i < block->statements().size())
+	    unreachable ++;
+
+	block->statements() = stmts;
+    }
+}
+
+
+/*
+ * Function:	eliminateDeadCode
+ *
+ * Description:	Remove the dead and unreachable code in the given
+ *		function.
+ */
+
+void eliminateDeadCode(Function *function)
+{
+    Statement *body;
+    bool changed;
+
+
+    body = function->body();
+    locals = analyze(function).locals;
+    escaped = analyze(function).escaped;
+    unreachable = dead = 0;
+
+    prune(body);
+
+    do {
+	live.clear();
+	liveness(body, SymbolSet(), live);
+	changed = eliminate(body);
+	prune(body);
+    } while (changed);
+
+    count("unreachable statements removed", unreachable);
+    count("dead statements removed", dead);
+}
@@ -0,0 +1,763 @@
+/*
+ * File:	evaluator.cpp
+ *
+ * Description:	This file contains the function definitions for
+ *		conditional constant propagation in Simple C.
+ *
+ *		Each local integer variable whose address is never taken
+ *		has a value that is either undefined, a known constant, or
+ *		varying.  The statements are visited in execution order,
+ *		carrying the values of the variables with them, and a
+ *		statement that can only be reached along a path we have
+ *		found to be impossible is not visited at all.  In other
+ *		words, an if statement whose test has a known value only
+ *		visits the part that is taken, and the two parts of an if
+ *		statement meet afterwards.  A loop is visited until the
+ *		values at its head no longer change, starting optimistically
+ *		with only the values from before the loop.
+ *
+ *		This is the tree equivalent of sparse conditional constant
+ *		propagation.  Since the statements are structured, the
+ *		variables of the tree serve as the values of a static single
+ *		assignment form, and the parts of each statement serve as
+ *		the edges of its flow graph.
+ *
+ *		Afterwards, the uses of each variable known to be constant
+ *		are replaced with its value, tests with a known value are
+ *		folded away along with the parts never taken, and integer
+ *		expressions whose operands are all constants are replaced
+ *		with their values.
+ */
+
+# include <climits>
+# include <typeinfo>
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+enum {UNDEFINED, CONSTANT, VARYING};
+
+
+/* The value of a variable or expression: undefined, constant, or varying */
+
+struct Value {
+    int kind;
+    int constant;
+};
+
+
+/* The values of the variables at a point, and whether it can be reached */
+
+struct State {
+    bool reachable;
+    map<const Symbol *, Value> values;
+};
+
+static SymbolSet tracked;
+static vector<State> exits;
+static map<const Statement *, Value> tests;
+static map<Expression **, Value> uses;
+static set<const Statement *> reached;
+static unsigned replaced, branches, evaluated;
+
+static State transfer(Statement *stmt, State state);
+
+
+/*
+ * Function:	meet (private)
+ *
+ * Description:	Return the value of a variable that may have either of the
+ *		given values.
+ */
+
+static Value meet(const Value &left, const Value &right)
+{
+    if (left.kind == UNDEFINED)
+	return right;
+
+    if (right.kind == UNDEFINED)
+	return left;
+
+    if (left.kind == CONSTANT && right.kind == CONSTANT)
+	if (left.constant == right.constant)
+	    return left;
+
+    return {VARYING, 0};
+}
+
+
+/*
+ * Function:	meet (private)
+ *
+ * Description:	Return the state at a point that may be reached from either
+ *		of the given states.
+ */
+
+static State meet(const State &left, const State &right)
+{
+    State result;
+
+
+    if (!left.reachable)
+	return right;
+
+    if (!right.reachable)
+	return left;
+
+    result = left;
+
+    for (auto &entry : right.values)
+	if (result.values.count(entry.first) > 0)
+	    result.values[entry.first] = meet(left.values.at(entry.first),
+		entry.second);
+	else
+	    result.values[entry.first] = entry.second;
+
+    return result;
+}
+
+
+/*
+ * Function:	same (private)
+ *
+ * Description:	Return whether the two given states are the same.
+ */
+
+static bool same(const State &left, const State &right)
+{
+    if (left.reachable != right.reachable)
+	return false;
+
+    if (left.values.size() != right.values.size())
+	return false;
+
+    for (auto &entry : left.values) {
+	if (right.values.count(entry.first) == 0)
+	    return false;
+
+	const Value &other = right.values.at(entry.first);
+
+	if (entry.second.kind != other.kind)
+	    return false;
+
+	if (entry.second.kind == CONSTANT)
+	    if (entry.second.constant != other.constant)
+		return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	lookup (private)
+ *
+ * Description:	Return the value of the given symbol in the given state.
+ *		The value of any variable we do not track is varying.
+ */
+
+static Value lookup(const State &state, const Symbol *symbol)
+{
+    if (tracked.count(symbol) == 0)
+	return {VARYING, 0};
+
+    if (state.values.count(symbol) == 0)
+	return {UNDEFINED, 0};
+
+    return state.values.at(symbol);
+}
+
+
+/*
+ * Function:	compute (private)
+ *
+ * Description:	Compute the result of the given integer operator on the
+ *		given constants, and return whether the result is defined.
+ *		The arithmetic wraps around just as the machine does.
+ */
+
+static bool compute(const type_info &id, int left, int right, int &result)
+{
+    unsigned x = left, y = right;
+
+
+    if (id == typeid(Add))
+	result = x + y;
+    else if (id == typeid(Subtract))
+	result = x - y;
+    else if (id == typeid(Multiply))
+	result = x * y;
+    else if (id == typeid(Divide) || id == typeid(Remainder)) {
+	if (right == 0 || (left == INT_MIN && right == -1))
+	    return false;
+
+	result = id == typeid(Divide) ? left / right : left % right;
+
+    } else if (id == typeid(LessThan))
+	result = left < right;
+    else if (id == typeid(GreaterThan))
+	result = left > right;
+    else if (id == typeid(LessOrEqual))
+	result = left <= right;
+    else if (id == typeid(GreaterOrEqual))
+	result = left >= right;
+    else if (id == typeid(Equal))
+	result = left == right;
+    else if (id == typeid(NotEqual))
+	result = left != right;
+    else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	evaluate (private)
+ *
+ * Description:	Return the value of the given expression in the given
+ *		state.  Only integer operators on integer operands are
+ *		evaluated, and a logical operator is constant if its left
+ *		operand alone decides its value.
+ */
+
+static Value evaluate(Expression *expr, const State &state)
+{
+    Value left, right;
+    Binary *binary;
+    Unary *unary;
+    int value;
+
+
+    if (isConstant(expr, value) && expr->type().isInteger())
+	return {CONSTANT, value};
+
+    if (identifier(expr) != nullptr)
+	return lookup(state, identifier(expr));
+
+    if (expr->type() != Type(INT))
+	return {VARYING, 0};
+
+    if ((binary = dynamic_cast<LogicalAnd *>(expr)) != nullptr ||
+	    (binary = dynamic_cast<LogicalOr *>(expr)) != nullptr) {
+	value = typeid(*expr) == typeid(LogicalOr);
+	left = evaluate(binary->left(), state);
+
+	if (left.kind != CONSTANT)
+	    return left;
+
+	if ((left.constant != 0) == value)
+	    return {CONSTANT, value};
+
+	right = evaluate(binary->right(), state);
+
+	if (right.kind != CONSTANT)
+	    return right;
+
+	return {CONSTANT, right.constant != 0};
+    }
+
+    if ((unary = dynamic_cast<Not *>(expr)) != nullptr ||
+	    (unary = dynamic_cast<Negate *>(expr)) != nullptr) {
+	if (unary->expr()->type() != Type(INT))
+	    return {VARYING, 0};
+
+	left = evaluate(unary->expr(), state);
+
+	if (left.kind != CONSTANT)
+	    return left;
+
+	if (dynamic_cast<Not *>(expr) != nullptr)
+	    return {CONSTANT, left.constant == 0};
+
+	return {CONSTANT, (int) -(unsigned) left.constant};
+    }
+
+    if ((binary = dynamic_cast<Binary *>(expr)) != nullptr) {
+	if (binary->left()->type() != Type(INT))
+	    return {VARYING, 0};
+
+	if (binary->right()->type() != Type(INT))
+	    return {VARYING, 0};
+
+	left = evaluate(binary->left(), state);
+	right = evaluate(binary->right(), state);
+
+	if (left.kind == VARYING || right.kind == VARYING)
+	    return {VARYING, 0};
+
+	if (left.kind == UNDEFINED || right.kind == UNDEFINED)
+	    return {UNDEFINED, 0};
+
+	if (compute(typeid(*expr), left.constant, right.constant, value))
+	    return {CONSTANT, value};
+    }
+
+    return {VARYING, 0};
+}
+
+
+/*
+ * Function:	record (private)
+ *
+ * Description:	Record the values of the variables read by the given
+ *		statement in the given state, which is the state before it.
+ *		The target of an assignment, increment, or decrement is not
+ *		a read.
+ */
+
+static void record(Statement *stmt, const State &state)
+{
+    vector<Expression **> exprs;
+    set<Expression **> targets;
+    Assignment *assign;
+    Expression *expr;
+    Unary *unary;
+
+
+    if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr)
+	targets.insert(&assign->left());
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr) {
+	expressions(expr, exprs);
+	targets.insert(&expr);
+    } else
+	expressions(stmt, exprs);
+
+    for (auto slot : exprs)
+	if ((unary = dynamic_cast<Increment *>(*slot)) != nullptr ||
+		(unary = dynamic_cast<Decrement *>(*slot)) != nullptr)
+	    targets.insert(&unary->expr());
+
+    for (auto slot : exprs)
+	if (targets.count(slot) == 0 && tracked.count(identifier(*slot)) > 0)
+	    uses[slot] = meet(uses[slot], lookup(state, identifier(*slot)));
+}
+
+
+/*
+ * Function:	effects (private)
+ *
+ * Description:	Update the given state for the increments and decrements
+ *		within the given statement.  An increment or decrement that
+ *		is the whole statement changes a constant by one; any other
+ *		makes the variable varying.
+ */
+
+static void effects(Statement *stmt, State &state)
+{
+    vector<Expression **> exprs;
+    const Symbol *symbol;
+    Expression *expr;
+    Unary *unary;
+    Value value;
+
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr)
+	expressions(expr, exprs);
+    else
+	expressions(stmt, exprs);
+
+    for (auto slot : exprs) {
+	if ((unary = dynamic_cast<Increment *>(*slot)) == nullptr &&
+		(unary = dynamic_cast<Decrement *>(*slot)) == nullptr)
+	    continue;
+
+	if (tracked.count(symbol = identifier(unary->expr())) == 0)
+	    continue;
+
+	value = lookup(state, symbol);
+
+	if (unary != stmt || value.kind != CONSTANT)
+	    value.kind = VARYING;
+	else if (dynamic_cast<Increment *>(unary) != nullptr)
+	    value.constant = (unsigned) value.constant + 1;
+	else
+	    value.constant = (unsigned) value.constant - 1;
+
+	state.values[symbol] = value;
+    }
+}
+
+
+/*
+ * Function:	test (private)
+ *
+ * Description:	Return the value of the test of the given statement in the
+ *		given state, and record it.
+ */
+
+static Value test(Statement *stmt, Expression *expr, const State &state)
+{
+    Value value = evaluate(expr, state);
+
+
+    tests[stmt] = meet(tests[stmt], value);
+    return value;
+}
+
+
+/*
+ * Function:	taken (private)
+ *
+ * Description:	Return whether a branch on a test with the given value may
+ *		go the given way.  An undefined test may go either way.
+ */
+
+static bool taken(const Value &value, bool way)
+{
+    return value.kind != CONSTANT || (value.constant != 0) == way;
+}
+
+
+/*
+ * Function:	iterate (private)
+ *
+ * Description:	Return the state after the given loop in the given state,
+ *		visiting its body and increment until the state at the head
+ *		of the loop no longer changes.
+ */
+
+static State iterate(Statement *loop, Expression *expr, Statement *body,
+	Statement *incr, State state)
+{
+    State head, after, inside, out, breaks, next;
+    Value value;
+
+
+    head = state;
+
+    while (true) {
+	record(loop, head);
+	value = test(loop, expr, head);
+
+	after = head;
+	effects(loop, after);
+	inside = after;
+	inside.reachable = after.reachable && taken(value, true);
+
+	exits.push_back(State {false});
+	out = transfer(body, inside);
+
+	if (incr != nullptr)
+	    out = transfer(incr, out);
+
+	breaks = exits.back();
+	exits.pop_back();
+
+	next = meet(head, out);
+
+	if (same(next, head))
+	    break;
+
+	head = next;
+    }
+
+    after.reachable = after.reachable && taken(value, false);
+    return meet(after, breaks);
+}
+
+
+/*
+ * Function:	transfer (private)
+ *
+ * Description:	Return the state after the given statement, given the state
+ *		before it.
+ */
+
+static State transfer(Statement *stmt, State state)
+{
+    Assignment *assign;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+    State first, second, dispatched;
+    const Symbol *symbol;
+    Value value;
+    bool matched;
+
+
+    if (!state.reachable)
+	return state;
+
+    reached.insert(stmt);
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    state = transfer(child, state);
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr)
+	state = iterate(loop, loop->expr(), loop->stmt(), nullptr, state);
+
+    else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	state = transfer(iter->init(), state);
+	state = iterate(iter, iter->expr(), iter->stmt(), iter->incr(), state);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	record(cond, state);
+	value = test(cond, cond->expr(), state);
+	effects(cond, state);
+
+	first = state;
+	first.reachable = taken(value, true);
+	first = transfer(cond->thenStmt(), first);
+
+	second = state;
+	second.reachable = taken(value, false);
+
+	if (cond->elseStmt() != nullptr)
+	    second = transfer(cond->elseStmt(), second);
+
+	state = meet(first, second);
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	record(branch, state);
+	value = evaluate(branch->expr(), state);
+	effects(branch, state);
+
+	matched = false;
+
+	for (auto &section : branch->cases())
+	    for (auto constant : section.values)
+		if (value.kind == CONSTANT && value.constant == constant)
+		    matched = true;
+
+	exits.push_back(State {false});
+	second = State {false};
+
+	for (auto &section : branch->cases()) {
+	    dispatched = state;
+	    dispatched.reachable = value.kind != CONSTANT;
+
+	    for (auto constant : section.values)
+		if (value.kind == CONSTANT && value.constant == constant)
+		    dispatched.reachable = true;
+
+	    if (section.isDefault && !matched)
+		dispatched.reachable = true;
+
+	    second = transfer(section.stmt, meet(second, dispatched));
+	}
+
+	for (auto &section : branch->cases())
+	    if (section.isDefault)
+		matched = true;
+
+	if (!matched)
+	    second = meet(second, state);
+
+	state = meet(second, exits.back());
+	exits.pop_back();
+
+    } else if (dynamic_cast<Return *>(stmt) != nullptr) {
+	record(stmt, state);
+	state.reachable = false;
+
+    } else if (dynamic_cast<Break *>(stmt) != nullptr) {
+	exits.back() = meet(exits.back(), state);
+	state.reachable = false;
+
+    } else {
+	record(stmt, state);
+
+	if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	    value = evaluate(assign->right(), state);
+	    effects(stmt, state);
+
+	    if (tracked.count(symbol = identifier(assign->left())) > 0)
+		state.values[symbol] = value;
+
+	} else
+	    effects(stmt, state);
+    }
+
+    return state;
+}
+
+
+/*
+ * Function:	fold (private)
+ *
+ * Description:	Remove the statements within the given statement that are
+ *		never reached, and fold away each test with a known value.
+ */
+
+static void fold(Statement *&stmt)
+{
+    Statements stmts;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+    Value value;
+
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    if (reached.count(child) > 0) {
+		fold(child);
+		stmts.push_back(child);
+	    }
+
+	block->statements() = stmts;
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	value = tests[cond];
+
+	if (value.kind == CONSTANT) {
+	    if (value.constant != 0)
+		stmt = cond->thenStmt();
+	    else if (cond->elseStmt() != nullptr)
+		stmt = cond->elseStmt();
+	    else
+		stmt = new Block(new Scope(), Statements());
+
+	    branches ++;
+	    fold(stmt);
+
+	} else {
+	    fold(cond->thenStmt());
+
+	    if (cond->elseStmt() != nullptr)
+		fold(cond->elseStmt());
+	}
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr) {
+	value = tests[loop];
+
+	if (value.kind == CONSTANT && value.constant == 0) {
+	    stmt = new Block(new Scope(), Statements());
+	    branches ++;
+	} else
+	    fold(loop->stmt());
+
+    } else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	value = tests[iter];
+	fold(iter->init());
+
+	if (value.kind == CONSTANT && value.constant == 0) {
+	    stmt = iter->init();
+	    branches ++;
+
+	} else {
+	    fold(iter->stmt());
+	    fold(iter->incr());
+	}
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : branch->cases())
+	    if (reached.count(section.stmt) > 0)
+		fold(section.stmt);
+	    else
+		section.stmt = new Block(new Scope(), Statements());
+    }
+}
+
+
+/*
+ * Function:	evaluateConstant
+ *
+ * Description:	Return whether the given integer expression has a value
+ *		that is known without any variables, as for a constant
+ *		expression, and if so, its value.
+ */
+
+bool evaluateConstant(Expression *expr, int &value)
+{
+    Value result;
+    State state;
+
+
+    tracked.clear();
+    state.reachable = true;
+    result = evaluate(expr, state);
+
+    if (result.kind != CONSTANT)
+	return false;
+
+    value = result.constant;
+    return true;
+}
+
+
+/*
+ * Function:	evaluateConstants
+ *
+ * Description:	Propagate the constant values of the local variables within
+ *		the given function, and fold the tests and expressions whose
+ *		values are then known.
+ */
+
+void evaluateConstants(Function *function)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    Statement *body;
+    unsigned params;
+    int constant;
+    Value value;
+    State state;
+
+
+    tracked.clear();
+    tests.clear();
+    uses.clear();
+    reached.clear();
+    replaced = branches = evaluated = 0;
+
+    for (auto symbol : analyze(function).privates)
+	if (symbol->type() == Type(INT))
+	    tracked.insert(symbol);
+
+    const Symbols &symbols = function->body()->declarations()->symbols();
+    params = function->id()->type().parameters()->types.size();
+
+    for (unsigned i = 0; i < params; i ++)
+	state.values[symbols[i]] = {VARYING, 0};
+
+    body = function->body();
+    state.reachable = true;
+    transfer(body, state);
+    fold(body);
+
+
+    /* Replace the uses of the constant variables with their values. */
+
+    statements(body, stmts);
+
+    for (auto slot : stmts)
+	expressions(*slot, exprs);
+
+    for (auto slot : exprs)
+	if (uses.count(slot) > 0 && uses[slot].kind == CONSTANT) {
+	    *slot = literal(uses[slot].constant);
+	    replaced ++;
+	}
+
+
+    /* Replace the expressions whose operands are all constants. */
+
+    tracked.clear();
+    exprs.clear();
+
+    for (auto slot : stmts)
+	expressions(*slot, exprs);
+
+    for (auto slot : exprs)
+	if (!isConstant(*slot, constant) && (*slot)->type() == Type(INT)) {
+	    value = evaluate(*slot, State {true});
+
+	    if (value.kind == CONSTANT) {
+		*slot = literal(value.constant);
+		evaluated ++;
+	    }
+	}
+
+    count("variables replaced with constants", replaced);
+    count("conditional branches folded", branches);
+    count("expressions evaluated to constants", evaluated);
+}
@@ -0,0 +1,99 @@
+/*
+ * File:	folder.cpp
+ *
+ * Description:	This file contains the function definitions for replacing
+ *		const variables in Simple C with their values.
+ *
+ *		A const variable whose initializer is a single literal
+ *		always has that value, so each load of it may simply use
+ *		the literal instead, which the generator then uses as an
+ *		immediate operand.  Only integers and doubles are replaced,
+ *		since a character literal would change the type of the
+ *		expression.  The operand of an address expression must
+ *		still refer to the variable itself, as must the target of
+ *		the assignment that initializes a local variable.
+ */
+
+# include <set>
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+
+/*
+ * Function:	value (private)
+ *
+ * Description:	Return the literal to use for the given symbol, or a null
+ *		pointer if its value is not known.
+ */
+
+static Expression *value(const Symbol *symbol)
+{
+    const Type &type = symbol->type();
+    Expression *init;
+
+
+    if (!type.isConst() || !type.isScalar())
+	return nullptr;
+
+    if (symbol->initializer.size() != 1)
+	return nullptr;
+
+    init = symbol->initializer[0];
+
+    if (type == Type(INT) && dynamic_cast<Integer *>(init) != nullptr)
+	return init->clone();
+
+    if (type == Type(DOUBLE) && dynamic_cast<Real *>(init) != nullptr)
+	return init->clone();
+
+    if (type == Type(DOUBLE) && dynamic_cast<Integer *>(init) != nullptr)
+	return new Real(((Integer *) init)->value());
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	foldConstants
+ *
+ * Description:	Replace each load of a const variable within the given
+ *		function with its value, if known.
+ */
+
+void foldConstants(Function *function)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    set<Expression **> skipped;
+    Statement *body;
+    Expression *expr;
+    unsigned folded;
+
+
+    body = function->body();
+    statements(body, stmts);
+
+    for (auto slot : stmts) {
+	if (dynamic_cast<Assignment *>(*slot) != nullptr)
+	    skipped.insert(&((Assignment *) *slot)->left());
+
+	expressions(*slot, exprs);
+    }
+
+    for (auto slot : exprs)
+	if (dynamic_cast<Address *>(*slot) != nullptr)
+	    skipped.insert(&((Unary *) *slot)->expr());
+
+    folded = 0;
+
+    for (auto slot : exprs)
+	if (identifier(*slot) != nullptr && skipped.count(slot) == 0)
+	    if ((expr = value(identifier(*slot))) != nullptr) {
+		*slot = expr;
+		folded ++;
+	    }
+
+    count("const variables replaced with their values", folded);
+}
@@ -8,14 +8,21 @@
  *		- putting all the global declarations at the end
  */
 
+# include <algorithm>
 # include <cassert>
+# include <climits>
 # include <iostream>
 # include "generator.h"
 # include "machine.h"
+# include "optimizer.h"
 # include "Tree.h"
 # include "label.cpp"
 # include "string.h"
-# include <unordered_map>
+# include <cmath>
+# include <cstring>
+# include <map>
+# include <set>
+# include <sstream>
 # define FP(expr) ((expr)->type().isReal())
 # define BYTE(expr) ((expr)->type().size() == 1)
 
@@ -23,18 +30,28 @@ using namespace std;
 //static Label
 static int offset;
 static unsigned max_args;
-//unordered_map<string, Label> listLabels;
-std::unordered_map<int, std::string> listDoubles;
-std::unordered_map<int, std::string> listStrings;
-Label globalLabel;
+static bool leaf;
+static map<string, Label> strings;
+static map<unsigned long long, Label> reals;
 Label returnLabel;
+Label bodyLabel;
+static const Symbol *self;
 Label inLoop;
-bool stringLabel = false;
-
-bool leftDouble = false;
-bool rightDouble = false;
-
-int numberDouble = 0;
+static Label ramp;
+static bool ramped = false;
+static set<const Expression *> shared;
+static map<string, int> preserved;
+static Label counts;
+static ostringstream cold;
+static bool outlining;
+static bool omitFramePointer, divideByConstant, directArguments, branchLayout;
+
+static const unsigned TABLE_MINIMUM = 4;
+static const unsigned TABLE_DENSITY = 3;
+static const unsigned SEARCH_MINIMUM = 3;
+static const double COLD_PROBABILITY = 0.25;
+
+static const char *argumentRegisters[] = {"%eax", "%edx", "%ecx"};
 //list.insert({3, "tree");
 
 
@@ -61,6 +78,83 @@ static int align(int offset)
 }
 
 
+/*
+ * Function:	frame (private)
+ *
+ * Description:	Return the operand for the given offset in our frame, which
+ *		is relative to %ebp as usual.  If the frame pointer is
+ *		omitted, it is instead relative to %esp, which stays put
+ *		after the prologue since our frame has a fixed size.  The
+ *		parameters are then one register closer, since %ebp was not
+ *		saved between them and our frame.
+ */
+
+static string frame(int offset)
+{
+    string name;
+
+
+    if (!omitFramePointer)
+	return to_string(offset) + "(%ebp)";
+
+    if (offset > 0)
+	offset -= SIZEOF_REG;
+
+    name = self->name() + ".size";
+    return name + (offset < 0 ? "" : "+") + to_string(offset) + "(%esp)";
+}
+
+
+/*
+ * Function:	local (private)
+ *
+ * Description:	Return the operand for the given local variable, which is
+ *		either its register or its slot in our frame.
+ */
+
+static string local(const Symbol *symbol)
+{
+    if (!symbol->reg.empty())
+	return symbol->reg;
+
+    return frame(symbol->offset);
+}
+
+
+/*
+ * Function:	registerArguments
+ *
+ * Description:	Return the number of leading arguments to the given
+ *		function that are passed in registers rather than on the
+ *		stack.  Only a function with internal linkage, whose every
+ *		call we generate ourselves, is called this way, and only
+ *		integers and pointers are passed in registers.  These are
+ *		the caller-saved registers, which are free at any call.
+ *		None are used unless the register-arguments pass is run on
+ *		the function.
+ */
+
+unsigned registerArguments(const Symbol *function)
+{
+    const Parameters *params = function->type().parameters();
+    const unsigned limit = sizeof(argumentRegisters) / sizeof(char *);
+    unsigned count;
+
+
+    if (!function->internal || params->variadic)
+	return 0;
+
+    if (!scheduled("register-arguments", function->name()))
+	return 0;
+
+    for (count = 0; count < limit && count < params->types.size(); count ++)
+	if (params->types[count].isReal() || params->types[count].size() != 4)
+	    break;
+
+    return count;
+}
+
+
 /*
  * Function:	operator << (private)
  *
@@ -85,7 +179,10 @@ void Expression::operand(ostream &ostr) const
 {
 
    // assert(offset != 0);
-    ostr << offset << "(%ebp)";
+    if (outgoing)
+	ostr << offset << "(%esp)";
+    else
+	ostr << frame(offset);
 }
 
 
@@ -97,10 +194,10 @@ void Expression::operand(ostream &ostr) const
 
 void Identifier::operand(ostream &ostr) const
 {
-    if (_symbol->offset == 0)
+    if (_symbol->offset == 0 && _symbol->reg.empty())
 	ostr << global_prefix << _symbol->name();
     else
-	ostr << _symbol->offset << "(%ebp)";
+	ostr << local(_symbol);
 }
 
 
@@ -116,31 +213,270 @@ void Integer::operand(ostream &ostr) const
 }
 
 
+/*
+ * Function:	String::operand
+ *
+ * Description:	Write a string literal as an operand to the specified
+ *		stream, which is its label in the literal pool.  Equal
+ *		strings share a label throughout the translation unit.
+ */
+
+void String::operand(ostream &ostr) const
+{
+    if (strings.count(_value) == 0)
+	strings[_value] = Label();
+
+    ostr << strings[_value];
+}
+
+
+/*
+ * Function:	Real::operand
+ *
+ * Description:	Write a real literal as an operand to the specified stream,
+ *		which is its label in the literal pool.  Literals are
+ *		shared by their bits rather than their spelling, so "1.0"
+ *		and "1e0" are the same but "0.0" and "-0.0" are not.
+ */
+
+void Real::operand(ostream &ostr) const
+{
+    double value = strtod(_value.c_str(), NULL);
+    unsigned long long bits;
+
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (reals.count(bits) == 0)
+	reals[bits] = Label();
+
+    ostr << reals[bits];
+}
+
+
+/*
+ * Function:	load (private)
+ *
+ * Description:	Generate code to push the value of the given expression
+ *		onto the floating-point stack.  The constants zero and one
+ *		have instructions of their own and need not be loaded from
+ *		the literal pool.
+ */
+
+static void load(Expression *expr)
+{
+    Real *real;
+    double value;
+
+
+    if ((real = dynamic_cast<Real *>(strip(expr))) != nullptr) {
+	value = strtod(real->value().c_str(), NULL);
+
+	if (value == 0 && !signbit(value)) {
+	    cout << "\tfldz" << endl;
+	    return;
+	}
+
+	if (value == 1) {
+	    cout << "\tfld1" << endl;
+	    return;
+	}
+    }
+
+    cout << "\tfldl\t" << expr << endl;
+}
+
+
+/*
+ * Function:	Common::operand
+ *
+ * Description:	Write a common subexpression as an operand to the specified
+ *		stream, which is the operand of the earlier expression.
+ */
+
+void Common::operand(ostream &ostr) const
+{
+    _expr->operand(ostr);
+}
+
+
+/*
+ * Function:	release (private)
+ *
+ * Description:	Generate code to release our stack frame before returning
+ *		or jumping to another function, first restoring any
+ *		registers in which our variables were kept.
+ */
+
+static void release()
+{
+    for (auto &slot : preserved)
+	cout << "\tmovl\t" << frame(slot.second) << ", " << slot.first << endl;
+
+    if (!omitFramePointer) {
+	cout << "\tmovl\t%ebp, %esp" << endl;
+	cout << "\tpopl\t%ebp" << endl;
+    } else
+	cout << "\taddl\t$" << self->name() << ".size, %esp" << endl;
+}
+
+
+/*
+ * Function:	tally (private)
+ *
+ * Description:	Generate code to increment the given counter of the given
+ *		statement in an instrumented build.  The counts follow the
+ *		number of counters at the start of the profile.
+ */
+
+static void tally(const Statement *stmt, unsigned which)
+{
+    if (!profileOutput.empty() && stmt->counter >= 0) {
+	cout << "\tincl\t" << counts << "+";
+	cout << (stmt->counter + which + 1) * SIZEOF_INT << endl;
+    }
+}
+
+
+/*
+ * Function:	outline (private)
+ *
+ * Description:	Generate code for the given statement, which the profile
+ *		shows is never executed, at the end of the function where
+ *		it is out of the way.  The code starts at the given label
+ *		and jumps back to the other label.
+ */
+
+static void outline(Statement *stmt, const Label &start, const Label &back)
+{
+    streambuf *saved;
+
+
+    saved = cout.rdbuf(cold.rdbuf());
+    outlining = true;
+
+    cout << start << ":" << endl;
+    stmt->generate();
+
+    if (completes(stmt))
+	cout << "\tjmp\t" << back << endl;
+
+    outlining = false;
+    cout.rdbuf(saved);
+}
+
+
+/*
+ * Function:	calls (private)
+ *
+ * Description:	Return whether evaluating the given expression makes any
+ *		function calls, which would overwrite the outgoing argument
+ *		area.
+ */
+
+static bool calls(Expression *expr)
+{
+    vector<Expression **> slots;
+
+
+    expressions(expr, slots);
+
+    for (auto slot : slots)
+	if (dynamic_cast<Call *>(*slot) != nullptr)
+	    return true;
+
+    return false;
+}
+
+
+/*
+ * Function:	direct (private)
+ *
+ * Description:	Return whether the given argument can compute its value
+ *		directly into its outgoing slot.  It must be an expression
+ *		that computes its value into a temporary of its own, and no
+ *		common subexpression may refer to that temporary later.
+ */
+
+static bool direct(Expression *arg)
+{
+    if (!directArguments)
+	return false;
+
+    if (dynamic_cast<Identifier *>(arg) != nullptr)
+	return false;
+
+    if (dynamic_cast<Integer *>(arg) != nullptr)
+	return false;
+
+    if (dynamic_cast<Real *>(arg) != nullptr)
+	return false;
+
+    if (dynamic_cast<String *>(arg) != nullptr)
+	return false;
+
+    if (dynamic_cast<Common *>(arg) != nullptr)
+	return false;
+
+    return shared.count(arg) == 0;
+}
+
+
 /*
  * Function:	Call::generate
  *
- * Description:	Generate code for a function call expression.
+ * Description:	Generate code for a function call expression.  Where we
+ *		can, each argument is computed directly into its slot in
+ *		the outgoing argument area rather than into a temporary,
+ *		which is safe as long as no later argument makes a call.
+ *		The leading arguments to a function with internal linkage
+ *		may be passed in registers instead.  A double is returned
+ *		on the top of the floating-point stack, which must be
+ *		popped even if the value is discarded.
  */
 
 void Call::generate()
 {
-    unsigned offset, size;
+    unsigned offset, size, last, passed;
 
 
     /* Generate code for all arguments first. */
-	//assignTemp(this);
-    for (auto arg : _args)
-	arg->generate();
+
+    last = 0;
+    passed = registerArguments(_id);
+
+    for (unsigned i = 0; i < _args.size(); i ++)
+	if (calls(_args[i]))
+	    last = i + 1;
+
+    offset = 0;
+
+    for (unsigned i = 0; i < _args.size(); i ++) {
+	if (i >= passed && i + 1 >= last && direct(_args[i])) {
+	    _args[i]->offset = offset;
+	    _args[i]->outgoing = true;
+	}
+
+	_args[i]->generate();
+
+	if (i >= passed)
+	    offset += _args[i]->type().size();
+    }
 
 
-    /* Move the arguments onto the stack. */
+    /* Move the remaining arguments onto the stack. */
 
     offset = 0;
 	assignTemp(this);
-    for (auto arg : _args) {
-	if (FP(arg)) {
-	    cout << "\tfldl\t" << arg << endl;
+    for (unsigned i = passed; i < _args.size(); i ++) {
+	Expression *arg = _args[i];
+
+	if (arg->outgoing) {
+	} else if (FP(arg)) {
+	    load(arg);
 	    cout << "\tfstpl\t" << offset << "(%esp)" << endl;
+	} else if (dynamic_cast<Integer *>(arg) != nullptr) {
+	    cout << "\tmovl\t" << arg << ", " << offset << "(%esp)" << endl;
 	} else {
 	    cout << "\tmovl\t" << arg << ", %eax" << endl;
 	    cout << "\tmovl\t%eax, " << offset << "(%esp)" << endl;
@@ -154,22 +490,51 @@ void Call::generate()
 	max_args = offset;
 
 
-    /* Make the function call. */
+    /* Load the arguments passed in registers, now that the arguments on
+       the stack no longer need them as scratch. */
 
+    for (unsigned i = 0; i < passed; i ++)
+	cout << "\tmovl\t" << _args[i] << ", " << argumentRegisters[i] << endl;
 
-    cout << "\tcall\t" << global_prefix << _id->name() << endl;
-	cout << "\tmovl\t%eax, " << this << endl;
-	//assignTemp(this);
-    /* Save the return value */
 
-/*# if 0
-    assigntemp(this);
+    /* Make a tail call by replacing our arguments with the new ones.  If
+       any registers are loaded, the stack arguments are copied without
+       a scratch register. */
+
+    tally(this, 0);
+
+    if (tail) {
+	for (unsigned i = 0; i < offset; i += SIZEOF_REG)
+	    if (passed == 0) {
+		cout << "\tmovl\t" << i << "(%esp), %eax" << endl;
+		cout << "\tmovl\t%eax, " << frame(i + SIZEOF_REG * 2) << endl;
+	    } else {
+		cout << "\tpushl\t" << i << "(%esp)" << endl;
+		cout << "\tpopl\t" << frame(i + SIZEOF_REG * 2) << endl;
+	    }
+
+	if (_id == self)
+	    cout << "\tjmp\t" << bodyLabel << endl;
+	else {
+	    release();
+	    cout << "\tjmp\t" << global_prefix << _id->name() << endl;
+	}
+
+	return;
+    }
+
+
+    /* Make the function call and save the return value. */
+
+    cout << "\tcall\t" << global_prefix << _id->name() << endl;
+    leaf = false;
 
-    if (FP(this))
+    if (FP(this) && discard)
+	cout << "\tfstp\t%st(0)" << endl;
+    else if (FP(this))
 	cout << "\tfstpl\t" << this << endl;
-    else
+    else if (!discard)
 	cout << "\tmovl\t%eax, " << this << endl;
-# endif*/
 }
 
 
@@ -196,67 +561,272 @@ void Block::generate()
 
 /*
  * Function:	Function::generate
+ *
+ * Description:	Generate code for this function.  We first find the
+ *		expressions to which common subexpressions refer, since
+ *		their values must stay in our own frame, and then the calls
+ *		whose values are discarded, which excludes any call whose
+ *		value a later common subexpression reuses.  Unless the frame
+ *		pointer is kept, our frame is addressed relative to %esp,
+ *		and a leaf function with an empty frame needs no prologue
+ *		or epilogue at all.  Each register that holds a variable is
+ *		saved in our frame, and each parameter that lives in a
+ *		register or is passed in one is moved to its home at the
+ *		start of the body, which a recursive tail call jumps back to
+ *		after storing its arguments.
  */
 
 void Function::generate()
 {
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    Statement *body;
+    SymbolSet symbols;
+    ostringstream code;
+    streambuf *saved;
+    unsigned passed;
+    bool empty;
+
+
+    body = _body;
+    statements(body, stmts);
+    shared.clear();
+    omitFramePointer = scheduled("omit-frame-pointer", _id->name());
+    divideByConstant = scheduled("divide-by-constant", _id->name());
+    directArguments = scheduled("direct-arguments", _id->name());
+    branchLayout = scheduled("branch-layout", _id->name());
+
+    for (auto slot : stmts)
+	expressions(*slot, exprs);
+
+    for (auto slot : exprs)
+	if (dynamic_cast<Common *>(*slot) != nullptr)
+	    shared.insert(((Common *) *slot)->expr());
+
+    for (auto slot : stmts)
+	if (dynamic_cast<Call *>(*slot) != nullptr)
+	    if (shared.count((Call *) *slot) == 0)
+		((Call *) *slot)->discard = directArguments;
+
     max_args = 0;
     offset = SIZEOF_REG * 2;
     allocate(offset);
 
+    preserved.clear();
+    declarations(body, symbols);
 
-    /* Generate our prologue. */
+    for (auto symbol : symbols)
+	if (!symbol->reg.empty())
+	    preserved[symbol->reg] = 0;
 
-    cout << global_prefix << _id->name() << ":" << endl;
-    cout << "\tpushl\t%ebp" << endl;
-    cout << "\tmovl\t%esp, %ebp" << endl;
-    cout << "\tsubl\t$" << _id->name() << ".size, %esp" << endl;
+    for (auto &slot : preserved) {
+	offset -= SIZEOF_REG;
+	slot.second = offset;
+    }
+
+
+    /* Generate the body of this function, holding it back until we know
+       the size of our frame. */
+
+    self = _id;
+    leaf = true;
+    cold.str("");
+    saved = cout.rdbuf(code.rdbuf());
+    cout << bodyLabel << ":" << endl;
+
+    passed = registerArguments(_id);
 
+    for (unsigned i = 0; i < _id->type().parameters()->types.size(); i ++) {
+	const Symbol *symbol = _body->declarations()->symbols()[i];
 
-    /* Generate the body of this function. */
+	if (i < passed) {
+	    cout << "\tmovl\t" << argumentRegisters[i] << ", ";
+	    cout << local(symbol) << endl;
+	} else if (!symbol->reg.empty()) {
+	    cout << "\tmovl\t" << frame(symbol->offset) << ", ";
+	    cout << symbol->reg << endl;
+	}
+    }
 
     _body->generate();
+    cout.rdbuf(saved);
 
 
-    /* Compute the proper stack frame size. */
+    /* Compute the proper stack frame size.  A leaf function need not
+       keep the stack aligned, since it calls nobody who cares. */
 
     offset -= max_args;
-    offset -= align(offset - SIZEOF_REG * 2);
 
+    if (!omitFramePointer)
+	offset -= align(offset - SIZEOF_REG * 2);
+    else if (!leaf)
+	offset -= align(offset - SIZEOF_REG);
 
-    /* Generate our epilogue. */
-	//Label exit;
-	cout << returnLabel << ":" << endl;
-	
+    empty = omitFramePointer && offset == 0;
+
+
+    /* Generate our prologue, the body, and our epilogue. */
+
+    cout << global_prefix << _id->name() << ":" << endl;
+
+    if (!omitFramePointer) {
+	cout << "\tpushl\t%ebp" << endl;
+	cout << "\tmovl\t%esp, %ebp" << endl;
+    }
+
+    if (!empty)
+	cout << "\tsubl\t$" << _id->name() << ".size, %esp" << endl;
+
+    for (auto &slot : preserved)
+	cout << "\tmovl\t" << slot.first << ", " << frame(slot.second) << endl;
+
+    cout << code.str();
+    cout << returnLabel << ":" << endl;
+
+    if (!empty)
+	release();
 
-    cout << "\tmovl\t%ebp, %esp" << endl;
-    cout << "\tpopl\t%ebp" << endl;
     cout << "\tret" << endl << endl;
+    cout << cold.str();
 
     cout << "\t.set\t" << _id->name() << ".size, " << -offset << endl;
-    cout << "\t.globl\t" << global_prefix << _id->name() << endl << endl;
-	
-	cout << ".data" << endl;
+    if (!_id->internal)
+	cout << "\t.globl\t" << global_prefix << _id->name() << endl;
+
+    cout << endl;
 
-	for(auto &x: listStrings)
-	{
-		cout << ".L" << x.first << ":\t.asciz\t";
-		cout << "\"" << x.second << "\"" << endl;
-	}
-	for(auto &x : listDoubles)
-	{
-		cout << ".L" << x.first << ":\t.double\t" << x.second << endl;
-	}
 	returnLabel = Label();
-	listStrings.clear();
-	listDoubles.clear();
+	bodyLabel = Label();
+}
+
+
+/*
+ * Function:	generateProfile (private)
+ *
+ * Description:	Generate the counters of an instrumented build, and a
+ *		function run when the program exits that writes them to the
+ *		profile file, replacing any earlier profile.
+ */
+
+static void generateProfile()
+{
+    unsigned size = (counters() + 1) * SIZEOF_INT;
+    Label writer, done;
+
+
+    if (strings.count(profileOutput) == 0)
+	strings[profileOutput] = Label();
+
+    cout << "\t.data" << endl;
+    cout << "\t.align\t" << SIZEOF_INT << endl;
+    cout << counts << ":\t.long\t" << counters() << endl;
+    cout << "\t.zero\t" << size - SIZEOF_INT << endl;
+
+    cout << "\t.text" << endl;
+    cout << writer << ":" << endl;
+    cout << "\tsubl\t$28, %esp" << endl;
+    cout << "\tmovl\t$" << strings[profileOutput] << ", 0(%esp)" << endl;
+    cout << "\tmovl\t$" << PROFILE_FLAGS << ", 4(%esp)" << endl;
+    cout << "\tmovl\t$0644, 8(%esp)" << endl;
+    cout << "\tcall\t" << global_prefix << "open" << endl;
+    cout << "\ttestl\t%eax, %eax" << endl;
+    cout << "\tjs\t" << done << endl;
+    cout << "\tmovl\t%eax, 12(%esp)" << endl;
+    cout << "\tmovl\t%eax, 0(%esp)" << endl;
+    cout << "\tmovl\t$" << counts << ", 4(%esp)" << endl;
+    cout << "\tmovl\t$" << size << ", 8(%esp)" << endl;
+    cout << "\tcall\t" << global_prefix << "write" << endl;
+    cout << "\tmovl\t12(%esp), %eax" << endl;
+    cout << "\tmovl\t%eax, 0(%esp)" << endl;
+    cout << "\tcall\t" << global_prefix << "close" << endl;
+    cout << done << ":" << endl;
+    cout << "\taddl\t$28, %esp" << endl;
+    cout << "\tret" << endl;
+
+    cout << "\t" << PROFILE_SECTION << endl;
+    cout << "\t.align\t" << SIZEOF_PTR << endl;
+    cout << "\t.long\t" << writer << endl;
+}
+
+
+/*
+ * Function:	generateData (private)
+ *
+ * Description:	Generate the storage for a global variable along with its
+ *		initializer, which is a list of literals.  A const variable
+ *		is placed in read-only storage.  Any elements without a
+ *		literal are zero.
+ */
+
+static void generateData(const Symbol *symbol)
+{
+    const Type &type = symbol->type();
+    Type element(type.specifier(), type.indirection());
+    unsigned long long bits;
+    unsigned size;
+    double value;
+    String *str;
+
+
+    if (type.isConst())
+	cout << "\t.section\t.rodata" << endl;
+    else
+	cout << "\t.data" << endl;
+
+    cout << "\t.align\t" << element.size() << endl;
+
+    if (!symbol->internal)
+	cout << "\t.globl\t" << global_prefix << symbol->name() << endl;
+
+    cout << global_prefix << symbol->name() << ":" << endl;
+    size = 0;
+
+    for (auto expr : symbol->initializer) {
+	if ((str = dynamic_cast<String *>(expr)) != nullptr) {
+	    if (element.isPointer()) {
+		cout << "\t.long\t" << expr << endl;
+		size += element.size();
+	    } else {
+		cout << "\t.ascii\t\"" << escapeString(str->value());
+		cout << "\"" << endl;
+		size += str->value().size();
+	    }
+
+	} else if (element.isReal()) {
+	    if (dynamic_cast<Real *>(expr) != nullptr)
+		value = strtod(((Real *) expr)->value().c_str(), NULL);
+	    else
+		value = strtod(((Integer *) expr)->value().c_str(), NULL);
+
+	    memcpy(&bits, &value, sizeof(bits));
+	    cout << "\t.quad\t0x" << hex << bits << dec << endl;
+	    size += element.size();
+
+	} else {
+	    cout << (element.size() == 1 ? "\t.byte\t" : "\t.long\t");
+	    cout << ((Integer *) expr)->value() << endl;
+	    size += element.size();
+	}
+    }
+
+    if (size < type.size())
+	cout << "\t.zero\t" << type.size() - size << endl;
 }
 
 
 /*
  * Function:	generateGlobals
  *
- * Description:	Generate code for any global variable declarations.
+ * Description:	Generate code for any global variable declarations and
+ *		for the literal pool of the translation unit.  A static
+ *		variable is local to the translation unit, and a variable
+ *		with an initializer or that is const gets storage of its
+ *		own rather than being a common symbol.  The pool is
+ *		placed in mergeable read-only sections so that the linker
+ *		can also share literals between translation units.  A
+ *		string containing a null character cannot be merged, since
+ *		the linker would treat it as two strings.  The counters of
+ *		an instrumented build are generated here as well.
  */
 
 void generateGlobals(Scope *scope)
@@ -264,10 +834,53 @@ void generateGlobals(Scope *scope)
     const Symbols &symbols = scope->symbols();
 
     for (auto symbol : symbols)
-	if (!symbol->type().isFunction()) {
-	    cout << "\t.comm\t" << global_prefix << symbol->name() << ", ";
+	if (symbol->type().isFunction())
+	    continue;
+
+	else if (!symbol->initializer.empty() || symbol->type().isConst())
+	    generateData(symbol);
+
+	else {
+	    cout << (symbol->internal ? "\t.lcomm\t" : "\t.comm\t");
+	    cout << global_prefix << symbol->name() << ", ";
 	    cout << symbol->type().size() << endl;
 	}
+
+    if (!profileOutput.empty() && counters() > 0)
+	generateProfile();
+
+    if (!strings.empty()) {
+	cout << "\t.section\t.rodata.str1.1,\"aMS\",@progbits,1" << endl;
+
+	for (auto &entry : strings)
+	    if (entry.first.find('\0') == string::npos) {
+		cout << entry.second << ":\t.asciz\t\"";
+		cout << escapeString(entry.first) << "\"" << endl;
+	    }
+
+	for (auto &entry : strings)
+	    if (entry.first.find('\0') != string::npos) {
+		cout << "\t.section\t.rodata" << endl;
+		cout << entry.second << ":\t.asciz\t\"";
+		cout << escapeString(entry.first) << "\"" << endl;
+	    }
+    }
+
+    if (!reals.empty()) {
+	cout << "\t.section\t.rodata.cst8,\"aM\",@progbits,8" << endl;
+	cout << "\t.align\t8" << endl;
+
+	for (auto &entry : reals) {
+	    cout << entry.second << ":\t.quad\t0x" << hex << entry.first;
+	    cout << dec << endl;
+	}
+    }
+
+    if (ramped) {
+	cout << "\t.section\t.rodata.cst16,\"aM\",@progbits,16" << endl;
+	cout << "\t.align\t" << SIZEOF_VECTOR << endl;
+	cout << ramp << ":\t.long\t0, 1, 2, 3" << endl;
+    }
 }
 
 
@@ -298,26 +911,19 @@ void Assignment::generate()
 		_left->generate();	
 		if(_right->type().isReal())
 		{
-			//listDoubles
-			if(stringLabel == true)
-			{
-				//cout << "\tleal\t" << globalLabel << ", %eax" << endl;
-			   	cout << "\tfldl\t" << globalLabel << endl;
-				cout << "\tfstpl\t" << _left << endl;
-				stringLabel = false;
-			}
-			else
-			{
-				cout << "\tfldl\t" << _right << endl;
-			
-				cout << "\tfstpl\t" << _left << endl;
-			}
+			load(_right);
+			cout << "\tfstpl\t" << _left << endl;
 		}
 		else if(BYTE(_right))
 		{
 			cout << "\tmovb\t" << _right << ", %al" << endl;
 			cout << "\tmovb\t%al, " << _left << endl;
 		}
+		else if(identifier(_left) != nullptr &&
+			!identifier(_left)->reg.empty())
+		{
+			cout << "\tmovl\t" << _right << ", " << _left << endl;
+		}
 		else
 		{
 			cout << "\tmovl\t" << _right << ", %eax" << endl;
@@ -334,24 +940,9 @@ void Assignment::generate()
 		//cout << "hello3" << endl;
 		if(_right->type().isReal())
 		{
-			if(stringLabel == true)
-			{
-				cout << "\tfldl\t" << globalLabel << endl;
-				//cout << "\tmovl\t" << child << ", %eax" << endl;
-				//cout << "\tfstpl\t(%eax)" << endl;
-				cout << "\tfstpl\t" << child << endl;		
-				//cout << "here" << endl;
-				stringLabel = false;
-			}
-			else
-			{
-				//cout << "U" << endl;	
-				cout << "\tfldl\t" << _right << endl;
-				cout << "\tmovl\t" << child << ", %eax" << endl;
-				cout << "\tfstpl\t(%eax)" << endl;		
-				//cout << "\tfstpl\t" << child << endl;		
-				//cout << "Here" << endl;
-			}
+			load(_right);
+			cout << "\tmovl\t" << child << ", %eax" << endl;
+			cout << "\tfstpl\t(%eax)" << endl;		
 		}
 		else if(BYTE(_right))
 		{
@@ -373,11 +964,21 @@ void Assignment::generate()
 		cout << "\tmovl\t%eax, (%ecx)" << endl;
 		//cout << "\tmovl\t%ecx, " <*/
 	}
-	//stringLabel = false;
 }
 
+/*
+ * Function:	assignTemp
+ *
+ * Description:	Allocate a temporary in our frame for the value of the
+ *		given expression, unless it is an argument that is being
+ *		computed directly into its outgoing slot.
+ */
+
 void assignTemp(Expression *expr)
 {
+	if (expr->outgoing)
+	    return;
+
 	offset -= expr->type().size();
 	expr->offset = offset;
 }
@@ -410,7 +1011,7 @@ void Multiply::generate()
 	
 	if(FP(this))
 	{
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfmull\t" << _right << endl;
 		cout << "\tfstpl\t" << this << endl;
 
@@ -425,86 +1026,192 @@ void Multiply::generate()
 
 }
 
-void Divide::generate()
+/*
+ * Function:	divisor (private)
+ *
+ * Description:	Return whether the given expression is a constant divisor
+ *		that can be divided by without a divide instruction, and if
+ *		so, its value.  Division by zero and by the most negative
+ *		integer are left to the hardware, as is every division if
+ *		the divide-by-constant pass is off.
+ */
+
+static bool divisor(Expression *expr, int &value)
 {
-	cout << endl;
+    if (!divideByConstant || !isConstant(strip(expr), value))
+	return false;
 
+    return value != 0 && value != INT_MIN;
+}
 
-	_left->generate();
-	_right->generate();
-	//cout << "k" << endl;
-	assignTemp(this);	
-	
-	if(FP(this))
-	{
-		int p;
-		//cout << _left->offset << endl;
-		//cout << _right->offset << endl;
-		if(_left->offset == 0)
-		{
-			stringLabel = true;
-			leftDouble = true;	
-			//p++;
-		}
-		else
-		{
-			stringLabel = false;
-			leftDouble = false;
-		}
-		if(_right->offset == 0)
-		{
-			rightDouble = true;
-		}
-		else
-		{
-			rightDouble = false;
-		}
-		p = 0;
-		for(auto &a : listDoubles)
-		{
-			if(p < a.first)
-			{
-				p = a.first;
-			}
-		}
-		//cout << _left << endl;
-		//cout << _right << endl;
-		if(leftDouble == true && rightDouble == true)
-		{
-			//cout << "leal
-			//cout << "here" << endl;
 
-			cout << "\tfldl\t" << _left << endl;
-			cout << "\tfdivl\t" << _right << endl;
-			cout << "\tfstpl\t" << this << endl;
-		}
-		else if(leftDouble == false && rightDouble == true)
-		{
-			//cout << "here2" << endl;
-			cout << "\tfldl\t" << _left << endl;
-			cout << "\tfdivl\t.L" << p << endl;
-			cout << "\tfstpl\t" << this << endl;
-		
-		}
-		else if(leftDouble == true && rightDouble == false)
-		{
+/*
+ * Function:	magic (private)
+ *
+ * Description:	Compute the magic multiplier and shift for signed division
+ *		by the given divisor, which is not -1, 0, or 1, following
+ *		Granlund and Montgomery as presented in Hacker's Delight:
+ *		the quotient is the high word of the product of the dividend
+ *		and the multiplier, shifted right.
+ */
+
+static void magic(int divisor, int &multiplier, unsigned &shift)
+{
+    const unsigned two31 = 0x80000000;
+    unsigned ad, anc, delta, q1, r1, q2, r2, t;
+    unsigned p;
+
+
+    ad = divisor < 0 ? -(unsigned) divisor : divisor;
+    t = two31 + ((unsigned) divisor >> 31);
+    anc = t - 1 - t % ad;
+    p = 31;
+    q1 = two31 / anc;
+    r1 = two31 - q1 * anc;
+    q2 = two31 / ad;
+    r2 = two31 - q2 * ad;
+
+    do {
+	p ++;
+	q1 = 2 * q1;
+	r1 = 2 * r1;
+
+	if (r1 >= anc) {
+	    q1 ++;
+	    r1 -= anc;
+	}
+
+	q2 = 2 * q2;
+	r2 = 2 * r2;
+
+	if (r2 >= ad) {
+	    q2 ++;
+	    r2 -= ad;
+	}
+
+	delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    multiplier = q2 + 1;
+
+    if (divisor < 0)
+	multiplier = -multiplier;
+
+    shift = p - 32;
+}
+
+
+/*
+ * Function:	quotient (private)
+ *
+ * Description:	Generate code to divide %eax by the given constant divisor,
+ *		leaving the quotient in %eax and the dividend in %ecx.  A
+ *		power of two is divided by a shift, after adding one less
+ *		than the divisor to a negative dividend so that we round
+ *		toward zero.  Any other divisor uses a multiply-high by its
+ *		magic number, and the sign bit of the result is added to
+ *		round toward zero.
+ */
+
+static void quotient(int divisor)
+{
+    unsigned ad, shift;
+    int multiplier;
+
+
+    cout << "\tmovl\t%eax, %ecx" << endl;
+    ad = divisor < 0 ? -(unsigned) divisor : divisor;
+
+    if ((ad & (ad - 1)) == 0) {
+	for (shift = 0; (1u << shift) < ad; shift ++)
+	    continue;
+
+	if (shift > 0) {
+	    cout << "\tcltd" << endl;
+	    cout << "\tshrl\t$" << 32 - shift << ", %edx" << endl;
+	    cout << "\taddl\t%edx, %eax" << endl;
+	    cout << "\tsarl\t$" << shift << ", %eax" << endl;
+	}
+
+	if (divisor < 0)
+	    cout << "\tnegl\t%eax" << endl;
+
+	return;
+    }
+
+    magic(divisor, multiplier, shift);
+    cout << "\tmovl\t$" << multiplier << ", %edx" << endl;
+    cout << "\timull\t%edx" << endl;
+
+    if (divisor > 0 && multiplier < 0)
+	cout << "\taddl\t%ecx, %edx" << endl;
+    else if (divisor < 0 && multiplier > 0)
+	cout << "\tsubl\t%ecx, %edx" << endl;
+
+    if (shift > 0)
+	cout << "\tsarl\t$" << shift << ", %edx" << endl;
+
+    cout << "\tmovl\t%edx, %eax" << endl;
+    cout << "\tshrl\t$31, %eax" << endl;
+    cout << "\taddl\t%edx, %eax" << endl;
+}
+
+
+/*
+ * Function:	exact (private)
+ *
+ * Description:	Generate code to divide %eax by the given size, which is
+ *		known to divide it exactly, as for the difference of two
+ *		pointers.  The power of two in the size is divided by a
+ *		shift and the odd part by multiplying by its inverse modulo
+ *		2^32, with no correction needed since there is no remainder.
+ */
+
+static void exact(unsigned size)
+{
+    unsigned shift, inverse;
+
+
+    for (shift = 0; size % 2 == 0; shift ++)
+	size /= 2;
+
+    if (shift > 0)
+	cout << "\tsarl\t$" << shift << ", %eax" << endl;
+
+    if (size > 1) {
+	inverse = size;
+
+	for (unsigned i = 0; i < 4; i ++)
+	    inverse *= 2 - size * inverse;
 
-			//cout << "here" << endl;
+	cout << "\timull\t$" << (int) inverse << ", %eax" << endl;
+    }
+}
 
-			cout << "\tfldl\t" << globalLabel << endl;
-			cout << "\tfdivl\t" << _right << endl;
-			cout << "\tfstpl\t" << this << endl;
-		
-		}
-		else
-		{
-			cout << "\tfldl\t" << _left << endl;
-			cout << "\tfdivl\t" << _right << endl;
-			//cout << "\tcltd" << endl;
-			//cout << "\tfdivp\t" << endl;
-			cout << "\tfstpl\t" << this << endl;
-		}
+
+void Divide::generate()
+{
+	int value;
+
+	cout << endl;
+
+
+	_left->generate();
+	_right->generate();
+	assignTemp(this);	
+	
+	if(FP(this))
+	{
+		load(_left);
+		cout << "\tfdivl\t" << _right << endl;
+		cout << "\tfstpl\t" << this << endl;
 	}	
+	else if(divisor(_right, value))
+	{
+		cout << "\tmovl\t" << _left << ", %eax" << endl;
+		quotient(value);
+		cout << "\tmovl\t%eax, " << this << endl;
+	}
 	else
 	{
 		cout << "\tmovl\t" << _left << ", %eax" << endl;
@@ -513,18 +1220,14 @@ void Divide::generate()
 		cout << "\tidivl\t" << "%ecx" << endl;
 		cout << "\tmovl\t%eax, " << this << endl;
 	}
-
-
-stringLabel = false;
-
-
-
 }
 
 
 
 void Remainder::generate()
 {
+	int value;
+
 	cout << endl;
 
 
@@ -533,6 +1236,15 @@ void Remainder::generate()
 	assignTemp(this);	
 	
 	cout << "\tmovl\t" << _left << ", %eax" << endl;
+
+	if(divisor(_right, value))
+	{
+		quotient(value);
+		cout << "\timull\t$" << value << ", %eax" << endl;
+		cout << "\tsubl\t%eax, %ecx" << endl;
+		cout << "\tmovl\t%ecx, " << this << endl;
+		return;
+	}
 	
 	cout << "\tmovl\t%eax, %edx" << endl;
 	cout << "\tmovl\t" << _right << ", %ecx" << endl;
@@ -558,7 +1270,7 @@ void Add::generate()
 	
 	if(_left->type().isReal() && _right->type().isReal())
 	{
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		//cout << "\tmovl\t" << _right << ", %eax" << endl;
 
 		cout << "\tfaddl\t" << _right << endl;
@@ -617,7 +1329,7 @@ void Subtract::generate()
 	
 	if(_left->type().isReal() && _right->type().isReal())
 	{
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfsubl\t" << _right << endl;
 		cout << "\tfstpl\t" << this << endl;
 	}
@@ -649,9 +1361,15 @@ void Subtract::generate()
 	
 		cout << "\tmovl\t" << _left << ", %eax" << endl;
 		cout << "\tsubl\t" << _right << ", %eax" << endl;
-		cout << "\tmovl\t$" << scaleResult << ", %ecx" << endl;
-		cout << "\tcltd\t" << endl;
-		cout << "\tidivl\t%ecx" << endl;
+
+		if (divideByConstant)
+		    exact(scaleResult);
+		else {
+		    cout << "\tmovl\t$" << scaleResult << ", %ecx" << endl;
+		    cout << "\tcltd\t" << endl;
+		    cout << "\tidivl\t%ecx" << endl;
+		}
+
 		cout << "\tmovl\t%eax, " << this << endl;	
 	}
 	else
@@ -676,7 +1394,7 @@ void LessThan::generate()
 	if(FP(this))
 	{
 
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfcompl\t" << _right << endl;
 		cout << "\tfnstsw\t%eax" << endl;
 		cout << "\tsahf\t" << endl;
@@ -714,7 +1432,7 @@ void GreaterThan::generate()
 	if(FP(this))
 	{
 
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfcompl\t" << _right << endl;
 		cout << "\tfnstsw\t%eax" << endl;
 		cout << "\tsahf\t" << endl;
@@ -757,7 +1475,7 @@ _left->generate();
 	if(FP(this))
 	{
 
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfcompl\t" << _right << endl;
 		cout << "\tfnstsw\t%eax" << endl;
 		cout << "\tsahf\t" << endl;
@@ -798,7 +1516,7 @@ _left->generate();
 	if(FP(this))
 	{
 
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfcompl\t" << _right << endl;
 		cout << "\tfnstsw\t%eax" << endl;
 		cout << "\tsahf\t" << endl;
@@ -920,7 +1638,7 @@ void Equal::generate()
 	if(FP(this))
 	{
 
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfcompl\t" << _right << endl;
 		cout << "\tfnstsw\t%eax" << endl;
 		cout << "\tsahf\t" << endl;
@@ -956,7 +1674,7 @@ void NotEqual::generate()
 	if(FP(this))
 	{
 
-		cout << "\tfldl\t" << _left << endl;
+		load(_left);
 		cout << "\tfcompl\t" << _right << endl;
 		cout << "\tfnstsw\t%eax" << endl;
 		cout << "\tsahf\t" << endl;
@@ -994,31 +1712,9 @@ void Negate::generate()
 	
 	if(FP(this))
 	{
-		if(_expr->offset == 0)
-		{
-			stringLabel == true;
-			//cout << "here" << endl;
-		}
-		else
-		{
-			stringLabel == false;
-		}
-		//cout << _expr->offset << endl;
-		if(_expr->offset == 0)
-		{
-			cout << "\tfldl\t" << globalLabel << endl;
-		   	cout << "\tfchs\t" << endl;
-			cout << "\tfstpl\t" << this << endl;
-			stringLabel = false;
-		}
-		else
-		{
-			//cout << "here" << endl;
-			cout << "\tfldl\t" << _expr << endl;
-	   		cout << "\tfchs" << endl;
-   			cout << "\tfstpl\t" << this << endl;	   
-		}
-
+		load(_expr);
+		cout << "\tfchs" << endl;
+		cout << "\tfstpl\t" << this << endl;	   
 	}
 	else
 	{	
@@ -1086,48 +1782,8 @@ void Address::generate()
 	}
 	else
 	{
-		//cout << "\tmovl\t" << _expr << ", %eax" << endl;
-		//Label x;
-		//int tmp = x.number();
-		//listStrings.insert({tmp, 
-		/*std::unordered_map<int, std::string>::const_iterator got = listStrings.find(globalLabel.number());
-		std::unordered_map<int, std::string>::const_iterator git = listDoubles.find(globalLabel.number());
-		if(got == listStrings.end() || git == listDoubles.end())
-		{
-			stringLabel = true;
-		}
-		else
-		{
-			stringLabel = false;
-		}
-*/
-		bool p;
-		if(_expr->offset == 0)
-		{
-			p = true;
-		}
-		else
-		{
-			p = false;
-		}
-		//cout << _expr->offset << endl;
-		//cout << offset << endl;
-		if(stringLabel == true)
-		{
-			//cout << "a" << endl;
-			
-			cout << "\tleal\t" << globalLabel << ", %eax" << endl;
-			//assignTemp(this);
-			cout << "\tmovl\t%eax, " << this << endl; 
-			stringLabel = false;
-		}
-		else
-		{
-			//cout << "\tmovl\t" << _expr << ", %eax" << endl;
-			cout << "\tleal\t" << _expr << ", %eax" << endl;
-			cout << "\tmovl\t%eax, " << this << endl;
-		}
-		//cout << "\tmovl\t%eax, " << this << endl;
+		cout << "\tleal\t" << _expr << ", %eax" << endl;
+		cout << "\tmovl\t%eax, " << this << endl;
 	}
 
 }
@@ -1145,7 +1801,7 @@ void Not::generate()
 	
 	if(FP(this))
 	{	
-		cout << "\tfldl\t" << this << endl;
+		load(this);
 		cout << "\tftst\t" << endl;
 		cout << "\tfnstsw %ax" << endl;
 		cout << "\tfstp\t%st(0)" << endl;
@@ -1176,7 +1832,7 @@ void Increment::generate()
 	if(FP(this))
 	{
 		cout << "\tfld1\t" << endl;
-		cout << "\tfldl\t" << _expr << endl;
+		load(_expr);
 		cout << "\tfstl\t" << this << endl;
 		cout << "\tfaddp\t%st(1), %st" << endl;
 	  	cout << "\tfstpl\t" << _expr << endl; 	
@@ -1204,7 +1860,7 @@ void Decrement::generate()
 	if(FP(this))
 	{
 		cout << "\tfld1\t" << endl;
-		cout << "\tfldl\t" << _expr << endl;
+		load(_expr);
 		cout << "\tfstl\t" << this << endl;
 		cout << "\tfsubp\t%st(1), %st" << endl;
 	  	cout << "\tfstpl\t" << _expr << endl; 	
@@ -1224,6 +1880,8 @@ void Decrement::generate()
 
 void Cast::generate()
 {
+	const Symbol *symbol;
+
 	cout << endl;
 
 
@@ -1234,20 +1892,20 @@ void Cast::generate()
 	{
 		if(type().isInteger())
 		{
-			cout << "\tfldl\t" << _expr << endl;
+			load(_expr);
 			cout << "\tfisttpl\t" << this << endl;
 			//cout << "h" << endl;
 		}
 		else if(type().isReal())
 		{
-			cout << "\tfldl\t" << _expr << endl;;
+			load(_expr);;
 			cout << "\tfstpl\t" << this << endl;	
 		}
 		else
 		{
 			cout << "\tmovsbl\t" << _expr << ", %eax" << endl;
 			cout << "\tmovl\t%eax, " << _expr << endl;
-			cout << "\tfldl\t" << _expr << endl;
+			load(_expr);
 			cout << "\tfisttpl\t" << this << endl;
 		}	
 	}
@@ -1284,8 +1942,15 @@ void Cast::generate()
 		}
 		else if(type().isReal())
 		{
-			//cout << "\tmovl\t" << _expr << ", %eax" << endl;
-			cout << "\tfildl\t" << _expr << endl; 
+			symbol = identifier(strip(_expr));
+
+			if (dynamic_cast<Integer *>(_expr) != nullptr ||
+				(symbol != nullptr && !symbol->reg.empty())) {
+			    cout << "\tmovl\t" << _expr << ", " << this << endl;
+			    cout << "\tfildl\t" << this << endl;
+			} else
+			    cout << "\tfildl\t" << _expr << endl;
+
 			cout << "\tfstpl\t" << this << endl;
 		}
 		else
@@ -1300,38 +1965,6 @@ void Cast::generate()
 
 
 
-void String::generate()
-{
-	cout << endl;
-
-
-	Label tmp;
-	int x = tmp.number();
-	globalLabel = tmp;
-	//std::pair<std::string&, unsigned &> obj(value(), x);
-	string escaped = escapeString(value());
-	
-	listStrings.insert({x, escaped});
-	stringLabel = true;
-	//cout << "here" << endl;
-}
-
-void Real::generate()
-{
-	cout << endl;
-	numberDouble++;
-	assignTemp(this);
-	//cout << "t" << endl;
-	Label tmp;
-	int x = tmp.number();
-	globalLabel = tmp;
-	listDoubles.insert({x, value()});
-	stringLabel = true;
-//	cout << "\tleal\t" << globalLabel <<  ", %eax" << endl;
-//	cout << "\tmovl\t%eax, " << this << endl;
-	//cout << "Hello" << endl;
-}
-
 /*void Expression::generate()
 {
 }
@@ -1343,9 +1976,13 @@ void Return::generate()
 	//cout << "gadfgdafgDF" << endl;
 	_expr->generate();
 	//assignTemp(this);
+
+	if (dynamic_cast<Call *>(_expr) && ((Call *) _expr)->tail)
+	    return;
+
 	if(_expr->type().isReal())
 	{
-		cout << "\tfldl\t" << _expr << endl;
+		load(_expr);
 		cout << "\tjmp\t" << returnLabel << endl;
 	}
 	else
@@ -1362,7 +1999,7 @@ void Expression::test(const Label &label, bool ifTrue)
 	if(FP(this))
 	{
 
-		cout << "\tfldl\t" << this << endl;
+		load(this);
 		cout << "\tftst\t" << endl;
 		cout << "\tfnstsw %ax" << endl;
 		cout << "\tfstp\t%st(0)" << endl;
@@ -1381,57 +2018,371 @@ void Break::generate()
 	cout << "\tjmp\t" << inLoop << endl;
 }
 
+/*
+ * Function:	pointer (private)
+ *
+ * Description:	Return the pointer "p" of the given element "p[i]".
+ */
+
+static Expression *pointer(Expression *expr)
+{
+    expr = ((Unary *) strip(expr))->expr();
+    return strip(((Binary *) strip(expr))->left());
+}
+
+
+/*
+ * Function:	pack (private)
+ *
+ * Description:	Generate code to compute the given expression for a vector
+ *		of elements into the given SSE register.  An invariant is
+ *		copied into every element, and the loop variable "i" becomes
+ *		"i", "i + 1", "i + 2", and "i + 3".
+ */
+
+static void pack(Expression *expr, const Simd *plan, unsigned reg)
+{
+    const Expressions &invariants = plan->invariants;
+    bool real = plan->type.isReal();
+    unsigned size = plan->type.size();
+    Binary *binary;
+    string op;
+
+
+    expr = strip(expr);
+
+    if (find(invariants.begin(), invariants.end(), expr) != invariants.end()) {
+	if (real) {
+	    cout << "\tmovsd\t" << expr << ", %xmm" << reg << endl;
+	    cout << "\tunpcklpd\t%xmm" << reg << ", %xmm" << reg << endl;
+	} else {
+	    cout << "\tmovl\t" << expr << ", %eax" << endl;
+	    cout << "\tmovd\t%eax, %xmm" << reg << endl;
+	    cout << "\tpshufd\t$0, %xmm" << reg << ", %xmm" << reg << endl;
+	}
+
+    } else if (identifier(expr) == plan->counter) {
+	cout << "\tmovd\t" << local(plan->counter) << ", %xmm";
+	cout << reg << endl;
+	cout << "\tpshufd\t$0, %xmm" << reg << ", %xmm" << reg << endl;
+	cout << "\tpaddd\t" << ramp << ", %xmm" << reg << endl;
+	ramped = true;
+
+    } else if (dynamic_cast<Dereference *>(expr) != nullptr) {
+	cout << "\tmovl\t" << pointer(expr) << ", %eax" << endl;
+	cout << "\tmovl\t" << local(plan->counter) << ", %ecx" << endl;
+	cout << (real ? "\tmovupd\t" : "\tmovdqu\t");
+	cout << "(%eax,%ecx," << size << "), %xmm" << reg << endl;
+
+    } else {
+	binary = (Binary *) expr;
+	pack(binary->left(), plan, reg);
+	pack(binary->right(), plan, reg + 1);
+
+	if (dynamic_cast<Add *>(expr) != nullptr)
+	    op = real ? "addpd" : "paddd";
+	else if (dynamic_cast<Subtract *>(expr) != nullptr)
+	    op = real ? "subpd" : "psubd";
+	else if (dynamic_cast<Multiply *>(expr) != nullptr)
+	    op = "mulpd";
+	else
+	    op = "divpd";
+
+	cout << "\t" << op << "\t%xmm" << reg + 1 << ", %xmm" << reg << endl;
+    }
+}
+
+
+/*
+ * Function:	vectorize (private)
+ *
+ * Description:	Generate code to execute the iterations of a loop several
+ *		at a time using SSE2, following the given plan, for as long
+ *		as a whole vector of iterations remains.  The original loop
+ *		follows and executes the rest, or all of them if any of the
+ *		pointers overlap.  Each sum is kept in its own register
+ *		until the end, starting with the last register.
+ */
+
+static void vectorize(const Simd *plan)
+{
+    Label loop, exit, scalar;
+    unsigned size, width, sum;
+    const char *move;
+    Expression *expr;
+    Binary *add;
+
+
+    size = plan->type.size();
+    width = SIZEOF_VECTOR / size;
+    move = plan->type.isReal() ? "\tmovupd\t" : "\tmovdqu\t";
+
+
+    /* Skip to the original loop unless a whole vector remains. */
+
+    plan->bound->generate();
+
+    cout << "\tmovl\t" << local(plan->counter) << ", %eax" << endl;
+    cout << "\taddl\t$" << width - 1 << ", %eax" << endl;
+    cout << "\tjo\t" << scalar << endl;
+    cout << "\tcmpl\t" << plan->bound << ", %eax" << endl;
+    cout << (plan->inclusive ? "\tjg\t" : "\tjge\t") << scalar << endl;
+
+    for (auto expr : plan->invariants)
+	expr->generate();
+
+
+    /* Check that the pointers are equal or at least a vector apart. */
+
+    for (auto &pair : plan->overlaps) {
+	Label next;
+
+	cout << "\tmovl\t" << pair.first << ", %eax" << endl;
+	cout << "\tsubl\t" << pair.second << ", %eax" << endl;
+	cout << "\tje\t" << next << endl;
+	cout << "\taddl\t$" << SIZEOF_VECTOR - 1 << ", %eax" << endl;
+	cout << "\tcmpl\t$" << 2 * SIZEOF_VECTOR - 2 << ", %eax" << endl;
+	cout << "\tjbe\t" << scalar << endl;
+	cout << next << ":" << endl;
+    }
+
+    sum = VECTOR_REGISTERS;
+
+    for (auto assign : plan->assigns)
+	if (identifier(assign->left()) != nullptr) {
+	    sum --;
+	    cout << "\tpxor\t%xmm" << sum << ", %xmm" << sum << endl;
+	}
+
+
+    /* Generate the vector loop, which tests at the bottom. */
+
+    cout << loop << ":" << endl;
+    sum = VECTOR_REGISTERS;
+
+    for (auto assign : plan->assigns) {
+	if (identifier(assign->left()) != nullptr) {
+	    add = (Binary *) assign->right();
+	    expr = add->right();
+
+	    if (identifier(add->left()) != identifier(assign->left()))
+		expr = add->left();
+
+	    pack(expr, plan, 0);
+	    sum --;
+	    cout << "\tpaddd\t%xmm0, %xmm" << sum << endl;
+
+	} else {
+	    pack(assign->right(), plan, 0);
+	    cout << "\tmovl\t" << pointer(assign->left()) << ", %eax" << endl;
+	    cout << "\tmovl\t" << local(plan->counter) << ", %ecx";
+	    cout << endl << move << "%xmm0, (%eax,%ecx," << size << ")" << endl;
+	}
+    }
+
+    cout << "\taddl\t$" << width << ", " << local(plan->counter);
+    cout << endl;
+    cout << "\tmovl\t" << local(plan->counter) << ", %eax" << endl;
+    cout << "\taddl\t$" << width - 1 << ", %eax" << endl;
+    cout << "\tjo\t" << exit << endl;
+    cout << "\tcmpl\t" << plan->bound << ", %eax" << endl;
+    cout << (plan->inclusive ? "\tjle\t" : "\tjl\t") << loop << endl;
+    cout << exit << ":" << endl;
+
+
+    /* Add the elements of each sum to its variable. */
+
+    sum = VECTOR_REGISTERS;
+
+    for (auto assign : plan->assigns)
+	if (identifier(assign->left()) != nullptr) {
+	    sum --;
+	    cout << "\tpshufd\t$78, %xmm" << sum << ", %xmm0" << endl;
+	    cout << "\tpaddd\t%xmm0, %xmm" << sum << endl;
+	    cout << "\tpshufd\t$177, %xmm" << sum << ", %xmm0" << endl;
+	    cout << "\tpaddd\t%xmm0, %xmm" << sum << endl;
+	    cout << "\tmovd\t%xmm" << sum << ", %eax" << endl;
+	    cout << "\taddl\t%eax, " << assign->left() << endl;
+	}
+
+    cout << scalar << ":" << endl;
+}
+
+
+/*
+ * Function:	While::generate
+ *
+ * Description:	Generate code for this while statement.  If the loop is
+ *		rotated by the branch-layout pass, the test is placed after
+ *		the body, and the loop is entered by jumping to it, so that
+ *		the branch back to the top is taken on every iteration and
+ *		the loop is left by falling through.
+ */
+
 void While::generate()
 {
-	Label loop, exit;
+	Label loop, test, exit, outer = inLoop;
+	bool rotated = branchLayout;
 	inLoop = exit;
+	tally(this, 0);
+
+	if (simd != nullptr)
+	    vectorize(simd);
+
+	if (rotated)
+	    cout << "\tjmp\t" << test << endl;
+
 	cout << loop << ":" << endl;
 
-	_expr->test(exit, false);
+	if (!rotated)
+	    _expr->test(exit, false);
+
+	tally(this, 1);
 	_stmt->generate();
 
-	cout << "\tjmp\t" << loop << endl;
-	cout << exit << ":" << endl;
+	if (rotated) {
+	    cout << test << ":" << endl;
+	    _expr->test(loop, true);
+	} else
+	    cout << "\tjmp\t" << loop << endl;
 
+	cout << exit << ":" << endl;
+	inLoop = outer;
 }
 
 
+/*
+ * Function:	For::generate
+ *
+ * Description:	Generate code for this for statement, which is laid out
+ *		just like a while statement, with the increment after the
+ *		body.
+ */
 
 void For::generate()
 {
 
 	cout << endl;
 
-	Label loop, exit;
+	Label loop, test, exit, outer = inLoop;
+	bool rotated = branchLayout;
 	inLoop = exit;
 	_init->generate();
+	tally(this, 0);
+
+	if (simd != nullptr)
+	    vectorize(simd);
+
+	if (rotated)
+	    cout << "\tjmp\t" << test << endl;
 
 	cout << loop << ":" << endl;
-	
-	_expr->test(exit, false);
+
+	if (!rotated)
+	    _expr->test(exit, false);
+
+	tally(this, 1);
 	
 	_stmt->generate();
 
 	_incr->generate();
 
-	cout << "\tjmp\t" << loop << endl;
+	if (rotated) {
+	    cout << test << ":" << endl;
+	    _expr->test(loop, true);
+	} else
+	    cout << "\tjmp\t" << loop << endl;
 
 	cout << exit << ":" << endl;
-
+	inLoop = outer;
 }
 
+/*
+ * Function:	If::generate
+ *
+ * Description:	Generate code for this if statement.  If the profile shows
+ *		that one part is never executed, that part is moved to the
+ *		end of the function.  Otherwise, if the else part is
+ *		executed more often, it is placed first so that it is
+ *		reached by falling through.  Without a profile, the parts
+ *		are laid out the same way using the predicted probability
+ *		of each part instead, so that an unlikely then part without
+ *		an else part is also moved out of the way.  The parts are
+ *		left in order if the branch-layout pass is off.
+ */
+
 void If::generate()
 {
 	cout << endl;
 	//cout << "here" << endl;
 	Label ELSE, SKIP;
+	unsigned taken, skipped;
+	bool layout, known, coldThen, coldElse, elseFirst;
+	double p;
 	//cout << IF << ":" << endl;
 
+	layout = branchLayout && profileOutput.empty();
+	known = layout && profiled(this, 0, taken) &&
+	    profiled(this, 1, skipped);
+
+	coldThen = coldElse = elseFirst = false;
+
+	if (known) {
+	    coldThen = taken == 0 && skipped > 0;
+	    coldElse = _elseStmt != nullptr && skipped == 0 && taken > 0;
+	    elseFirst = _elseStmt != nullptr && skipped > taken;
+
+	} else if (layout) {
+	    p = predict(this);
+	    coldThen = p <= COLD_PROBABILITY;
+	    coldThen = coldThen || (_elseStmt == nullptr && p < 0.5);
+	    coldElse = _elseStmt != nullptr && p >= 1 - COLD_PROBABILITY;
+	    elseFirst = _elseStmt != nullptr && p < 0.5;
+	}
+
+	if (coldThen && !outlining) {
+	    _expr->test(ELSE, true);
+
+	    if (_elseStmt != nullptr)
+		_elseStmt->generate();
+
+	    cout << SKIP << ":" << endl;
+	    outline(_thenStmt, ELSE, SKIP);
+	    return;
+	}
+
+	if (coldElse && !outlining) {
+	    _expr->test(ELSE, false);
+	    _thenStmt->generate();
+	    cout << SKIP << ":" << endl;
+	    outline(_elseStmt, ELSE, SKIP);
+	    return;
+	}
+
+	if (elseFirst) {
+	    _expr->test(ELSE, true);
+	    _elseStmt->generate();
+
+	    if (completes(_elseStmt))
+		cout << "\tjmp\t" << SKIP << endl;
+
+	    cout << ELSE << ":" << endl;
+	    _thenStmt->generate();
+	    cout << SKIP << ":" << endl;
+	    return;
+	}
+
 	_expr->test(ELSE, false);
+	tally(this, 0);
 	_thenStmt->generate();
-	cout << "\tjmp\t" << SKIP << endl;
+
+	if (_elseStmt != nullptr || !profileOutput.empty())
+	    if (completes(_thenStmt))
+		cout << "\tjmp\t" << SKIP << endl;
 	
 	cout << ELSE << ":" << endl;
+	tally(this, 1);
+
 	if(_elseStmt)
 	{
 		_elseStmt->generate();
@@ -1440,6 +2391,143 @@ void If::generate()
 }
 
 
+/*
+ * Function:	dense (private)
+ *
+ * Description:	Return whether the given case values, which are sorted,
+ *		are numerous and dense enough to be worth a jump table.
+ */
+
+static bool dense(const vector<pair<int, Label>> &values, unsigned lo,
+	unsigned hi)
+{
+    long long range;
+
+
+    if (hi - lo < TABLE_MINIMUM)
+	return false;
+
+    range = (long long) values[hi - 1].first - values[lo].first + 1;
+    return range <= (long long) (hi - lo) * TABLE_DENSITY;
+}
+
+
+/*
+ * Function:	dispatch (private)
+ *
+ * Description:	Generate code to jump to the section for the value in
+ *		%eax, given the sorted case values in the range [lo, hi)
+ *		and the label to use if none of them match.  A dense range
+ *		uses a jump table, a short range uses a sequence of
+ *		comparisons, and any other range is split at its middle
+ *		value to form a balanced binary search.
+ */
+
+static void dispatch(const vector<pair<int, Label>> &values, unsigned lo,
+	unsigned hi, const Label &fallback)
+{
+    Label table, upper;
+    unsigned mid;
+    int low, gap;
+
+
+    if (dense(values, lo, hi)) {
+	low = values[lo].first;
+
+	if (low != 0)
+	    cout << "\tsubl\t$" << low << ", %eax" << endl;
+
+	cout << "\tcmpl\t$" << values[hi - 1].first - low << ", %eax" << endl;
+	cout << "\tja\t" << fallback << endl;
+	cout << "\tjmp\t*" << table << "(,%eax,4)" << endl;
+
+	cout << "\t.section\t.rodata" << endl;
+	cout << "\t.align\t4" << endl;
+	cout << table << ":" << endl;
+
+	for (unsigned i = lo; i < hi; i ++) {
+	    if (i > lo)
+		for (gap = values[i - 1].first + 1; gap < values[i].first;
+			gap ++)
+		    cout << "\t.long\t" << fallback << endl;
+
+	    cout << "\t.long\t" << values[i].second << endl;
+	}
+
+	cout << "\t.text" << endl;
+	return;
+    }
+
+    if (hi - lo <= SEARCH_MINIMUM) {
+	for (unsigned i = lo; i < hi; i ++) {
+	    cout << "\tcmpl\t$" << values[i].first << ", %eax" << endl;
+	    cout << "\tje\t" << values[i].second << endl;
+	}
+
+	cout << "\tjmp\t" << fallback << endl;
+	return;
+    }
+
+    mid = (lo + hi) / 2;
+    cout << "\tcmpl\t$" << values[mid].first << ", %eax" << endl;
+    cout << "\tje\t" << values[mid].second << endl;
+    cout << "\tjg\t" << upper << endl;
+    dispatch(values, lo, mid, fallback);
+    cout << upper << ":" << endl;
+    dispatch(values, mid + 1, hi, fallback);
+}
+
+
+/*
+ * Function:	Switch::generate
+ *
+ * Description:	Generate code for this switch statement.  The expression
+ *		is evaluated once into %eax and dispatched on, after which
+ *		the sections are generated in order so that each one falls
+ *		through to the next.  A break leaves the switch statement.
+ */
+
+void Switch::generate()
+{
+    vector<pair<int, Label>> values;
+    vector<Label> labels(_cases.size());
+    Label exit, fallback = exit, outer = inLoop;
+
+
+    for (unsigned i = 0; i < _cases.size(); i ++) {
+	for (auto value : _cases[i].values)
+	    values.push_back(make_pair(value, labels[i]));
+
+	if (_cases[i].isDefault)
+	    fallback = labels[i];
+    }
+
+    sort(values.begin(), values.end(),
+	[](const pair<int, Label> &a, const pair<int, Label> &b) {
+	    return a.first < b.first;
+	});
+
+    cout << endl;
+    _expr->generate();
+    cout << "\tmovl\t" << _expr << ", %eax" << endl;
+
+    if (values.empty())
+	cout << "\tjmp\t" << fallback << endl;
+    else
+	dispatch(values, 0, values.size(), fallback);
+
+    inLoop = exit;
+
+    for (unsigned i = 0; i < _cases.size(); i ++) {
+	cout << labels[i] << ":" << endl;
+	_cases[i].stmt->generate();
+    }
+
+    cout << exit << ":" << endl;
+    inLoop = outer;
+}
+
+
 
 
 
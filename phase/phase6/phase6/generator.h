@@ -11,5 +11,6 @@
 # include "Scope.h"
 
 void generateGlobals(Scope *scope);
+unsigned registerArguments(const Symbol *function);
 
 # endif /* GENERATOR_H */
@@ -0,0 +1,414 @@
+/*
+ * File:	inliner.cpp
+ *
+ * Description:	This file contains the function definitions for inlining
+ *		function calls in Simple C.
+ *
+ *		After a function has been checked and its own calls have
+ *		been inlined, a copy of its body is saved before any other
+ *		pass changes it.  A later call to the function may then be
+ *		replaced with a copy of that body, provided that the call
+ *		is an expression statement, the right-hand side of an
+ *		assignment to a variable, or the expression of a return
+ *		statement, since Simple C has no way to return a value from
+ *		the middle of an expression.
+ *
+ *		Each parameter and local variable of the callee is replaced
+ *		by a new local variable of the caller, so that they are all
+ *		allocated in the caller's frame, and the parameters are
+ *		assigned the arguments.  The callee's return statements must
+ *		all be in tail position, after restructuring if statements
+ *		where necessary, so that they can be replaced by assignments
+ *		to the target of the call.
+ *
+ *		A call is inlined if the size of the callee, counted in tree
+ *		nodes, is at most the threshold times one more than the
+ *		depth of the loops around the call, since calls in loops
+ *		are executed more often.  If there is a profile, a call
+ *		that was never made is not inlined, and the threshold is
+ *		several times larger for a hot call.
+ */
+
+# include "optimizer.h"
+
+using namespace std;
+
+unsigned inlineThreshold = 20;
+
+static const unsigned HOT_FACTOR = 4;
+
+
+/* A function whose calls may be inlined */
+
+struct Callee {
+    Block *body;
+    std::vector<const Symbol *> symbols;
+    unsigned params, size;
+};
+
+static map<const Symbol *, Callee> callees;
+static Renaming renamed;
+static Function *function;
+static unsigned inlined;
+
+
+/*
+ * Function:	size (private)
+ *
+ * Description:	Return the number of statements and expressions within the
+ *		given statement.
+ */
+
+static unsigned size(Statement *stmt)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+
+
+    statements(stmt, stmts);
+
+    for (auto slot : stmts)
+	expressions(*slot, exprs);
+
+    return stmts.size() + exprs.size();
+}
+
+
+/*
+ * Function:	calls (private)
+ *
+ * Description:	Return whether the given statement contains a call to the
+ *		given function.
+ */
+
+static bool calls(Statement *stmt, const Symbol *id)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+
+
+    statements(stmt, stmts);
+
+    for (auto slot : stmts) {
+	if (dynamic_cast<Call *>(*slot) != nullptr)
+	    if (((Call *) *slot)->id() == id)
+		return true;
+
+	expressions(*slot, exprs);
+    }
+
+    for (auto slot : exprs)
+	if (dynamic_cast<Call *>(*slot) != nullptr)
+	    if (((Call *) *slot)->id() == id)
+		return true;
+
+    return false;
+}
+
+
+/*
+ * Function:	restructure (private)
+ *
+ * Description:	Restructure the given statement so that an if statement
+ *		with a part that cannot complete is followed by no other
+ *		statements in its block.  Instead, the statements are moved
+ *		into the other part.  For example, "if (c) return x; s;"
+ *		becomes "if (c) return x; else s;".
+ */
+
+static void restructure(Statement *stmt)
+{
+    Statements rest;
+    Block *block;
+    If *cond;
+
+
+    if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	restructure(cond->thenStmt());
+
+	if (cond->elseStmt() != nullptr)
+	    restructure(cond->elseStmt());
+
+	return;
+    }
+
+    if ((block = dynamic_cast<Block *>(stmt)) == nullptr)
+	return;
+
+    Statements &stmts = block->statements();
+
+    for (unsigned i = 0; i < stmts.size(); i ++) {
+	restructure(stmts[i]);
+
+	if ((cond = dynamic_cast<If *>(stmts[i])) == nullptr)
+	    continue;
+
+	if (i + 1 == stmts.size())
+	    break;
+
+	rest.assign(stmts.begin() + i + 1, stmts.end());
+
+	if (!completes(cond->thenStmt())) {
+	    if (cond->elseStmt() != nullptr)
+		rest.insert(rest.begin(), cond->elseStmt());
+
+	    cond->elseStmt() = new Block(new Scope(), rest);
+	    restructure(cond->elseStmt());
+
+	} else if (cond->elseStmt() != nullptr) {
+	    if (completes(cond->elseStmt()))
+		continue;
+
+	    rest.insert(rest.begin(), cond->thenStmt());
+	    cond->thenStmt() = new Block(new Scope(), rest);
+	    restructure(cond->thenStmt());
+
+	} else
+	    continue;
+
+	stmts.resize(i + 1);
+	break;
+    }
+}
+
+
+/*
+ * Function:	tails (private)
+ *
+ * Description:	Return whether every return statement within the given
+ *		statement is in tail position.  The flag indicates whether
+ *		the function ends after the statement.
+ */
+
+static bool tails(Statement *stmt, bool last)
+{
+    Block *block;
+    If *cond;
+    Switch *branch;
+    unsigned i;
+
+
+    if (dynamic_cast<Return *>(stmt) != nullptr)
+	return last;
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (i = 0; i < block->statements().size(); i ++)
+	    if (!tails(block->statements()[i],
+		    last && i + 1 == block->statements().size()))
+		return false;
+
+	return true;
+    }
+
+    if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	if (!tails(cond->thenStmt(), last))
+	    return false;
+
+	return cond->elseStmt() == nullptr || tails(cond->elseStmt(), last);
+    }
+
+    if (dynamic_cast<While *>(stmt) != nullptr)
+	return tails(((While *) stmt)->stmt(), false);
+
+    if (dynamic_cast<For *>(stmt) != nullptr)
+	return tails(((For *) stmt)->stmt(), false);
+
+    if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : branch->cases())
+	    if (!tails(section.stmt, false))
+		return false;
+
+	return true;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	expand (private)
+ *
+ * Description:	Return a statement that performs the given call inline,
+ *		or a null pointer if it cannot be inlined.  The value
+ *		returned by the callee is assigned to the given target if
+ *		there is one, or returned from the caller if the flag is
+ *		set, and otherwise discarded.
+ */
+
+static Statement *expand(Call *call, Expression *target, bool keep,
+	unsigned depth)
+{
+    vector<Statement **> slots;
+    Callee *callee;
+    Statement *body;
+    Statements stmts;
+    Return *ret;
+    unsigned i, limit, count;
+
+
+    if (callees.count(call->id()) == 0)
+	return nullptr;
+
+    callee = &callees[call->id()];
+    limit = inlineThreshold * (depth + 1);
+
+    if (profiled(call, 0, count)) {
+	if (count == 0)
+	    return nullptr;
+
+	if (hot(count))
+	    limit *= HOT_FACTOR;
+    }
+
+    if (callee->size > limit)
+	return nullptr;
+
+    if (call->args().size() != callee->params)
+	return nullptr;
+
+    for (i = 0; i < callee->params; i ++)
+	if (call->args()[i]->type() != callee->symbols[i]->type())
+	    return nullptr;
+
+
+    /* Copy the body and make all of its returns tail returns. */
+
+    body = callee->body->clone();
+    restructure(body);
+
+    if (!tails(body, true))
+	return nullptr;
+
+    renamed.clear();
+
+    for (auto symbol : callee->symbols)
+	renamed[symbol] = declare(function, symbol->name(), symbol->type());
+
+    rename(body, renamed);
+    statements(body, slots);
+
+    for (auto slot : slots)
+	if ((ret = dynamic_cast<Return *>(*slot)) != nullptr && !keep) {
+	    if (target != nullptr)
+		*slot = new Assignment(target->clone(), ret->expr());
+	    else
+		*slot = ret->expr();
+	}
+
+
+    /* Assign the arguments to the parameters and then do the body. */
+
+    for (i = 0; i < callee->params; i ++) {
+	target = new Identifier(renamed[callee->symbols[i]]);
+	stmts.push_back(new Assignment(target, call->args()[i]));
+    }
+
+    stmts.push_back(body);
+    inlined ++;
+    return new Block(new Scope(), stmts);
+}
+
+
+/*
+ * Function:	visit (private)
+ *
+ * Description:	Inline the calls within the given statement, which is
+ *		nested within the given number of loops.
+ */
+
+static void visit(Statement *&stmt, unsigned depth)
+{
+    Statement *result;
+    Assignment *assign;
+    Return *ret;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+
+
+    result = nullptr;
+
+    if (dynamic_cast<Call *>(stmt) != nullptr)
+	result = expand((Call *) stmt, nullptr, false, depth);
+
+    else if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	if (identifier(assign->left()) != nullptr)
+	    if (dynamic_cast<Call *>(assign->right()) != nullptr)
+		result = expand((Call *) assign->right(), assign->left(),
+			false, depth);
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr) {
+	if (dynamic_cast<Call *>(ret->expr()) != nullptr)
+	    result = expand((Call *) ret->expr(), nullptr, true, depth);
+
+    } else if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto &child : block->statements())
+	    visit(child, depth);
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr)
+	visit(loop->stmt(), depth + 1);
+
+    else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	visit(iter->init(), depth);
+	visit(iter->stmt(), depth + 1);
+	visit(iter->incr(), depth + 1);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	visit(cond->thenStmt(), depth);
+
+	if (cond->elseStmt() != nullptr)
+	    visit(cond->elseStmt(), depth);
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : branch->cases())
+	    visit(section.stmt, depth);
+    }
+
+    if (result != nullptr)
+	stmt = result;
+}
+
+
+/*
+ * Function:	inlineCalls
+ *
+ * Description:	Inline the calls within the given function, and then save
+ *		its body so that calls to it may be inlined later.  Calls to
+ *		variadic and recursive functions are never inlined.
+ */
+
+void inlineCalls(Function *fn)
+{
+    Statement *body;
+    Callee callee;
+    SymbolSet locals;
+    Scope *decls;
+
+
+    function = fn;
+    body = function->body();
+    inlined = 0;
+    visit(body, 0);
+    count("calls inlined", inlined);
+
+    if (function->id()->type().parameters()->variadic)
+	return;
+
+    if (calls(function->body(), function->id()))
+	return;
+
+    callee.body = (Block *) function->body()->clone();
+    callee.params = function->id()->type().parameters()->types.size();
+    callee.size = size(callee.body);
+    decls = function->body()->declarations();
+    callee.symbols.assign(decls->symbols().begin(), decls->symbols().end());
+    declarations(function->body(), locals);
+
+    for (auto symbol : locals)
+	if (decls->find(symbol->name()) != symbol)
+	    callee.symbols.push_back(symbol);
+
+    callees[function->id()] = callee;
+}
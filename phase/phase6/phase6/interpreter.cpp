@@ -0,0 +1,1824 @@
+/*
+ * File:	interpreter.cpp
+ *
+ * Description:	This file contains the function definitions for the
+ *		bytecode interpreter for Simple C, which runs a program
+ *		straight from its trees without generating any code for the
+ *		machine, so that no assembler or linker is needed.
+ *
+ *		Each function is lowered to the bytecode of a register
+ *		machine.  An instruction names up to three registers of its
+ *		function, or a register and a 32-bit immediate, and so
+ *		takes only eight bytes.  Each parameter and each local
+ *		whose address is never taken has a register of its own, as
+ *		does each value that a common subexpression reuses.  The
+ *		remaining registers hold temporaries, which are reused from
+ *		one statement to the next.  The arguments of a call are
+ *		computed into the registers just past those in use, which
+ *		then become the first registers of the callee, so that
+ *		nothing is copied.  Arrays and the locals whose address is
+ *		taken live in the memory of the frame instead.
+ *
+ *		The bytecode is interpreted by a loop in which each
+ *		instruction jumps directly to the next through a table of
+ *		label addresses, using the computed goto of GCC, rather
+ *		than returning to a central switch.  The frames of calls
+ *		are kept on a stack of our own.
+ *
+ *		A program expects its pointers to be four bytes, so all of
+ *		its memory, for its globals, literals, frames, and heap, is
+ *		mapped within the low four gigabytes, and its addresses can
+ *		be passed to library functions as they are.  The functions
+ *		that allocate memory are replaced by our own allocator for
+ *		the heap.  Any other library function is looked up with
+ *		dlsym and called with its arguments where the calling
+ *		convention of the machine expects them.
+ */
+
+# include <algorithm>
+# include <climits>
+# include <cstdint>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include <map>
+# include <dlfcn.h>
+# include <sys/mman.h>
+# include "interpreter.h"
+# include "machine.h"
+# include "optimizer.h"
+
+using namespace std;
+
+enum {
+    OP_MOVE, OP_CONST, OP_REAL, OP_LOCAL, OP_ADD, OP_ADDK, OP_SUB, OP_MUL,
+    OP_MULK, OP_DIV, OP_REM, OP_NEG, OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE,
+    OP_GE, OP_NOT, OP_FADD, OP_FSUB, OP_FMUL, OP_FDIV, OP_FNEG, OP_FEQ,
+    OP_FNE, OP_FLT, OP_FGT, OP_FLE, OP_FGE, OP_FNOT, OP_ITOF, OP_FTOI,
+    OP_SEXT, OP_LDB, OP_LDW, OP_LDD, OP_STB, OP_STW, OP_STD, OP_JUMP,
+    OP_JZ, OP_JNZ, OP_FJZ, OP_FJNZ, OP_JEQ, OP_JNE, OP_JLT, OP_JGT,
+    OP_JLE, OP_JGE, OP_SWITCH, OP_CALL, OP_LIBRARY, OP_RETURN
+};
+
+enum { LIBRARY, MALLOC, CALLOC, REALLOC, FREE };
+
+static const unsigned DATA_SIZE = 1 << 25;
+static const unsigned STACK_SIZE = 1 << 25;
+static const unsigned HEAP_SIZE = 3 << 27;
+static const unsigned REGISTERS = 1 << 22;
+static const unsigned TABLE_DENSITY = 3;
+
+
+/* The contents of a register, which holds an integer, a pointer, or a
+   double */
+
+union Value {
+    int i;
+    double d;
+};
+
+
+/* An instruction, whose last two operands may instead be a 32-bit
+   immediate, and whose last operand is the target of a jump */
+
+struct Instruction {
+    unsigned short op, a, b, c;
+};
+
+
+/* The targets of a switch statement, indexed by value if the values are
+   dense and searched otherwise */
+
+struct Table {
+    int low;
+    vector<unsigned> targets;
+    vector<pair<int, unsigned>> values;
+    unsigned fallback;
+};
+
+
+/* A function lowered to bytecode, along with the number of registers and
+   bytes of memory in its frame, and the doubles and switch tables that
+   its instructions refer to */
+
+struct Code {
+    string name;
+    vector<Instruction> code;
+    vector<double> reals;
+    vector<Table> tables;
+    unsigned registers, frame;
+};
+
+
+/* A call to a library function, along with the kind of each argument
+   and of the result: an integer, pointer, character, or double */
+
+struct Bridge {
+    string name;
+    void *address;
+    int kind;
+    string args;
+    char result;
+};
+
+
+/* The state of a caller, restored when the callee returns */
+
+struct Frame {
+    const Instruction *pc;
+    const Code *code;
+    Value *r;
+    unsigned sp;
+};
+
+static vector<Code> compiled;
+static vector<Bridge> bridges;
+static map<string, unsigned> indices;
+static map<const Symbol *, unsigned> globals;
+static map<string, unsigned> strings;
+
+static char *memory;
+static unsigned data, dataEnd, stackTop, stackBottom, heap, heapEnd;
+static unsigned freed[32];
+
+static Code *code;
+static map<const Symbol *, unsigned> registers, offsets;
+static map<const Expression *, unsigned> shared;
+static unsigned reserved, unused;
+static vector<unsigned> *exits;
+
+static unsigned value(Expression *expr, int target);
+static void test(Expression *expr, bool ifTrue, vector<unsigned> &jumps);
+static void statement(Statement *stmt);
+
+
+/*
+ * Function:	error (private)
+ *
+ * Description:	Report that the program cannot be interpreted and exit.
+ */
+
+static void error(const string &message)
+{
+    cerr << message << endl;
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	host (private)
+ *
+ * Description:	Return the pointer for the given address of the program.
+ */
+
+static char *host(unsigned address)
+{
+    return (char *) (uintptr_t) address;
+}
+
+
+/*
+ * Function:	narrow (private)
+ *
+ * Description:	Return the address of the program for the given pointer
+ *		into our memory.
+ */
+
+static unsigned narrow(const char *pointer)
+{
+    return (unsigned) (uintptr_t) pointer;
+}
+
+
+/*
+ * Function:	mapMemory (private)
+ *
+ * Description:	Map the memory of the program, which must lie within the
+ *		low four gigabytes.  The pages are only committed as they
+ *		are touched.
+ */
+
+static void mapMemory()
+{
+    size_t size = (size_t) DATA_SIZE + STACK_SIZE + HEAP_SIZE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    void *address;
+
+
+# if defined(MAP_32BIT)
+    flags |= MAP_32BIT;
+# endif
+
+    address = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+    if (address == MAP_FAILED || (uintptr_t) address + size - 1 > UINT_MAX)
+	error("cannot map memory for program");
+
+    memory = (char *) address;
+    data = narrow(memory);
+    dataEnd = data + DATA_SIZE;
+    stackBottom = dataEnd;
+    stackTop = stackBottom + STACK_SIZE;
+    heap = stackTop;
+    heapEnd = heap + HEAP_SIZE;
+}
+
+
+/*
+ * Function:	reserve (private)
+ *
+ * Description:	Reserve the given number of bytes with the given alignment
+ *		for static data, and return their address.
+ */
+
+static unsigned reserve(unsigned size, unsigned alignment)
+{
+    unsigned address;
+
+
+    address = (data + alignment - 1) / alignment * alignment;
+
+    if (address + size > dataEnd)
+	error("too much static data to interpret");
+
+    data = address + size;
+    return address;
+}
+
+
+/*
+ * Function:	intern (private)
+ *
+ * Description:	Return the address of the given string literal, which is
+ *		shared with every other literal of the same value.
+ */
+
+static unsigned intern(const string &s)
+{
+    unsigned address;
+
+
+    if (strings.count(s) == 0) {
+	address = reserve(s.size() + 1, 1);
+	memcpy(host(address), s.data(), s.size());
+	strings[s] = address;
+    }
+
+    return strings[s];
+}
+
+
+/*
+ * Function:	acquire (private)
+ *
+ * Description:	Allocate a block of the heap of at least the given size.
+ *		Each block is a power of two in size, which is recorded in
+ *		the eight bytes before it, and a block that is released is
+ *		kept on a list of its size for reuse.
+ */
+
+static unsigned acquire(unsigned size)
+{
+    unsigned power, block;
+
+
+    for (power = 4; power < 32 && (1u << power) - 8 < size; power ++)
+	continue;
+
+    if (power == 32)
+	return 0;
+
+    if (freed[power] != 0) {
+	block = freed[power];
+	memcpy(&freed[power], host(block), sizeof(unsigned));
+
+    } else {
+	if (heapEnd - heap < 1u << power)
+	    return 0;
+
+	block = heap + 8;
+	heap += 1u << power;
+    }
+
+    memcpy(host(block - 8), &power, sizeof(unsigned));
+    return block;
+}
+
+
+/*
+ * Function:	release (private)
+ *
+ * Description:	Release the given block of the heap.
+ */
+
+static void release(unsigned block)
+{
+    unsigned power;
+
+
+    if (block == 0)
+	return;
+
+    memcpy(&power, host(block - 8), sizeof(unsigned));
+    memcpy(host(block), &freed[power], sizeof(unsigned));
+    freed[power] = block;
+}
+
+
+/*
+ * Function:	resize (private)
+ *
+ * Description:	Return a block of the heap of at least the given size with
+ *		the contents of the given block, which is released if it
+ *		is too small.
+ */
+
+static unsigned resize(unsigned block, unsigned size)
+{
+    unsigned power, result;
+
+
+    if (block == 0)
+	return acquire(size);
+
+    memcpy(&power, host(block - 8), sizeof(unsigned));
+
+    if ((1u << power) - 8 >= size)
+	return block;
+
+    if ((result = acquire(size)) != 0) {
+	memcpy(host(result), host(block), (1u << power) - 8);
+	release(block);
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	library (private)
+ *
+ * Description:	Call the library function of the given bridge with the
+ *		given arguments and return its result.  On the i386, the
+ *		arguments are simply pushed in order as words.  Otherwise,
+ *		the first six integers and pointers go in the integer
+ *		registers and the first eight doubles in the vector
+ *		registers, regardless of how the two are interleaved, and
+ *		the rest go on the stack in order.  So the function is
+ *		called with six integers, eight doubles, and then the rest
+ *		as words, and calling through a variadic type also tells a
+ *		variadic function how many doubles there are.
+ */
+
+static Value library(const Bridge &bridge, const Value *args)
+{
+    typedef long (*Integral)(...);
+    typedef double (*Real)(...);
+    unsigned size;
+    Value result;
+    long word;
+
+
+    result.i = 0;
+
+    if (bridge.kind == MALLOC)
+	result.i = acquire(args[0].i);
+
+    else if (bridge.kind == CALLOC) {
+	size = (unsigned) args[0].i * args[1].i;
+
+	if ((result.i = acquire(size)) != 0)
+	    memset(host(result.i), 0, size);
+
+    } else if (bridge.kind == REALLOC)
+	result.i = resize(args[0].i, args[1].i);
+
+    else if (bridge.kind == FREE)
+	release(args[0].i);
+
+    else {
+# if defined(__i386__)
+	int w[16] = {0};
+	unsigned n = 0;
+
+	for (unsigned i = 0; i < bridge.args.size(); i ++)
+	    if (bridge.args[i] == 'd') {
+		memcpy(&w[n], &args[i].d, sizeof(double));
+		n += 2;
+	    } else
+		w[n ++] = args[i].i;
+
+	if (bridge.result == 'd') {
+	    result.d = ((Real) bridge.address)(w[0], w[1], w[2], w[3], w[4],
+		w[5], w[6], w[7], w[8], w[9], w[10], w[11], w[12], w[13],
+		w[14], w[15]);
+	    return result;
+	}
+
+	word = ((Integral) bridge.address)(w[0], w[1], w[2], w[3], w[4],
+	    w[5], w[6], w[7], w[8], w[9], w[10], w[11], w[12], w[13], w[14],
+	    w[15]);
+# else
+	long w[6] = {0}, s[8] = {0};
+	double d[8] = {0};
+	unsigned n = 0, m = 0, k = 0;
+
+	for (unsigned i = 0; i < bridge.args.size(); i ++)
+	    if (bridge.args[i] == 'd' && m < 8)
+		d[m ++] = args[i].d;
+	    else if (bridge.args[i] == 'd')
+		memcpy(&s[k ++], &args[i].d, sizeof(double));
+	    else if (n < 6)
+		w[n ++] = bridge.args[i] == 'p' ? (unsigned) args[i].i :
+		    args[i].i;
+	    else
+		s[k ++] = bridge.args[i] == 'p' ? (unsigned) args[i].i :
+		    args[i].i;
+
+	if (bridge.result == 'd') {
+	    result.d = ((Real) bridge.address)(w[0], w[1], w[2], w[3], w[4],
+		w[5], d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7], s[0],
+		s[1], s[2], s[3], s[4], s[5], s[6], s[7]);
+	    return result;
+	}
+
+	word = ((Integral) bridge.address)(w[0], w[1], w[2], w[3], w[4],
+	    w[5], d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7], s[0], s[1],
+	    s[2], s[3], s[4], s[5], s[6], s[7]);
+
+	if (bridge.result == 'p' && (unsigned long) word > UINT_MAX)
+	    error("pointer returned by " + bridge.name + " is out of range");
+# endif
+
+	result.i = bridge.result == 'c' ? (signed char) word : (int) word;
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	execute (private)
+ *
+ * Description:	Interpret the given function, whose registers start at the
+ *		given register and already hold its arguments, and return
+ *		its result.  Each instruction ends by jumping to the next.
+ *		Integer arithmetic wraps, and a division by -1 is done as
+ *		a negation, so that it never traps.
+ */
+
+static int execute(const Code *code, Value *r)
+{
+    static const void *const labels[] = {
+	&&op_move, &&op_const, &&op_real, &&op_local, &&op_add, &&op_addk,
+	&&op_sub, &&op_mul, &&op_mulk, &&op_div, &&op_rem, &&op_neg,
+	&&op_eq, &&op_ne, &&op_lt, &&op_gt, &&op_le, &&op_ge, &&op_not,
+	&&op_fadd, &&op_fsub, &&op_fmul, &&op_fdiv, &&op_fneg, &&op_feq,
+	&&op_fne, &&op_flt, &&op_fgt, &&op_fle, &&op_fge, &&op_fnot,
+	&&op_itof, &&op_ftoi, &&op_sext, &&op_ldb, &&op_ldw, &&op_ldd,
+	&&op_stb, &&op_stw, &&op_std, &&op_jump, &&op_jz, &&op_jnz,
+	&&op_fjz, &&op_fjnz, &&op_jeq, &&op_jne, &&op_jlt, &&op_jgt,
+	&&op_jle, &&op_jge, &&op_switch, &&op_call, &&op_library,
+	&&op_return
+    };
+
+    const Instruction *start, *pc;
+    vector<Frame> frames;
+    Value *end;
+    unsigned sp, at;
+
+
+# define A r[pc->a]
+# define B r[pc->b]
+# define C r[pc->c]
+# define K ((int) (pc->b | (unsigned) pc->c << 16))
+# define NEXT goto *labels[(++ pc)->op]
+# define JUMP(n) goto *labels[(pc = start + (n))->op]
+
+    end = r + REGISTERS;
+    sp = stackTop - code->frame;
+    start = pc = code->code.data();
+    goto *labels[pc->op];
+
+op_move:	A = B; NEXT;
+op_const:	A.i = K; NEXT;
+op_real:	A.d = code->reals[K]; NEXT;
+op_local:	A.i = sp + K; NEXT;
+
+op_add:		A.i = (unsigned) B.i + C.i; NEXT;
+op_addk:	A.i = (unsigned) B.i + (short) pc->c; NEXT;
+op_sub:		A.i = (unsigned) B.i - C.i; NEXT;
+op_mul:		A.i = (unsigned) B.i * C.i; NEXT;
+op_mulk:	A.i = (unsigned) B.i * (short) pc->c; NEXT;
+op_div:		A.i = C.i != -1 ? B.i / C.i : - (unsigned) B.i; NEXT;
+op_rem:		A.i = C.i != -1 ? B.i % C.i : 0; NEXT;
+op_neg:		A.i = - (unsigned) B.i; NEXT;
+
+op_eq:		A.i = B.i == C.i; NEXT;
+op_ne:		A.i = B.i != C.i; NEXT;
+op_lt:		A.i = B.i < C.i; NEXT;
+op_gt:		A.i = B.i > C.i; NEXT;
+op_le:		A.i = B.i <= C.i; NEXT;
+op_ge:		A.i = B.i >= C.i; NEXT;
+op_not:		A.i = B.i == 0; NEXT;
+
+op_fadd:	A.d = B.d + C.d; NEXT;
+op_fsub:	A.d = B.d - C.d; NEXT;
+op_fmul:	A.d = B.d * C.d; NEXT;
+op_fdiv:	A.d = B.d / C.d; NEXT;
+op_fneg:	A.d = - B.d; NEXT;
+
+op_feq:		A.i = B.d == C.d; NEXT;
+op_fne:		A.i = B.d != C.d; NEXT;
+op_flt:		A.i = B.d < C.d; NEXT;
+op_fgt:		A.i = B.d > C.d; NEXT;
+op_fle:		A.i = B.d <= C.d; NEXT;
+op_fge:		A.i = B.d >= C.d; NEXT;
+op_fnot:	A.i = B.d == 0; NEXT;
+
+op_itof:	A.d = B.i; NEXT;
+op_ftoi:	A.i = (int) B.d; NEXT;
+op_sext:	A.i = (signed char) B.i; NEXT;
+
+op_ldb:		A.i = *(signed char *) host(B.i); NEXT;
+op_ldw:		memcpy(&A.i, host(B.i), sizeof(int)); NEXT;
+op_ldd:		memcpy(&A.d, host(B.i), sizeof(double)); NEXT;
+op_stb:		*host(A.i) = B.i; NEXT;
+op_stw:		memcpy(host(A.i), &B.i, sizeof(int)); NEXT;
+op_std:		memcpy(host(A.i), &B.d, sizeof(double)); NEXT;
+
+op_jump:	JUMP(pc->c);
+op_jz:		if (A.i == 0) JUMP(pc->c); NEXT;
+op_jnz:		if (A.i != 0) JUMP(pc->c); NEXT;
+op_fjz:		if (A.d == 0) JUMP(pc->c); NEXT;
+op_fjnz:	if (A.d != 0) JUMP(pc->c); NEXT;
+op_jeq:		if (A.i == B.i) JUMP(pc->c); NEXT;
+op_jne:		if (A.i != B.i) JUMP(pc->c); NEXT;
+op_jlt:		if (A.i < B.i) JUMP(pc->c); NEXT;
+op_jgt:		if (A.i > B.i) JUMP(pc->c); NEXT;
+op_jle:		if (A.i <= B.i) JUMP(pc->c); NEXT;
+op_jge:		if (A.i >= B.i) JUMP(pc->c); NEXT;
+
+op_switch:
+    {
+	const Table &table = code->tables[pc->b];
+
+	if (!table.targets.empty()) {
+	    at = (unsigned) A.i - table.low;
+	    JUMP(at < table.targets.size() ? table.targets[at] :
+		table.fallback);
+	}
+
+	auto it = lower_bound(table.values.begin(), table.values.end(),
+	    make_pair(A.i, 0u));
+
+	if (it != table.values.end() && it->first == A.i)
+	    JUMP(it->second);
+
+	JUMP(table.fallback);
+    }
+
+op_call:
+    frames.push_back(Frame {pc + 1, code, r, sp});
+    r += pc->a;
+    code = &compiled[pc->b];
+
+    if (r + code->registers > end || sp < stackBottom + code->frame)
+	error("stack overflow in " + code->name);
+
+    sp -= code->frame;
+    start = pc = code->code.data();
+    goto *labels[pc->op];
+
+op_library:
+    A = library(bridges[pc->b], &A);
+    NEXT;
+
+op_return:
+    r[0] = A;
+
+    if (frames.empty())
+	return r[0].i;
+
+    pc = frames.back().pc;
+    code = frames.back().code;
+    r = frames.back().r;
+    sp = frames.back().sp;
+    frames.pop_back();
+
+    start = code->code.data();
+    goto *labels[pc->op];
+
+# undef A
+# undef B
+# undef C
+# undef K
+# undef NEXT
+# undef JUMP
+}
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Append an instruction with the given operands to the
+ *		function being lowered and return its index.
+ */
+
+static unsigned emit(unsigned op, unsigned a = 0, unsigned b = 0,
+	unsigned c = 0)
+{
+    if (code->code.size() > USHRT_MAX)
+	error("function " + code->name + " is too large to interpret");
+
+    code->code.push_back(Instruction {(unsigned short) op,
+	(unsigned short) a, (unsigned short) b, (unsigned short) c});
+
+    return code->code.size() - 1;
+}
+
+
+/*
+ * Function:	immediate (private)
+ *
+ * Description:	Append an instruction with the given register and 32-bit
+ *		immediate.
+ */
+
+static void immediate(unsigned op, unsigned a, int k)
+{
+    emit(op, a, (unsigned) k & 0xffff, (unsigned) k >> 16);
+}
+
+
+/*
+ * Function:	patch (private)
+ *
+ * Description:	Make the given jumps go to the next instruction.
+ */
+
+static void patch(const vector<unsigned> &jumps)
+{
+    for (auto jump : jumps)
+	code->code[jump].c = code->code.size();
+}
+
+
+/*
+ * Function:	small (private)
+ *
+ * Description:	Return whether the given value fits in a 16-bit operand.
+ */
+
+static bool small(long long value)
+{
+    return value >= SHRT_MIN && value <= SHRT_MAX;
+}
+
+
+/*
+ * Function:	known (private)
+ *
+ * Description:	Return whether the given expression is an integer constant
+ *		whose register no common subexpression refers to, and if
+ *		so, its value.
+ */
+
+static bool known(Expression *expr, int &value)
+{
+    return shared.count(expr) == 0 && isConstant(expr, value);
+}
+
+
+/*
+ * Function:	temporary (private)
+ *
+ * Description:	Allocate a temporary register.
+ */
+
+static unsigned temporary()
+{
+    if (unused > USHRT_MAX)
+	error("function " + code->name + " has too many registers");
+
+    code->registers = max(code->registers, unused + 1);
+    return unused ++;
+}
+
+
+/*
+ * Function:	destination (private)
+ *
+ * Description:	Return the given target register, or a new temporary if
+ *		there is none.
+ */
+
+static unsigned destination(int target)
+{
+    return target < 0 ? temporary() : target;
+}
+
+
+/*
+ * Function:	result (private)
+ *
+ * Description:	Return the given register holding a value, first moving
+ *		the value to the given target register if there is one.
+ */
+
+static unsigned result(unsigned reg, int target)
+{
+    if (target < 0 || (unsigned) target == reg)
+	return reg;
+
+    emit(OP_MOVE, target, reg);
+    return target;
+}
+
+
+/*
+ * Function:	load (private)
+ *
+ * Description:	Return the instruction that loads a value of the given
+ *		type from memory.
+ */
+
+static unsigned load(const Type &type)
+{
+    if (type.isReal())
+	return OP_LDD;
+
+    return type.size() == 1 ? OP_LDB : OP_LDW;
+}
+
+
+/*
+ * Function:	store (private)
+ *
+ * Description:	Return the instruction that stores a value of the given
+ *		type to memory.
+ */
+
+static unsigned store(const Type &type)
+{
+    if (type.isReal())
+	return OP_STD;
+
+    return type.size() == 1 ? OP_STB : OP_STW;
+}
+
+
+/*
+ * Function:	scale (private)
+ *
+ * Description:	Return a register holding the value in the given register
+ *		multiplied by the given scale, if any.
+ */
+
+static unsigned scale(unsigned reg, unsigned factor)
+{
+    unsigned dest, temp;
+
+
+    if (factor <= 1)
+	return reg;
+
+    dest = temporary();
+
+    if (small(factor))
+	emit(OP_MULK, dest, reg, factor);
+    else {
+	temp = temporary();
+	immediate(OP_CONST, temp, factor);
+	emit(OP_MUL, dest, reg, temp);
+    }
+
+    return dest;
+}
+
+
+/*
+ * Function:	adjust (private)
+ *
+ * Description:	Add the given constant to the value of the given type in
+ *		one register, leaving the sum in the other.
+ */
+
+static void adjust(unsigned dest, unsigned reg, int step, const Type &type)
+{
+    unsigned temp;
+
+
+    if (type.isReal()) {
+	temp = temporary();
+	immediate(OP_REAL, temp, code->reals.size());
+	code->reals.push_back(step > 0 ? 1 : -1);
+	emit(OP_FADD, dest, reg, temp);
+	return;
+    }
+
+    if (small(step))
+	emit(OP_ADDK, dest, reg, (unsigned) step & 0xffff);
+    else {
+	temp = temporary();
+	immediate(OP_CONST, temp, step);
+	emit(OP_ADD, dest, reg, temp);
+    }
+
+    if (type.size() == 1)
+	emit(OP_SEXT, dest, dest);
+}
+
+
+/*
+ * Function:	address (private)
+ *
+ * Description:	Return a register holding the address of the given lvalue,
+ *		which is a variable in memory, a dereference, or a string.
+ */
+
+static unsigned address(Expression *expr)
+{
+    const Symbol *symbol;
+    Dereference *deref;
+    unsigned reg;
+
+
+    if ((symbol = identifier(expr)) != nullptr) {
+	reg = temporary();
+
+	if (offsets.count(symbol) > 0)
+	    immediate(OP_LOCAL, reg, offsets[symbol]);
+	else if (globals.count(symbol) > 0)
+	    immediate(OP_CONST, reg, globals[symbol]);
+	else
+	    error("cannot interpret reference to " + symbol->name());
+
+	return reg;
+    }
+
+    if (dynamic_cast<String *>(expr) != nullptr)
+	return value(expr, -1);
+
+    if ((deref = dynamic_cast<Dereference *>(expr)) == nullptr)
+	error("cannot interpret lvalue in " + code->name);
+
+    return value(deref->expr(), -1);
+}
+
+
+/*
+ * Function:	bridge (private)
+ *
+ * Description:	Return the index of a new bridge to the library function
+ *		called by the given expression.  The functions that
+ *		allocate memory are ours, and any other is looked up by
+ *		name.  Only as many arguments as fill the registers and
+ *		eight words of the stack, or sixteen words on the i386, may
+ *		be passed.
+ */
+
+static unsigned bridge(Call *expr)
+{
+    Bridge bridge;
+    unsigned ints, reals;
+
+
+    bridge.name = expr->id()->name();
+    bridge.address = nullptr;
+
+    if (bridge.name == "malloc")
+	bridge.kind = MALLOC;
+    else if (bridge.name == "calloc")
+	bridge.kind = CALLOC;
+    else if (bridge.name == "realloc")
+	bridge.kind = REALLOC;
+    else if (bridge.name == "free")
+	bridge.kind = FREE;
+    else
+	bridge.kind = LIBRARY;
+
+    if (bridge.kind == LIBRARY) {
+	bridge.address = dlsym(RTLD_DEFAULT, bridge.name.c_str());
+
+	if (bridge.address == nullptr)
+	    error("undefined symbol " + bridge.name);
+
+    } else if (expr->args().size() < (bridge.kind == MALLOC ||
+		bridge.kind == FREE ? 1u : 2u))
+	error("too few arguments to " + bridge.name);
+
+    ints = reals = 0;
+
+    for (auto arg : expr->args())
+	if (arg->type().isReal()) {
+	    bridge.args += 'd';
+	    reals ++;
+	} else {
+	    bridge.args += arg->type().isPointer() ? 'p' : 'i';
+	    ints ++;
+	}
+
+# if defined(__i386__)
+    if (ints + 2 * reals > 16)
+# else
+    if (max(ints, 6u) + max(reals, 8u) > 22)
+# endif
+	error("too many arguments to " + bridge.name);
+
+    if (expr->type().isReal())
+	bridge.result = 'd';
+    else if (expr->type().isPointer())
+	bridge.result = 'p';
+    else
+	bridge.result = expr->type().size() == 1 ? 'c' : 'i';
+
+    if (bridges.size() > USHRT_MAX)
+	error("too many library calls to interpret");
+
+    bridges.push_back(bridge);
+    return bridges.size() - 1;
+}
+
+
+/*
+ * Function:	call (private)
+ *
+ * Description:	Lower a function call.  The arguments are computed into
+ *		registers past any in use, where the callee finds them as
+ *		its first registers and leaves its result in the first.
+ */
+
+static unsigned call(Call *expr, int target)
+{
+    Expressions &args = expr->args();
+    const string &name = expr->id()->name();
+    unsigned base;
+
+
+    base = unused;
+
+    for (unsigned i = 0; i < max(args.size(), (size_t) 1); i ++)
+	temporary();
+
+    for (unsigned i = 0; i < args.size(); i ++)
+	value(args[i], base + i);
+
+    if (indices.count(name) > 0)
+	emit(OP_CALL, base, indices[name]);
+    else
+	emit(OP_LIBRARY, base, bridge(expr));
+
+    unused = base + 1;
+    return result(base, target);
+}
+
+
+/*
+ * Function:	operands (private)
+ *
+ * Description:	Lower the operands of the given binary expression, leaving
+ *		their values in the given registers.  As in the generator,
+ *		a variable in memory on the left is only read once the
+ *		right has been computed.
+ */
+
+static void operands(Binary *expr, unsigned &left, unsigned &right)
+{
+    const Symbol *symbol;
+
+
+    symbol = identifier(expr->left());
+
+    if (symbol != nullptr && registers.count(symbol) == 0 &&
+	    shared.count(expr->left()) == 0 && !symbol->type().isArray()) {
+	right = value(expr->right(), -1);
+	left = value(expr->left(), -1);
+    } else {
+	left = value(expr->left(), -1);
+	right = value(expr->right(), -1);
+    }
+}
+
+
+/*
+ * Function:	logical (private)
+ *
+ * Description:	Lower a logical expression, or a comparison of doubles, to
+ *		a value of one or zero by testing it.
+ */
+
+static unsigned logical(Expression *expr, int target)
+{
+    vector<unsigned> no, done;
+    unsigned dest;
+
+
+    test(expr, false, no);
+    dest = destination(target);
+    immediate(OP_CONST, dest, 1);
+    done.push_back(emit(OP_JUMP));
+    patch(no);
+    immediate(OP_CONST, dest, 0);
+    patch(done);
+    return dest;
+}
+
+
+/*
+ * Function:	add (private)
+ *
+ * Description:	Lower an addition, which scales an integer added to a
+ *		pointer.  A constant is added as an immediate.
+ */
+
+static unsigned add(Add *expr, int target)
+{
+    unsigned left, right, dest;
+    long long sum;
+    int k;
+
+
+    if (!expr->type().isReal() && known(expr->right(), k)) {
+	sum = (long long) k * max(expr->scaleRight, 1u);
+
+	if (small(sum)) {
+	    left = scale(value(expr->left(), -1), expr->scaleLeft);
+	    dest = destination(target);
+	    emit(OP_ADDK, dest, left, (unsigned) sum & 0xffff);
+	    return dest;
+	}
+    }
+
+    operands(expr, left, right);
+    dest = destination(target);
+
+    if (expr->type().isReal())
+	emit(OP_FADD, dest, left, right);
+    else
+	emit(OP_ADD, dest, scale(left, expr->scaleLeft),
+	    scale(right, expr->scaleRight));
+
+    return dest;
+}
+
+
+/*
+ * Function:	subtract (private)
+ *
+ * Description:	Lower a subtraction, which scales an integer subtracted
+ *		from a pointer and divides the difference of two pointers.
+ */
+
+static unsigned subtract(Subtract *expr, int target)
+{
+    unsigned left, right, dest, temp;
+    long long difference;
+    int k;
+
+
+    if (!expr->type().isReal() && expr->scaleResult == 0 &&
+	    known(expr->right(), k)) {
+	difference = -(long long) k * max(expr->scaleRight, 1u);
+
+	if (small(difference)) {
+	    left = value(expr->left(), -1);
+	    dest = destination(target);
+	    emit(OP_ADDK, dest, left, (unsigned) difference & 0xffff);
+	    return dest;
+	}
+    }
+
+    operands(expr, left, right);
+
+    if (expr->type().isReal()) {
+	dest = destination(target);
+	emit(OP_FSUB, dest, left, right);
+
+    } else if (expr->scaleResult > 1) {
+	temp = temporary();
+	emit(OP_SUB, temp, left, right);
+	right = temporary();
+	immediate(OP_CONST, right, expr->scaleResult);
+	dest = destination(target);
+	emit(OP_DIV, dest, temp, right);
+
+    } else {
+	right = scale(right, expr->scaleRight);
+	dest = destination(target);
+	emit(OP_SUB, dest, left, right);
+    }
+
+    return dest;
+}
+
+
+/*
+ * Function:	binary (private)
+ *
+ * Description:	Lower any other binary expression whose operands have the
+ *		same type, choosing the instruction by that type.  A
+ *		multiplication by a constant uses an immediate.
+ */
+
+static unsigned binary(Binary *expr, int target)
+{
+    unsigned op, left, right, dest;
+    bool real;
+    int k;
+
+
+    real = expr->left()->type().isReal();
+
+    if (dynamic_cast<Multiply *>(expr) != nullptr)
+	op = real ? OP_FMUL : OP_MUL;
+    else if (dynamic_cast<Divide *>(expr) != nullptr)
+	op = real ? OP_FDIV : OP_DIV;
+    else if (dynamic_cast<Remainder *>(expr) != nullptr)
+	op = OP_REM;
+    else if (dynamic_cast<Equal *>(expr) != nullptr)
+	op = real ? OP_FEQ : OP_EQ;
+    else if (dynamic_cast<NotEqual *>(expr) != nullptr)
+	op = real ? OP_FNE : OP_NE;
+    else if (dynamic_cast<LessThan *>(expr) != nullptr)
+	op = real ? OP_FLT : OP_LT;
+    else if (dynamic_cast<GreaterThan *>(expr) != nullptr)
+	op = real ? OP_FGT : OP_GT;
+    else if (dynamic_cast<LessOrEqual *>(expr) != nullptr)
+	op = real ? OP_FLE : OP_LE;
+    else if (dynamic_cast<GreaterOrEqual *>(expr) != nullptr)
+	op = real ? OP_FGE : OP_GE;
+    else
+	return logical(expr, target);
+
+    if (op == OP_MUL && known(expr->right(), k) && small(k)) {
+	left = value(expr->left(), -1);
+	dest = destination(target);
+	emit(OP_MULK, dest, left, (unsigned) k & 0xffff);
+	return dest;
+    }
+
+    operands(expr, left, right);
+    dest = destination(target);
+    emit(op, dest, left, right);
+    return dest;
+}
+
+
+/*
+ * Function:	cast (private)
+ *
+ * Description:	Lower a type cast.  A character is always kept sign
+ *		extended in its register, so only a conversion to or from a
+ *		double, or a truncation to a character, needs any code.
+ */
+
+static unsigned cast(Cast *expr, int target)
+{
+    const Type &from = expr->expr()->type(), &to = expr->type();
+    unsigned reg, dest;
+
+
+    if (from.isReal() == to.isReal())
+	if (to.isReal() || to.size() != 1 || from.size() == 1)
+	    return value(expr->expr(), target);
+
+    reg = value(expr->expr(), -1);
+    dest = destination(target);
+
+    if (from.isReal()) {
+	emit(OP_FTOI, dest, reg);
+
+	if (to.size() == 1)
+	    emit(OP_SEXT, dest, dest);
+
+    } else if (to.isReal())
+	emit(OP_ITOF, dest, reg);
+    else
+	emit(OP_SEXT, dest, reg);
+
+    return dest;
+}
+
+
+/*
+ * Function:	update (private)
+ *
+ * Description:	Lower an increment or decrement by the given step, whose
+ *		value is that of its operand beforehand, if it is kept.
+ */
+
+static unsigned update(Unary *expr, int step, int target, bool keep)
+{
+    const Type &type = expr->expr()->type();
+    const Symbol *symbol;
+    unsigned reg, dest, temp;
+
+
+    symbol = identifier(expr->expr());
+
+    if (symbol != nullptr && registers.count(symbol) > 0) {
+	reg = registers[symbol];
+	dest = keep ? destination(target) : reg;
+
+	if (keep)
+	    emit(OP_MOVE, dest, reg);
+
+	adjust(reg, reg, step, type);
+	return dest;
+    }
+
+    reg = address(expr->expr());
+    dest = destination(target);
+    emit(load(type), dest, reg);
+    temp = temporary();
+    adjust(temp, dest, step, type);
+    emit(store(type), reg, temp);
+    return dest;
+}
+
+
+/*
+ * Function:	compute (private)
+ *
+ * Description:	Lower the given expression, leaving its value in the given
+ *		target register if there is one, and return the register
+ *		holding its value.  The target is only written once all of
+ *		the operands have been read, so it may be one of them.
+ */
+
+static unsigned compute(Expression *expr, int target)
+{
+    const Symbol *symbol;
+    Expression *operand;
+    Integer *integer;
+    Real *real;
+    String *str;
+    unsigned reg, dest;
+    int k;
+
+
+    if (dynamic_cast<Common *>(expr) != nullptr)
+	return result(shared[((Common *) expr)->expr()], target);
+
+    if ((integer = dynamic_cast<Integer *>(expr)) != nullptr) {
+	dest = destination(target);
+	immediate(OP_CONST, dest, strtoul(integer->value().c_str(), NULL, 0));
+	return dest;
+    }
+
+    if ((real = dynamic_cast<Real *>(expr)) != nullptr) {
+	dest = destination(target);
+	immediate(OP_REAL, dest, code->reals.size());
+	code->reals.push_back(strtod(real->value().c_str(), NULL));
+	return dest;
+    }
+
+    if ((str = dynamic_cast<String *>(expr)) != nullptr) {
+	dest = destination(target);
+	immediate(OP_CONST, dest, intern(str->value()));
+	return dest;
+    }
+
+    if ((symbol = identifier(expr)) != nullptr) {
+	if (registers.count(symbol) > 0)
+	    return result(registers[symbol], target);
+
+	reg = address(expr);
+
+	if (symbol->type().isArray())
+	    return result(reg, target);
+
+	dest = destination(target);
+	emit(load(symbol->type()), dest, reg);
+	return dest;
+    }
+
+    if (dynamic_cast<Call *>(expr) != nullptr)
+	return call((Call *) expr, target);
+
+    if (dynamic_cast<Add *>(expr) != nullptr)
+	return add((Add *) expr, target);
+
+    if (dynamic_cast<Subtract *>(expr) != nullptr)
+	return subtract((Subtract *) expr, target);
+
+    if (dynamic_cast<Binary *>(expr) != nullptr)
+	return binary((Binary *) expr, target);
+
+    if (dynamic_cast<Cast *>(expr) != nullptr)
+	return cast((Cast *) expr, target);
+
+    if (dynamic_cast<Increment *>(expr) != nullptr)
+	return update((Unary *) expr, ((Increment *) expr)->scale, target,
+	    true);
+
+    if (dynamic_cast<Decrement *>(expr) != nullptr)
+	return update((Unary *) expr, -((Decrement *) expr)->scale, target,
+	    true);
+
+    if (dynamic_cast<Unary *>(expr) == nullptr)
+	error("cannot interpret expression in " + code->name);
+
+    operand = ((Unary *) expr)->expr();
+
+    if (dynamic_cast<Address *>(expr) != nullptr) {
+	if (dynamic_cast<Dereference *>(operand) != nullptr)
+	    return value(((Dereference *) operand)->expr(), target);
+
+	return result(address(operand), target);
+    }
+
+    if (isConstant(expr, k) && shared.count(expr) == 0) {
+	dest = destination(target);
+	immediate(OP_CONST, dest, k);
+	return dest;
+    }
+
+    reg = value(operand, -1);
+    dest = destination(target);
+
+    if (dynamic_cast<Dereference *>(expr) != nullptr)
+	emit(load(expr->type()), dest, reg);
+    else if (dynamic_cast<Negate *>(expr) != nullptr)
+	emit(operand->type().isReal() ? OP_FNEG : OP_NEG, dest, reg);
+    else
+	emit(operand->type().isReal() ? OP_FNOT : OP_NOT, dest, reg);
+
+    return dest;
+}
+
+
+/*
+ * Function:	value (private)
+ *
+ * Description:	Lower the given expression and return the register holding
+ *		its value, which is the given target register if there is
+ *		one.  A value that a common subexpression reuses is always
+ *		left in its own register.
+ */
+
+static unsigned value(Expression *expr, int target)
+{
+    if (shared.count(expr) == 0)
+	return compute(expr, target);
+
+    return result(compute(expr, shared[expr]), target);
+}
+
+
+/*
+ * Function:	test (private)
+ *
+ * Description:	Lower the given expression as a test, adding the jumps
+ *		taken if its value is the given truth value to the list.
+ *		Logical expressions short circuit, and a comparison of
+ *		integers or pointers jumps directly.
+ */
+
+static void test(Expression *expr, bool ifTrue, vector<unsigned> &jumps)
+{
+    static const map<string, pair<unsigned, unsigned>> jumpsFor = {
+	{typeid(Equal).name(), {OP_JEQ, OP_JNE}},
+	{typeid(NotEqual).name(), {OP_JNE, OP_JEQ}},
+	{typeid(LessThan).name(), {OP_JLT, OP_JGE}},
+	{typeid(GreaterThan).name(), {OP_JGT, OP_JLE}},
+	{typeid(LessOrEqual).name(), {OP_JLE, OP_JGT}},
+	{typeid(GreaterOrEqual).name(), {OP_JGE, OP_JLT}},
+    };
+
+    vector<unsigned> skip;
+    Binary *binary;
+    unsigned left, right, reg;
+
+
+    if (shared.count(expr) == 0) {
+	if (dynamic_cast<Not *>(expr) != nullptr) {
+	    test(((Not *) expr)->expr(), !ifTrue, jumps);
+	    return;
+	}
+
+	if (dynamic_cast<LogicalAnd *>(expr) != nullptr) {
+	    binary = (Binary *) expr;
+	    test(binary->left(), false, ifTrue ? skip : jumps);
+	    test(binary->right(), ifTrue, jumps);
+	    patch(skip);
+	    return;
+	}
+
+	if (dynamic_cast<LogicalOr *>(expr) != nullptr) {
+	    binary = (Binary *) expr;
+	    test(binary->left(), true, ifTrue ? jumps : skip);
+	    test(binary->right(), ifTrue, jumps);
+	    patch(skip);
+	    return;
+	}
+
+	auto it = jumpsFor.find(typeid(*expr).name());
+	binary = dynamic_cast<Binary *>(expr);
+
+	if (it != jumpsFor.end() && !binary->left()->type().isReal()) {
+	    operands(binary, left, right);
+	    jumps.push_back(emit(ifTrue ? it->second.first :
+		it->second.second, left, right));
+	    return;
+	}
+    }
+
+    reg = value(expr, -1);
+
+    if (expr->type().isReal())
+	jumps.push_back(emit(ifTrue ? OP_FJNZ : OP_FJZ, reg));
+    else
+	jumps.push_back(emit(ifTrue ? OP_JNZ : OP_JZ, reg));
+}
+
+
+/*
+ * Function:	loop (private)
+ *
+ * Description:	Lower a loop with the given test, body, and increment,
+ *		which may be null.  As in the generator, the test follows
+ *		the body and is reached by a jump.
+ */
+
+static void loop(Expression *expr, Statement *body, Statement *incr)
+{
+    vector<unsigned> entry, again, done, *outer;
+    unsigned top;
+
+
+    outer = exits;
+    exits = &done;
+
+    entry.push_back(emit(OP_JUMP));
+    top = code->code.size();
+    statement(body);
+
+    if (incr != nullptr)
+	statement(incr);
+
+    patch(entry);
+    unused = reserved;
+
+    if (expr != nullptr)
+	test(expr, true, again);
+    else
+	again.push_back(emit(OP_JUMP));
+
+    for (auto jump : again)
+	code->code[jump].c = top;
+
+    patch(done);
+    exits = outer;
+}
+
+
+/*
+ * Function:	branch (private)
+ *
+ * Description:	Lower a switch statement, whose sections are laid out in
+ *		order after a single instruction that dispatches on the
+ *		value through a table.
+ */
+
+static void branch(Switch *stmt)
+{
+    vector<unsigned> done, *outer;
+    vector<pair<int, unsigned>> values;
+    Table table;
+    unsigned index;
+
+
+    index = code->tables.size();
+    emit(OP_SWITCH, value(stmt->expr(), -1), index);
+    code->tables.push_back(Table());
+
+    outer = exits;
+    exits = &done;
+    table.fallback = USHRT_MAX + 1;
+
+    for (auto &section : stmt->cases()) {
+	for (auto value : section.values)
+	    values.push_back(make_pair(value, code->code.size()));
+
+	if (section.isDefault)
+	    table.fallback = code->code.size();
+
+	statement(section.stmt);
+    }
+
+    if (table.fallback > USHRT_MAX)
+	table.fallback = code->code.size();
+
+    patch(done);
+    exits = outer;
+
+    sort(values.begin(), values.end());
+    table.low = values.empty() ? 0 : values[0].first;
+
+    if (!values.empty() && (long long) values.back().first - table.low <
+	    (long long) values.size() * TABLE_DENSITY) {
+	table.targets.assign(values.back().first - table.low + 1,
+	    table.fallback);
+
+	for (auto &entry : values)
+	    table.targets[entry.first - table.low] = entry.second;
+
+    } else
+	table.values = values;
+
+    code->tables[index] = table;
+}
+
+
+/*
+ * Function:	statement (private)
+ *
+ * Description:	Lower the given statement.  No temporary is live from one
+ *		statement to the next, so they all start afresh.
+ */
+
+static void statement(Statement *stmt)
+{
+    vector<unsigned> elses, done;
+    const Symbol *symbol;
+    Assignment *assign;
+    Expression *expr;
+    Return *ret;
+    While *loops;
+    For *iter;
+    If *cond;
+    unsigned reg;
+
+
+    unused = reserved;
+
+    if (stmt == nullptr)
+	return;
+
+    if (dynamic_cast<Increment *>(stmt) != nullptr)
+	update((Unary *) stmt, ((Increment *) stmt)->scale, -1, false);
+
+    else if (dynamic_cast<Decrement *>(stmt) != nullptr)
+	update((Unary *) stmt, -((Decrement *) stmt)->scale, -1, false);
+
+    else if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr)
+	value(expr, -1);
+
+    else if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	symbol = identifier(assign->left());
+
+	if (symbol != nullptr && registers.count(symbol) > 0)
+	    value(assign->right(), registers[symbol]);
+	else {
+	    reg = value(assign->right(), -1);
+	    emit(store(assign->left()->type()), address(assign->left()), reg);
+	}
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr) {
+	if (ret->expr() != nullptr)
+	    reg = value(ret->expr(), -1);
+	else
+	    immediate(OP_CONST, reg = temporary(), 0);
+
+	emit(OP_RETURN, reg);
+
+    } else if (dynamic_cast<Break *>(stmt) != nullptr)
+	exits->push_back(emit(OP_JUMP));
+
+    else if (dynamic_cast<Block *>(stmt) != nullptr) {
+	for (auto child : ((Block *) stmt)->statements())
+	    statement(child);
+
+    } else if ((loops = dynamic_cast<While *>(stmt)) != nullptr)
+	loop(loops->expr(), loops->stmt(), nullptr);
+
+    else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	statement(iter->init());
+	loop(iter->expr(), iter->stmt(), iter->incr());
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	test(cond->expr(), false, elses);
+	statement(cond->thenStmt());
+
+	if (cond->elseStmt() != nullptr) {
+	    if (completes(cond->thenStmt()))
+		done.push_back(emit(OP_JUMP));
+
+	    patch(elses);
+	    statement(cond->elseStmt());
+	    patch(done);
+	} else
+	    patch(elses);
+
+    } else if (dynamic_cast<Switch *>(stmt) != nullptr)
+	branch((Switch *) stmt);
+}
+
+
+/*
+ * Function:	lower (private)
+ *
+ * Description:	Lower the given function to bytecode.  The parameters are
+ *		its first registers, followed by its other locals in
+ *		registers and the values reused by common subexpressions.
+ *		The arrays and the locals whose address is taken are laid
+ *		out in the memory of the frame, and a parameter among them
+ *		is stored there on entry, as is a character parameter sign
+ *		extended.
+ */
+
+static void lower(Function *function, Code &output)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    const Symbols &decls = function->body()->declarations()->symbols();
+    unsigned count, size, alignment, reg;
+    Statement *body;
+    SymbolSet escaped;
+
+
+    code = &output;
+    code->name = function->id()->name();
+    code->registers = code->frame = 0;
+    registers.clear();
+    offsets.clear();
+    shared.clear();
+
+    body = function->body();
+    statements(body, stmts);
+    escaping(body, escaped);
+    count = function->id()->type().parameters()->types.size();
+
+    for (unsigned i = 0; i < count; i ++)
+	registers[decls[i]] = i;
+
+    unused = count;
+
+    for (auto slot : stmts)
+	if (dynamic_cast<Block *>(*slot) != nullptr)
+	    for (auto symbol : ((Block *) *slot)->declarations()->symbols()) {
+		if (offsets.count(symbol) > 0)
+		    continue;
+
+		if (registers.count(symbol) > 0 && escaped.count(symbol) == 0)
+		    continue;
+
+		if (!symbol->type().isArray() && escaped.count(symbol) == 0) {
+		    registers[symbol] = unused ++;
+		    continue;
+		}
+
+		size = symbol->type().size();
+		alignment = symbol->type().isArray() ?
+		    Type(symbol->type().specifier(),
+			symbol->type().indirection()).size() : size;
+
+		code->frame = (code->frame + alignment - 1) / alignment *
+		    alignment;
+		offsets[symbol] = code->frame;
+		code->frame += size;
+	    }
+
+    code->frame = (code->frame + 7) / 8 * 8;
+
+    for (auto slot : stmts)
+	expressions(*slot, exprs);
+
+    for (auto slot : exprs)
+	if (dynamic_cast<Common *>(*slot) != nullptr)
+	    if (shared.count(((Common *) *slot)->expr()) == 0)
+		shared[((Common *) *slot)->expr()] = unused ++;
+
+    reserved = unused;
+    code->registers = max(reserved, 1u);
+
+    if (reserved > USHRT_MAX)
+	error("function " + code->name + " has too many registers");
+
+    for (unsigned i = 0; i < count; i ++) {
+	if (offsets.count(decls[i]) > 0) {
+	    registers.erase(decls[i]);
+	    reg = temporary();
+	    immediate(OP_LOCAL, reg, offsets[decls[i]]);
+	    emit(store(decls[i]->type()), reg, i);
+	    unused = reserved;
+
+	} else if (!decls[i]->type().isReal() &&
+		decls[i]->type().size() == 1)
+	    emit(OP_SEXT, i, i);
+    }
+
+    statement(body);
+
+    if (completes(body)) {
+	unused = reserved;
+	immediate(OP_CONST, reg = temporary(), 0);
+	emit(OP_RETURN, reg);
+    }
+}
+
+
+/*
+ * Function:	layout (private)
+ *
+ * Description:	Lay out the global variables in static data along with
+ *		their initializers, as the generator would.
+ */
+
+static void layout(Scope *scope)
+{
+    unsigned address, at;
+    double real;
+    int integer;
+    String *str;
+
+
+    for (auto symbol : scope->symbols()) {
+	const Type &type = symbol->type();
+
+	if (type.isFunction())
+	    continue;
+
+	Type element(type.specifier(), type.indirection());
+	address = reserve(type.size(), element.size());
+	globals[symbol] = at = address;
+
+	for (auto expr : symbol->initializer)
+	    if ((str = dynamic_cast<String *>(expr)) != nullptr) {
+		if (element.isPointer()) {
+		    integer = intern(str->value());
+		    memcpy(host(at), &integer, sizeof(integer));
+		    at += element.size();
+		} else {
+		    memcpy(host(at), str->value().data(), str->value().size());
+		    at += str->value().size();
+		}
+
+	    } else if (element.isReal()) {
+		if (dynamic_cast<Real *>(expr) != nullptr)
+		    real = strtod(((Real *) expr)->value().c_str(), NULL);
+		else
+		    real = strtod(((Integer *) expr)->value().c_str(), NULL);
+
+		memcpy(host(at), &real, sizeof(real));
+		at += element.size();
+
+	    } else {
+		integer = strtoul(((Integer *) expr)->value().c_str(), NULL, 0);
+		memcpy(host(at), &integer, element.size());
+		at += element.size();
+	    }
+    }
+}
+
+
+/*
+ * Function:	interpret
+ *
+ * Description:	Interpret the program consisting of the given functions and
+ *		global variables, calling its main function with the given
+ *		arguments, and return the status that main returns.
+ */
+
+int interpret(const vector<Function *> &functions, Scope *scope, int argc,
+	char *argv[])
+{
+    Value *r;
+    unsigned array, address;
+
+
+    mapMemory();
+    layout(scope);
+
+    for (unsigned i = 0; i < functions.size(); i ++)
+	indices[functions[i]->id()->name()] = i;
+
+    if (indices.count("main") == 0)
+	error("no main function");
+
+    if (functions.size() > USHRT_MAX)
+	error("too many functions to interpret");
+
+    compiled.resize(functions.size());
+
+    for (unsigned i = 0; i < functions.size(); i ++)
+	lower(functions[i], compiled[i]);
+
+    r = new Value[REGISTERS];
+    array = reserve((argc + 1) * SIZEOF_PTR, SIZEOF_PTR);
+
+    for (int i = 0; i <= argc; i ++) {
+	address = i < argc ? intern(argv[i]) : 0;
+	memcpy(host(array + i * SIZEOF_PTR), &address, SIZEOF_PTR);
+    }
+
+    r[0].i = argc;
+    r[1].i = array;
+
+    if (compiled[indices["main"]].registers > REGISTERS)
+	error("stack overflow in main");
+
+    return execute(&compiled[indices["main"]], r);
+}
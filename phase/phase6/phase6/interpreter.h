@@ -0,0 +1,16 @@
+/*
+ * File:	interpreter.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		bytecode interpreter for Simple C.
+ */
+
+# ifndef INTERPRETER_H
+# define INTERPRETER_H
+# include <vector>
+# include "Tree.h"
+
+int interpret(const std::vector<Function *> &functions, Scope *globals,
+	int argc, char *argv[]);
+
+# endif /* INTERPRETER_H */
@@ -0,0 +1,144 @@
+/*
+ * File:	jumper.cpp
+ *
+ * Description:	This file contains the function definitions for finding
+ *		calls in tail position in Simple C.
+ *
+ *		A call is in tail position if it is the expression of a
+ *		return statement, or if it is a statement after which the
+ *		function simply ends.  Such a call is marked so that the
+ *		generator can replace it with a jump: a call to the function
+ *		itself jumps back to the start of its body after storing the
+ *		arguments into the parameters, and any other call releases
+ *		our stack frame and jumps to the callee, which then returns
+ *		directly to our caller.
+ *
+ *		The arguments on the stack are stored over our own
+ *		parameters on the stack, so they must fit.  Since our frame
+ *		is either reused or released, no call is marked if the
+ *		address of any local variable is taken, as the callee might
+ *		still refer to it.
+ */
+
+# include "generator.h"
+# include "optimizer.h"
+
+using namespace std;
+
+static Function *function;
+static unsigned params;
+static unsigned marked;
+
+
+/*
+ * Function:	mark (private)
+ *
+ * Description:	Mark the given expression as a tail call if it is a call
+ *		that can be replaced with a jump.
+ */
+
+static void mark(Expression *expr)
+{
+    const Type &type = function->id()->type();
+    Type result(type.specifier(), type.indirection());
+    Call *call;
+    unsigned size;
+
+
+    if ((call = dynamic_cast<Call *>(expr)) == nullptr)
+	return;
+
+    if (call->type().isReal() != result.isReal())
+	return;
+
+    size = 0;
+
+    for (unsigned i = 0; i < call->args().size(); i ++)
+	if (i >= registerArguments(call->id()))
+	    size += call->args()[i]->type().promote().size();
+
+    if (size > params)
+	return;
+
+    call->tail = true;
+    marked ++;
+}
+
+
+/*
+ * Function:	mark (private)
+ *
+ * Description:	Mark the tail calls within the given statement.  The flag
+ *		indicates whether the function ends after the statement.
+ */
+
+static void mark(Statement *stmt, bool last)
+{
+    Expression *expr;
+    Return *ret;
+    Block *block;
+    If *cond;
+    Switch *branch;
+    unsigned i;
+
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr) {
+	if (last)
+	    mark(expr);
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr)
+	mark(ret->expr());
+
+    else if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (i = 0; i < block->statements().size(); i ++)
+	    mark(block->statements()[i],
+		    last && i + 1 == block->statements().size());
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	mark(cond->thenStmt(), last);
+
+	if (cond->elseStmt() != nullptr)
+	    mark(cond->elseStmt(), last);
+
+    } else if (dynamic_cast<While *>(stmt) != nullptr)
+	mark(((While *) stmt)->stmt(), false);
+
+    else if (dynamic_cast<For *>(stmt) != nullptr)
+	mark(((For *) stmt)->stmt(), false);
+
+    else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr)
+	for (auto &section : branch->cases())
+	    mark(section.stmt, false);
+}
+
+
+/*
+ * Function:	markTailCalls
+ *
+ * Description:	Mark the calls in tail position within the given function
+ *		that can be replaced with jumps.
+ */
+
+void markTailCalls(Function *fn)
+{
+    Parameters *declared;
+
+
+    function = fn;
+    const Analysis &analysis = analyze(function);
+
+    for (auto symbol : analysis.escaped)
+	if (analysis.locals.count(symbol) > 0)
+	    return;
+
+    params = 0;
+    declared = function->id()->type().parameters();
+
+    for (unsigned i = 0; i < declared->types.size(); i ++)
+	if (i >= registerArguments(function->id()))
+	    params += declared->types[i].promote().size();
+
+    marked = 0;
+    mark(function->body(), true);
+    count("tail calls replaced with jumps", marked);
+}
@@ -7,8 +7,10 @@
 
 # ifndef LEXER_H
 # define LEXER_H
+# include <cstdio>
 # include <string>
 
+extern FILE *yyin;
 extern char *yytext;
 extern int yylineno, numerrors;
 
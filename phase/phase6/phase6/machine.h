@@ -10,18 +10,24 @@
 # define SIZEOF_DOUBLE 8
 # define SIZEOF_PTR 4
 # define SIZEOF_REG 4
+# define SIZEOF_VECTOR 16
+# define VECTOR_REGISTERS 8
 
 # if defined (__linux__) && (defined(__i386__) || defined(__x86_64__))
 
 # define STACK_ALIGNMENT 16
 # define global_prefix ""
 # define label_prefix ".L"
+# define PROFILE_FLAGS 0x241
+# define PROFILE_SECTION ".section\t.fini_array,\"aw\""
 
 # elif defined (__APPLE__) && (defined(__i386__) || defined(__x86_64__))
 
 # define STACK_ALIGNMENT 16
 # define global_prefix "_"
 # define label_prefix "L"
+# define PROFILE_FLAGS 0x601
+# define PROFILE_SECTION ".mod_term_func"
 
 # else
 
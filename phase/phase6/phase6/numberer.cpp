@@ -0,0 +1,409 @@
+/*
+ * File:	numberer.cpp
+ *
+ * Description:	This file contains the function definitions for local
+ *		value numbering of expressions in Simple C.
+ *
+ *		The statements are visited in the order in which code is
+ *		generated for them, keeping a table of the expressions
+ *		whose values are available.  An expression equal to one in
+ *		the table is replaced by a common subexpression, which
+ *		simply reuses the result of the earlier expression.
+ *
+ *		Expressions are removed from the table when a variable they
+ *		read is assigned, and loads through pointers are removed
+ *		when a store might refer to the same object or a call might
+ *		change what they read.  A call to a read-only function has
+ *		no such effect, and its value is itself available until a
+ *		store changes what it might read.
+ *
+ *		The table follows the dominators of each statement rather
+ *		than being emptied at every label.  The then and else parts
+ *		of an if statement and the body of a loop start with the
+ *		table as it was after the test, since they can only be
+ *		reached from it.  If only one part of an if statement can
+ *		complete normally, the statements after it continue with
+ *		the table from that part; otherwise, they continue with the
+ *		expressions from before the if statement that are still in
+ *		the tables from both parts.  Unless its body breaks out of
+ *		it, a loop is only left from its test, so the statements
+ *		after it continue with the table as it was after the test.
+ */
+
+# include <algorithm>
+# include <typeinfo>
+# include "optimizer.h"
+
+using namespace std;
+
+typedef vector<Expression *> Table;
+
+static SymbolSet locals, escaped, unshared;
+static Table table;
+static unsigned eliminated;
+
+static void number(Expression *&expr, bool replace);
+static void number(Statement *stmt);
+
+
+/*
+ * Function:	reads (private)
+ *
+ * Description:	Add the symbols whose values are read by the given
+ *		expression to the set, and return whether it also loads
+ *		through a pointer or calls a function that is not pure.
+ *		The operand of an address expression is not read.
+ */
+
+static bool reads(Expression *expr, SymbolSet &symbols)
+{
+    vector<Expression **> operands;
+    bool loads;
+
+
+    if (dynamic_cast<Common *>(expr) != nullptr)
+	return reads(((Common *) expr)->expr(), symbols);
+
+    if (identifier(expr) != nullptr) {
+	symbols.insert(identifier(expr));
+	return false;
+    }
+
+    if (dynamic_cast<Address *>(expr) != nullptr) {
+	expr = ((Address *) expr)->expr();
+
+	if (identifier(expr) != nullptr)
+	    return false;
+
+	return reads(((Unary *) expr)->expr(), symbols);
+    }
+
+    loads = dynamic_cast<Dereference *>(expr) != nullptr;
+
+    if (dynamic_cast<Call *>(expr) != nullptr)
+	loads = !isPure(((Call *) expr)->id());
+
+    children(expr, operands);
+
+    for (auto slot : operands)
+	if (reads(*slot, symbols))
+	    loads = true;
+
+    return loads;
+}
+
+
+/*
+ * Function:	shared (private)
+ *
+ * Description:	Return whether the given symbol might also be changed
+ *		through a pointer or by another function.  A const variable
+ *		is never changed.
+ */
+
+static bool shared(const Symbol *symbol)
+{
+    if (symbol->type().isConst())
+	return false;
+
+    return locals.count(symbol) == 0 || escaped.count(symbol) > 0;
+}
+
+
+/*
+ * Function:	kill (private)
+ *
+ * Description:	Remove the expressions from the table whose values might
+ *		be changed by a store to the given reference, or by a call
+ *		if the reference is null.
+ */
+
+static void kill(Expression *target)
+{
+    SymbolSet symbols;
+    unsigned i, j;
+    bool changed;
+
+
+    for (i = j = 0; i < table.size(); i ++) {
+	if (target != nullptr)
+	    changed = clobbers(target, table[i], unshared);
+	else {
+	    symbols.clear();
+	    changed = reads(table[i], symbols);
+
+	    for (auto read : symbols)
+		if (shared(read))
+		    changed = true;
+	}
+
+	if (!changed)
+	    table[j ++] = table[i];
+    }
+
+    table.resize(j);
+}
+
+
+/*
+ * Function:	available (private)
+ *
+ * Description:	Return whether the value of the given expression may be
+ *		entered in the table.  Only integer and pointer arithmetic,
+ *		comparisons, loads, and calls to read-only functions are
+ *		considered.  Real and string literals are excluded, since
+ *		the generator treats them specially, as are other calls and
+ *		increments, which have side effects.
+ */
+
+static bool available(Expression *expr)
+{
+    vector<Expression **> slots;
+    const type_info &id = typeid(*expr);
+
+
+    if (expr->type().isReal() || expr->type().size() != 4)
+	return false;
+
+    if (id != typeid(Add) && id != typeid(Subtract) &&
+	    id != typeid(Multiply) && id != typeid(Divide) &&
+	    id != typeid(Remainder) && id != typeid(LessThan) &&
+	    id != typeid(GreaterThan) && id != typeid(LessOrEqual) &&
+	    id != typeid(GreaterOrEqual) && id != typeid(Equal) &&
+	    id != typeid(NotEqual) && id != typeid(Not) &&
+	    id != typeid(Negate) && id != typeid(Dereference) &&
+	    id != typeid(Call))
+	return false;
+
+    expressions(expr, slots);
+
+    for (auto slot : slots)
+	if (dynamic_cast<Call *>(*slot) != nullptr) {
+	    if (!isReadOnly(((Call *) *slot)->id()))
+		return false;
+
+	} else if (dynamic_cast<Real *>(*slot) != nullptr ||
+		dynamic_cast<String *>(*slot) != nullptr ||
+		dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr)
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	store (private)
+ *
+ * Description:	Number the subexpressions of the given lvalue and then
+ *		remove the expressions from the table that are changed by
+ *		storing to it.
+ */
+
+static void store(Expression *expr)
+{
+    if (identifier(expr) != nullptr)
+	kill(expr);
+
+    else if (dynamic_cast<Dereference *>(expr) != nullptr) {
+	number(((Unary *) expr)->expr(), true);
+	kill(expr);
+    }
+}
+
+
+/*
+ * Function:	number (private)
+ *
+ * Description:	Number the given expression, whose subexpressions are
+ *		evaluated in order.  If the expression may be replaced and
+ *		its value is already available, it is replaced by a common
+ *		subexpression.  Otherwise, its value becomes available if
+ *		possible.
+ */
+
+static void number(Expression *&expr, bool replace)
+{
+    vector<Expression **> operands;
+    Binary *binary;
+    Expression *operand;
+    Table saved;
+
+
+    if (dynamic_cast<LogicalAnd *>(expr) != nullptr ||
+	    dynamic_cast<LogicalOr *>(expr) != nullptr) {
+	binary = (Binary *) expr;
+	number(binary->left(), true);
+	saved = table;
+	number(binary->right(), true);
+
+	for (unsigned i = 0; i < saved.size(); i ++)
+	    if (find(table.begin(), table.end(), saved[i]) == table.end())
+		saved.erase(saved.begin() + i --);
+
+	table = saved;
+	return;
+    }
+
+    if (dynamic_cast<Increment *>(expr) != nullptr ||
+	    dynamic_cast<Decrement *>(expr) != nullptr) {
+	store(((Unary *) expr)->expr());
+	return;
+    }
+
+    if (dynamic_cast<Address *>(expr) != nullptr) {
+	operand = ((Unary *) expr)->expr();
+
+	if (dynamic_cast<Dereference *>(operand) != nullptr)
+	    number(((Unary *) operand)->expr(), true);
+
+	return;
+    }
+
+    children(expr, operands);
+
+    for (auto slot : operands)
+	number(*slot, true);
+
+    if (dynamic_cast<Call *>(expr) != nullptr)
+	if (!isReadOnly(((Call *) expr)->id())) {
+	    kill(nullptr);
+	    return;
+	}
+
+    if (!available(expr))
+	return;
+
+    if (replace)
+	for (auto prior : table)
+	    if (equal(prior, expr)) {
+		expr = new Common(prior);
+		eliminated ++;
+		return;
+	    }
+
+    table.push_back(expr);
+}
+
+
+/*
+ * Function:	meet (private)
+ *
+ * Description:	Remove the expressions from the table that are not also in
+ *		the given table.
+ */
+
+static void meet(const Table &other)
+{
+    unsigned i, j;
+
+
+    for (i = j = 0; i < table.size(); i ++)
+	if (find(other.begin(), other.end(), table[i]) != other.end())
+	    table[j ++] = table[i];
+
+    table.resize(j);
+}
+
+
+/*
+ * Function:	number (private)
+ *
+ * Description:	Number the expressions in the given statement.
+ */
+
+static void number(Statement *stmt)
+{
+    Expression *expr;
+    Assignment *assign;
+    Return *ret;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+    Table saved;
+
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr)
+	number(expr, false);
+
+    else if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	number(assign->right(), true);
+	store(assign->left());
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr) {
+	number(ret->expr(), true);
+	table.clear();
+
+    } else if (dynamic_cast<Break *>(stmt) != nullptr)
+	table.clear();
+
+    else if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    number(child);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	number(cond->expr(), true);
+	saved = table;
+	number(cond->thenStmt());
+	swap(table, saved);
+
+	if (cond->elseStmt() != nullptr)
+	    number(cond->elseStmt());
+
+	if (completes(cond->thenStmt())) {
+	    if (cond->elseStmt() == nullptr || completes(cond->elseStmt()))
+		meet(saved);
+	    else
+		table = saved;
+	}
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr) {
+	table.clear();
+	number(loop->expr(), true);
+	saved = table;
+	number(loop->stmt());
+	table = breaks(loop->stmt()) ? Table() : saved;
+
+    } else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	number(iter->init());
+	table.clear();
+	number(iter->expr(), true);
+	saved = table;
+	number(iter->stmt());
+	number(iter->incr());
+	table = breaks(iter->stmt()) ? Table() : saved;
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	number(branch->expr(), true);
+
+	for (auto &section : branch->cases()) {
+	    table.clear();
+	    number(section.stmt);
+	}
+
+	table.clear();
+    }
+}
+
+
+/*
+ * Function:	numberValues
+ *
+ * Description:	Replace the common subexpressions within each basic block
+ *		of the given function.
+ */
+
+void numberValues(Function *function)
+{
+    table.clear();
+    eliminated = 0;
+
+    locals = analyze(function).locals;
+    escaped = analyze(function).escaped;
+    unshared = analyze(function).privates;
+    number(function->body());
+
+    count("expressions eliminated by value numbering", eliminated);
+}
@@ -0,0 +1,1307 @@
+/*
+ * File:	optimizer.cpp
+ *
+ * Description:	This file contains the public function definitions for
+ *		the optimizer for Simple C, along with the utility
+ *		functions shared by the individual passes.
+ *
+ *		The passes are run by a simple pass manager.  Each pass is
+ *		registered in a table with its name, the lowest optimization
+ *		level at which it runs, and whether it keeps the analysis of
+ *		a function up to date.  A pass may be turned off by name,
+ *		and a pass that depends on another asks whether the other
+ *		is enabled.  The running time of each pass may be recorded,
+ *		and the number of passes run may be limited so that a bad
+ *		transformation can be found by bisection.
+ *
+ *		The tree is walked using "slots," which are pointers to the
+ *		fields of a node that hold its children.  A pass that wants
+ *		to replace a child simply assigns through the slot.  Note
+ *		that an expression used as a statement has no expression
+ *		slot of its own, only a statement slot.
+ */
+
+# include <chrono>
+# include <cstdlib>
+# include <iomanip>
+# include <iostream>
+# include <typeinfo>
+# include "optimizer.h"
+
+using namespace std;
+using namespace std::chrono;
+
+
+/* A pass registered with the pass manager */
+
+struct Pass {
+    const char *name;
+    void (*run)(Function *);
+    unsigned level;
+    bool exact;
+    bool preserves;
+};
+
+
+/* The time spent in a pass and the number of times it was run */
+
+struct Timing {
+    duration<double> time;
+    unsigned runs;
+};
+
+
+/*
+ * The passes in the order in which they are run.  The passes that run on
+ * all of the functions together have no function of their own, and nor do
+ * the last few, which the generator carries out as it goes and which are
+ * scheduled for each function when they are first needed.  An exact pass
+ * leaves the loops and calls as they are, and so may be run in an
+ * instrumented build.
+ */
+
+static const Pass passes[] = {
+    {"ipa-cp", nullptr, 2, true, false},
+    {"ipa-pure-const", nullptr, 1, true, false},
+    {"fold-constants", foldConstants, 1, true, true},
+    {"inline", inlineCalls, 2, false, false},
+    {"unroll-loops", unrollLoops, 2, false, false},
+    {"ccp", evaluateConstants, 1, false, false},
+    {"strength-reduce", reduceStrength, 1, true, false},
+    {"dce", eliminateDeadCode, 1, true, true},
+    {"pre", placeExpressions, 2, false, false},
+    {"value-numbering", numberValues, 1, true, true},
+    {"tree-vectorize", vectorizeLoops, 2, false, true},
+    {"optimize-sibling-calls", markTailCalls, 1, true, true},
+    {"promote-registers", promoteVariables, 1, true, true},
+    {"remove-unused", nullptr, 1, true, false},
+    {"divide-by-constant", nullptr, 1, true, true},
+    {"direct-arguments", nullptr, 1, true, true},
+    {"omit-frame-pointer", nullptr, 1, true, true},
+    {"register-arguments", nullptr, 1, true, true},
+    {"branch-layout", nullptr, 1, true, true},
+};
+
+static unsigned level = 2;
+static set<string> disabled;
+static bool timing = false;
+static long limit = -1, bisected = 0;
+
+static map<string, Timing> timings;
+static map<pair<string, string>, bool> decisions;
+static map<const Function *, Analysis> analyses;
+static map<string, unsigned> statistics;
+
+
+/*
+ * Function:	configure
+ *
+ * Description:	Handle the given command-line option if it is one of those
+ *		of the pass manager, and return whether it was.  The -O0,
+ *		-O1, and -O2 options set the optimization level, -fno-name
+ *		turns off the named pass, -time-passes records the time
+ *		spent in each pass, and -opt-bisect-limit=n runs only the
+ *		first n passes, writing each decision to the standard error.
+ */
+
+bool configure(const string &option)
+{
+    string bisect = "-opt-bisect-limit=";
+
+
+    if (option == "-O0" || option == "-O1" || option == "-O2")
+	level = option[2] - '0';
+    else if (option == "-time-passes")
+	timing = true;
+    else if (option.compare(0, bisect.size(), bisect) == 0)
+	limit = strtol(option.c_str() + bisect.size(), NULL, 0);
+    else if (option.compare(0, 5, "-fno-") == 0) {
+	for (auto &pass : passes)
+	    if (option.substr(5) == pass.name) {
+		disabled.insert(pass.name);
+		return true;
+	    }
+
+	return false;
+    } else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	lookup (private)
+ *
+ * Description:	Return the registered pass with the given name.
+ */
+
+static const Pass &lookup(const string &name)
+{
+    for (auto &pass : passes)
+	if (name == pass.name)
+	    return pass;
+
+    cerr << "unknown pass " << name << endl;
+    abort();
+}
+
+
+/*
+ * Function:	enabled
+ *
+ * Description:	Return whether the named pass will be run on the functions,
+ *		given the optimization level, the passes turned off, and
+ *		whether the build is instrumented.
+ */
+
+bool enabled(const string &name)
+{
+    const Pass &pass = lookup(name);
+
+
+    if (pass.level > level || disabled.count(pass.name) > 0)
+	return false;
+
+    return pass.exact || profileOutput.empty();
+}
+
+
+/*
+ * Function:	schedule (private)
+ *
+ * Description:	Return whether the given pass should be run on the named
+ *		unit now.  If there is a bisection limit, each pass that is
+ *		enabled is numbered, and only the first few are run.
+ */
+
+static bool schedule(const Pass &pass, const string &unit)
+{
+    bool running;
+
+
+    if (!enabled(pass.name))
+	return false;
+
+    if (limit < 0)
+	return true;
+
+    running = ++ bisected <= limit;
+    cerr << "BISECT: " << (running ? "running" : "NOT running");
+    cerr << " pass (" << bisected << ") " << pass.name;
+    cerr << " on " << unit << endl;
+    return running;
+}
+
+
+/*
+ * Function:	run (private)
+ *
+ * Description:	Run the given pass on the named unit if it should be run,
+ *		recording its time.  The analysis of each function is
+ *		discarded if the pass does not preserve it.
+ */
+
+template<class Body>
+static void run(const Pass &pass, const string &unit, Body body)
+{
+    steady_clock::time_point start;
+
+
+    if (!schedule(pass, unit))
+	return;
+
+    start = steady_clock::now();
+    body();
+
+    if (timing) {
+	timings[pass.name].time += steady_clock::now() - start;
+	timings[pass.name].runs ++;
+    }
+
+    if (!pass.preserves)
+	analyses.clear();
+}
+
+
+/*
+ * Function:	scheduled
+ *
+ * Description:	Return whether the named pass, which the generator carries
+ *		out, is run on the named function.  The decision is made
+ *		the first time that it is asked for, when the pass is
+ *		numbered for bisection and its run is recorded like that of
+ *		any other pass, and is then remembered so that the parts of
+ *		the compiler that depend on it always agree.  Since the
+ *		work of the pass is spread through code generation, the
+ *		time recorded for it is only that of the decision.
+ */
+
+bool scheduled(const string &name, const string &unit)
+{
+    auto key = make_pair(name, unit);
+
+
+    if (decisions.count(key) == 0) {
+	decisions[key] = false;
+
+	run(lookup(name), unit, [&] {
+	    decisions[key] = true;
+	});
+    }
+
+    return decisions[key];
+}
+
+
+/*
+ * Function:	analyze
+ *
+ * Description:	Return the analysis of the given function, computing it if
+ *		there is no analysis left from an earlier pass.
+ */
+
+const Analysis &analyze(Function *function)
+{
+    Statement *body = function->body();
+
+
+    if (analyses.count(function) == 0) {
+	Analysis &result = analyses[function];
+	declarations(body, result.locals);
+	escaping(body, result.escaped);
+	privates(body, result.privates);
+    }
+
+    return analyses[function];
+}
+
+
+/*
+ * Function:	prepare
+ *
+ * Description:	Run the passes that look at all of the functions in the
+ *		given list together, before any of them is optimized.  The
+ *		counters are given out first, so that a clone of a function
+ *		shares its counters, and then checked against the profile.
+ *		Clones are added to the list.
+ */
+
+void prepare(vector<Function *> &functions)
+{
+    for (auto function : functions)
+	numberCounters(function);
+
+    matchProfile();
+
+    run(lookup("ipa-cp"), "module", [&] {
+	propagateConstants(functions);
+    });
+
+    run(lookup("ipa-pure-const"), "module", [&] {
+	summarizeFunctions(functions);
+    });
+}
+
+
+/*
+ * Function:	optimize
+ *
+ * Description:	Optimize the given function by running each enabled pass in
+ *		turn.  In an instrumented build, the passes that copy or
+ *		remove loops and calls are skipped so that the counts match
+ *		the source.
+ */
+
+void optimize(Function *function)
+{
+    for (auto &pass : passes)
+	if (pass.run != nullptr)
+	    run(pass, function->id()->name(), [&] {
+		pass.run(function);
+	    });
+
+    analyses.erase(function);
+}
+
+
+/*
+ * Function:	finish
+ *
+ * Description:	Run the passes that look at all of the functions in the
+ *		given list together, after all of them have been optimized.
+ */
+
+void finish(vector<Function *> &functions)
+{
+    run(lookup("remove-unused"), "module", [&] {
+	discardFunctions(functions);
+    });
+}
+
+
+/*
+ * Function:	writeTimings
+ *
+ * Description:	Write the time spent in each pass that was run to the given
+ *		stream, along with the number of times it was run, if the
+ *		passes were timed.
+ */
+
+void writeTimings(ostream &ostr)
+{
+    duration<double> total(0);
+
+
+    if (!timing)
+	return;
+
+    ostr << setw(12) << "seconds" << setw(8) << "runs" << "  pass" << endl;
+
+    for (auto &pass : passes)
+	if (timings.count(pass.name) > 0) {
+	    Timing &entry = timings[pass.name];
+	    ostr << fixed << setprecision(6) << setw(12) << entry.time.count();
+	    ostr << setw(8) << entry.runs << "  " << pass.name << endl;
+	    total += entry.time;
+	}
+
+    ostr << setw(12) << total.count() << setw(8) << "" << "  total" << endl;
+}
+
+
+/*
+ * Function:	count
+ *
+ * Description:	Add the given amount to the named statistic.
+ */
+
+void count(const string &name, unsigned amount)
+{
+    statistics[name] += amount;
+}
+
+
+/*
+ * Function:	writeStatistics
+ *
+ * Description:	Write the nonzero statistics gathered by the passes to the
+ *		given stream, one per line.
+ */
+
+void writeStatistics(ostream &ostr)
+{
+    for (auto &stat : statistics)
+	if (stat.second > 0)
+	    ostr << setw(8) << stat.second << " " << stat.first << endl;
+}
+
+
+/*
+ * Function:	declare
+ *
+ * Description:	Declare a new local variable of the given type in the given
+ *		function.  Its name is derived from the given name, but
+ *		cannot conflict with any other.
+ */
+
+Symbol *declare(Function *function, const string &name, const Type &type)
+{
+    static unsigned counter = 0;
+    Symbol *symbol;
+
+
+    symbol = new Symbol(name + "." + to_string(counter ++), type);
+    function->body()->declarations()->insert(symbol);
+    return symbol;
+}
+
+
+/*
+ * Function:	children
+ *
+ * Description:	Append the slots of the immediate operands of the given
+ *		expression to the list.
+ */
+
+void children(Expression *expr, vector<Expression **> &slots)
+{
+    Unary *unary;
+    Binary *binary;
+    Call *call;
+
+
+    if ((unary = dynamic_cast<Unary *>(expr)) != nullptr)
+	slots.push_back(&unary->expr());
+
+    else if ((binary = dynamic_cast<Binary *>(expr)) != nullptr) {
+	slots.push_back(&binary->left());
+	slots.push_back(&binary->right());
+
+    } else if ((call = dynamic_cast<Call *>(expr)) != nullptr)
+	for (auto &arg : call->args())
+	    slots.push_back(&arg);
+}
+
+
+/*
+ * Function:	expressions
+ *
+ * Description:	Append the slot of the given expression and the slots of
+ *		all of its subexpressions to the list, parents first.
+ */
+
+void expressions(Expression *&expr, vector<Expression **> &slots)
+{
+    vector<Expression **> operands;
+
+
+    slots.push_back(&expr);
+    children(expr, operands);
+
+    for (auto slot : operands)
+	expressions(*slot, slots);
+}
+
+
+/*
+ * Function:	expressions
+ *
+ * Description:	Append the slots of all expressions that belong directly
+ *		to the given statement (but not to any nested statements)
+ *		to the list.  If the statement is itself an expression,
+ *		only its subexpressions have slots.
+ */
+
+void expressions(Statement *stmt, vector<Expression **> &slots)
+{
+    vector<Expression **> operands;
+    Expression *expr;
+    Assignment *assign;
+    Return *ret;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr) {
+	children(expr, operands);
+
+	for (auto slot : operands)
+	    expressions(*slot, slots);
+
+    } else if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	expressions(assign->left(), slots);
+	expressions(assign->right(), slots);
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr)
+	expressions(ret->expr(), slots);
+
+    else if ((loop = dynamic_cast<While *>(stmt)) != nullptr)
+	expressions(loop->expr(), slots);
+
+    else if ((iter = dynamic_cast<For *>(stmt)) != nullptr)
+	expressions(iter->expr(), slots);
+
+    else if ((cond = dynamic_cast<If *>(stmt)) != nullptr)
+	expressions(cond->expr(), slots);
+
+    else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr)
+	expressions(branch->expr(), slots);
+}
+
+
+/*
+ * Function:	statements
+ *
+ * Description:	Append the slot of the given statement and the slots of
+ *		all statements nested within it to the list, parents first.
+ */
+
+void statements(Statement *&stmt, vector<Statement **> &slots)
+{
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+
+
+    slots.push_back(&stmt);
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto &child : block->statements())
+	    statements(child, slots);
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr)
+	statements(loop->stmt(), slots);
+
+    else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	statements(iter->init(), slots);
+	statements(iter->stmt(), slots);
+	statements(iter->incr(), slots);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	statements(cond->thenStmt(), slots);
+
+	if (cond->elseStmt() != nullptr)
+	    statements(cond->elseStmt(), slots);
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : branch->cases())
+	    statements(section.stmt, slots);
+    }
+}
+
+
+/*
+ * Function:	identifier
+ *
+ * Description:	Return the symbol if the given expression is an
+ *		identifier, and a null pointer otherwise.
+ */
+
+const Symbol *identifier(Expression *expr)
+{
+    Identifier *id = dynamic_cast<Identifier *>(expr);
+    return id != nullptr ? id->symbol() : nullptr;
+}
+
+
+/*
+ * Function:	strip
+ *
+ * Description:	Return the given expression, or the earlier expression if
+ *		it is a common subexpression.
+ */
+
+Expression *strip(Expression *expr)
+{
+    while (dynamic_cast<Common *>(expr) != nullptr)
+	expr = ((Common *) expr)->expr();
+
+    return expr;
+}
+
+
+/*
+ * Function:	literal
+ *
+ * Description:	Create an integer literal with the given value, which may
+ *		be negative.
+ */
+
+Expression *literal(int value)
+{
+    return new Integer(to_string(value));
+}
+
+
+/*
+ * Function:	isConstant
+ *
+ * Description:	Return whether the given expression is an integer
+ *		constant, possibly negated, and if so, its value.
+ */
+
+bool isConstant(Expression *expr, int &value)
+{
+    Integer *integer;
+    Negate *negate;
+
+
+    if ((integer = dynamic_cast<Integer *>(expr)) != nullptr) {
+	value = strtoul(integer->value().c_str(), NULL, 0);
+	return true;
+    }
+
+    if ((negate = dynamic_cast<Negate *>(expr)) != nullptr)
+	if (negate->type().isInteger() && isConstant(negate->expr(), value)) {
+	    value = -value;
+	    return true;
+	}
+
+    return false;
+}
+
+
+/*
+ * Function:	equal
+ *
+ * Description:	Return whether two expressions are structurally equal,
+ *		meaning that they have the same operators, types, and
+ *		operands.  A common subexpression is compared using the
+ *		expression to which it refers.  Whether they also compute
+ *		the same value is up to the caller to decide.
+ */
+
+bool equal(Expression *left, Expression *right)
+{
+    vector<Expression **> x, y;
+
+
+    left = strip(left);
+    right = strip(right);
+
+    if (typeid(*left) != typeid(*right) || left->type() != right->type())
+	return false;
+
+    if (dynamic_cast<Identifier *>(left) != nullptr)
+	return identifier(left) == identifier(right);
+
+    if (dynamic_cast<Integer *>(left) != nullptr)
+	return ((Integer *) left)->value() == ((Integer *) right)->value();
+
+    if (dynamic_cast<Real *>(left) != nullptr)
+	return ((Real *) left)->value() == ((Real *) right)->value();
+
+    if (dynamic_cast<String *>(left) != nullptr)
+	return ((String *) left)->value() == ((String *) right)->value();
+
+    if (dynamic_cast<Call *>(left) != nullptr)
+	if (((Call *) left)->id() != ((Call *) right)->id())
+	    return false;
+
+    if (dynamic_cast<Add *>(left) != nullptr)
+	if (((Add *) left)->scaleLeft != ((Add *) right)->scaleLeft ||
+		((Add *) left)->scaleRight != ((Add *) right)->scaleRight)
+	    return false;
+
+    if (dynamic_cast<Subtract *>(left) != nullptr)
+	if (((Subtract *) left)->scaleResult !=
+		((Subtract *) right)->scaleResult ||
+		((Subtract *) left)->scaleRight !=
+		((Subtract *) right)->scaleRight)
+	    return false;
+
+    if (dynamic_cast<Increment *>(left) != nullptr)
+	if (((Increment *) left)->scale != ((Increment *) right)->scale)
+	    return false;
+
+    if (dynamic_cast<Decrement *>(left) != nullptr)
+	if (((Decrement *) left)->scale != ((Decrement *) right)->scale)
+	    return false;
+
+    children(left, x);
+    children(right, y);
+
+    if (x.size() != y.size())
+	return false;
+
+    for (unsigned i = 0; i < x.size(); i ++)
+	if (!equal(*x[i], *y[i]))
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	completes
+ *
+ * Description:	Return whether execution can continue after the given
+ *		statement, rather than always leaving by a return or break.
+ */
+
+bool completes(Statement *stmt)
+{
+    Block *block;
+    If *cond;
+
+
+    if (dynamic_cast<Return *>(stmt) != nullptr)
+	return false;
+
+    if (dynamic_cast<Break *>(stmt) != nullptr)
+	return false;
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    if (!completes(child))
+		return false;
+
+	return true;
+    }
+
+    if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	if (cond->elseStmt() == nullptr)
+	    return true;
+
+	return completes(cond->thenStmt()) || completes(cond->elseStmt());
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	breaks
+ *
+ * Description:	Return whether the given statement contains a break
+ *		statement that would leave the enclosing loop.
+ */
+
+bool breaks(Statement *stmt)
+{
+    Block *block;
+    If *cond;
+
+
+    if (dynamic_cast<Break *>(stmt) != nullptr)
+	return true;
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    if (breaks(child))
+		return true;
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	if (breaks(cond->thenStmt()))
+	    return true;
+
+	return cond->elseStmt() != nullptr && breaks(cond->elseStmt());
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	rename
+ *
+ * Description:	Replace the variables within the given statement with
+ *		their new symbols.  Since their declarations move to the
+ *		function that receives the statement, each block is given an
+ *		empty scope.
+ */
+
+void rename(Statement *&stmt, const Renaming &symbols)
+{
+    vector<Expression **> exprs;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+
+
+    if (dynamic_cast<Identifier *>(stmt) != nullptr)
+	if (symbols.count(((Identifier *) stmt)->symbol()) > 0)
+	    stmt = new Identifier(symbols.at(((Identifier *) stmt)->symbol()));
+
+    expressions(stmt, exprs);
+
+    for (auto slot : exprs)
+	if (symbols.count(identifier(*slot)) > 0)
+	    *slot = new Identifier(symbols.at(identifier(*slot)));
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto &child : block->statements())
+	    rename(child, symbols);
+
+	stmt = new Block(new Scope(), block->statements());
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr)
+	rename(loop->stmt(), symbols);
+
+    else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	rename(iter->init(), symbols);
+	rename(iter->incr(), symbols);
+	rename(iter->stmt(), symbols);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	rename(cond->thenStmt(), symbols);
+
+	if (cond->elseStmt() != nullptr)
+	    rename(cond->elseStmt(), symbols);
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : branch->cases())
+	    rename(section.stmt, symbols);
+    }
+}
+
+
+/*
+ * Function:	substitute
+ *
+ * Description:	Replace each use of the given symbol within the given
+ *		statement with the given value.
+ */
+
+void substitute(Statement *stmt, const Symbol *symbol, int value)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+
+
+    statements(stmt, stmts);
+
+    for (auto slot : stmts)
+	expressions(*slot, exprs);
+
+    for (auto slot : exprs)
+	if (identifier(*slot) == symbol)
+	    *slot = literal(value);
+}
+
+
+/*
+ * Function:	declarations
+ *
+ * Description:	Add the symbols declared in all blocks within the given
+ *		statement to the set.  For the body of a function, this is
+ *		the set of its parameters and local variables.
+ */
+
+void declarations(Statement *stmt, SymbolSet &symbols)
+{
+    vector<Statement **> slots;
+    Block *block;
+
+
+    statements(stmt, slots);
+
+    for (auto slot : slots)
+	if ((block = dynamic_cast<Block *>(*slot)) != nullptr)
+	    for (auto symbol : block->declarations()->symbols())
+		symbols.insert(symbol);
+}
+
+
+/*
+ * Function:	escaping
+ *
+ * Description:	Add the symbols whose address is taken within the given
+ *		statement to the set.  Arrays are always included, since
+ *		they are promoted to their address when used.  The value
+ *		of an escaping symbol may be read or written through a
+ *		pointer, so the analyses below are only exact for symbols
+ *		that do not escape.
+ */
+
+void escaping(Statement *stmt, SymbolSet &symbols)
+{
+    vector<Statement **> slots;
+    vector<Expression **> exprs;
+    Address *addr;
+
+
+    statements(stmt, slots);
+
+    for (auto slot : slots)
+	expressions(*slot, exprs);
+
+    for (auto expr : exprs)
+	if ((addr = dynamic_cast<Address *>(*expr)) != nullptr)
+	    if (identifier(addr->expr()) != nullptr)
+		symbols.insert(identifier(addr->expr()));
+}
+
+
+/*
+ * Function:	privates
+ *
+ * Description:	Add the symbols declared within the given statement whose
+ *		address is never taken to the set.  These are the variables
+ *		whose values are known exactly by the analyses below.
+ */
+
+void privates(Statement *stmt, SymbolSet &symbols)
+{
+    SymbolSet escaped;
+
+
+    declarations(stmt, symbols);
+    escaping(stmt, escaped);
+
+    for (auto symbol : escaped)
+	symbols.erase(symbol);
+}
+
+
+/*
+ * Function:	uses (private)
+ *
+ * Description:	Add the symbols referenced by the given expression to the
+ *		set.
+ */
+
+static void uses(Expression *expr, SymbolSet &symbols)
+{
+    vector<Expression **> slots;
+
+
+    expressions(expr, slots);
+
+    for (auto slot : slots)
+	if (identifier(*slot) != nullptr)
+	    symbols.insert(identifier(*slot));
+}
+
+
+/*
+ * Function:	live (private)
+ *
+ * Description:	Compute the set of symbols live before the given statement
+ *		given the set live after it and the set live after the
+ *		innermost enclosing loop or switch statement (the target
+ *		of any break).  The set live after each statement is
+ *		recorded as we go.  Loops are iterated until their sets no
+ *		longer change.  Each section of a switch statement falls
+ *		through to the next, and any of them may be entered.
+ */
+
+static SymbolSet live(Statement *stmt, const SymbolSet &out,
+	const SymbolSet &exit, Liveness &sets)
+{
+    SymbolSet in, prev, head;
+    Expression *expr;
+    Assignment *assign;
+    Return *ret;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+    bool fallback;
+
+
+    sets[stmt] = out;
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr) {
+	in = out;
+	uses(expr, in);
+
+    } else if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	in = out;
+
+	if (identifier(assign->left()) != nullptr)
+	    in.erase(identifier(assign->left()));
+	else
+	    uses(assign->left(), in);
+
+	uses(assign->right(), in);
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr)
+	uses(ret->expr(), in);
+
+    else if (dynamic_cast<Break *>(stmt) != nullptr)
+	in = exit;
+
+    else if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	in = out;
+
+	for (unsigned i = block->statements().size(); i > 0; i --)
+	    in = live(block->statements()[i - 1], in, exit, sets);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	in = live(cond->thenStmt(), out, exit, sets);
+
+	if (cond->elseStmt() != nullptr)
+	    prev = live(cond->elseStmt(), out, exit, sets);
+	else
+	    prev = out;
+
+	in.insert(prev.begin(), prev.end());
+	uses(cond->expr(), in);
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr) {
+	head = out;
+	uses(loop->expr(), head);
+
+	do {
+	    prev = head;
+	    in = live(loop->stmt(), head, out, sets);
+	    head.insert(in.begin(), in.end());
+	} while (head != prev);
+
+	in = head;
+
+    } else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	head = out;
+	uses(iter->expr(), head);
+
+	do {
+	    prev = head;
+	    in = live(iter->incr(), head, out, sets);
+	    in = live(iter->stmt(), in, out, sets);
+	    head.insert(in.begin(), in.end());
+	} while (head != prev);
+
+	in = live(iter->init(), head, exit, sets);
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	Cases &cases = branch->cases();
+
+	fallback = false;
+	prev = out;
+
+	for (unsigned i = cases.size(); i > 0; i --) {
+	    prev = live(cases[i - 1].stmt, prev, out, sets);
+	    in.insert(prev.begin(), prev.end());
+	    fallback = fallback || cases[i - 1].isDefault;
+	}
+
+	if (!fallback)
+	    in.insert(out.begin(), out.end());
+
+	uses(branch->expr(), in);
+
+    } else
+	in = out;
+
+    return in;
+}
+
+
+/*
+ * Function:	liveness
+ *
+ * Description:	Compute the set of symbols live before the given statement
+ *		given the set live after it, recording the set live after
+ *		each statement within it.  Only symbols that do not escape
+ *		are tracked exactly; see escaping() above.
+ */
+
+SymbolSet liveness(Statement *stmt, const SymbolSet &out, Liveness &sets)
+{
+    return live(stmt, out, out, sets);
+}
+
+
+/*
+ * Function:	summarize
+ *
+ * Description:	Summarize the given loop, which is a while or for
+ *		statement.
+ */
+
+bool summarize(Statement *stmt, Loop &loop)
+{
+    While *whileStmt;
+    For *forStmt;
+    Expression *expr;
+    Assignment *assign;
+    const Symbol *symbol;
+
+
+    if ((whileStmt = dynamic_cast<While *>(stmt)) != nullptr) {
+	loop.test = &whileStmt->expr();
+	statements(whileStmt->stmt(), loop.stmts);
+
+    } else if ((forStmt = dynamic_cast<For *>(stmt)) != nullptr) {
+	loop.test = &forStmt->expr();
+	statements(forStmt->stmt(), loop.stmts);
+	statements(forStmt->incr(), loop.stmts);
+
+    } else
+	return false;
+
+    expressions(*loop.test, loop.exprs);
+
+    for (auto slot : loop.stmts)
+	expressions(*slot, loop.exprs);
+
+    loop.stores = loop.calls = false;
+
+    for (auto slot : loop.stmts) {
+	if ((expr = dynamic_cast<Expression *>(*slot)) != nullptr) {
+	    if (dynamic_cast<Call *>(expr) != nullptr)
+		loop.calls = true;
+
+	    else if (dynamic_cast<Increment *>(expr) != nullptr ||
+		    dynamic_cast<Decrement *>(expr) != nullptr) {
+		symbol = identifier(((Unary *) expr)->expr());
+		loop.targets.push_back(((Unary *) expr)->expr());
+
+		if (symbol != nullptr)
+		    loop.defs.insert(symbol);
+		else
+		    loop.stores = true;
+	    }
+
+	} else if ((assign = dynamic_cast<Assignment *>(*slot)) != nullptr) {
+	    loop.targets.push_back(assign->left());
+
+	    if ((symbol = identifier(assign->left())) != nullptr)
+		loop.defs.insert(symbol);
+	    else
+		loop.stores = true;
+	}
+    }
+
+    for (auto slot : loop.exprs) {
+	if (dynamic_cast<Call *>(*slot) != nullptr)
+	    loop.calls = true;
+
+	else if (dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr) {
+	    symbol = identifier(((Unary *) *slot)->expr());
+	    loop.targets.push_back(((Unary *) *slot)->expr());
+
+	    if (symbol != nullptr)
+		loop.defs.insert(symbol);
+	    else
+		loop.stores = true;
+	}
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	invariant
+ *
+ * Description:	Return whether the given expression has the same value on
+ *		every iteration of the loop.  We only consider integer and
+ *		pointer arithmetic on variables and addresses.  A local
+ *		variable that does not escape is invariant if the loop does
+ *		not define it, and any other variable is invariant only if
+ *		the loop also makes no calls and no stores that may change
+ *		it.  The set of local variables that do not escape is given.
+ */
+
+bool invariant(Expression *expr, const Loop &loop, const SymbolSet &privates)
+{
+    const Symbol *symbol;
+    Unary *unary;
+    Binary *binary;
+    int value;
+
+
+    if (isConstant(expr, value))
+	return true;
+
+    if ((symbol = identifier(expr)) != nullptr) {
+	if (loop.defs.count(symbol) > 0)
+	    return false;
+
+	if (privates.count(symbol) > 0)
+	    return true;
+
+	if (loop.calls)
+	    return false;
+
+	for (auto target : loop.targets)
+	    if (aliases(target, expr, privates))
+		return false;
+
+	return true;
+    }
+
+    if (dynamic_cast<Address *>(expr) != nullptr) {
+	unary = (Unary *) expr;
+
+	if (identifier(unary->expr()) != nullptr)
+	    return true;
+
+	if (dynamic_cast<Dereference *>(unary->expr()) != nullptr)
+	    return invariant(((Unary *) unary->expr())->expr(), loop,
+		    privates);
+
+	return false;
+    }
+
+    if (dynamic_cast<Add *>(expr) != nullptr ||
+	    dynamic_cast<Subtract *>(expr) != nullptr ||
+	    dynamic_cast<Multiply *>(expr) != nullptr) {
+	binary = (Binary *) expr;
+
+	if (binary->type().isReal())
+	    return false;
+
+	return invariant(binary->left(), loop, privates) &&
+	    invariant(binary->right(), loop, privates);
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	update
+ *
+ * Description:	Return whether the given statement adds a constant to the
+ *		given symbol, and if so, the constant.  The forms are
+ *		"i ++", "i --", "i = i + c", "i = c + i", and "i = i - c".
+ */
+
+bool update(Statement *stmt, const Symbol *symbol, int &step)
+{
+    Assignment *assign;
+    Binary *binary;
+
+
+    if (dynamic_cast<Increment *>(stmt) != nullptr) {
+	step = ((Increment *) stmt)->scale;
+	return identifier(((Unary *) stmt)->expr()) == symbol;
+    }
+
+    if (dynamic_cast<Decrement *>(stmt) != nullptr) {
+	step = -((Decrement *) stmt)->scale;
+	return identifier(((Unary *) stmt)->expr()) == symbol;
+    }
+
+    if ((assign = dynamic_cast<Assignment *>(stmt)) == nullptr)
+	return false;
+
+    if (identifier(assign->left()) != symbol)
+	return false;
+
+    if (dynamic_cast<Add *>(assign->right()) != nullptr) {
+	binary = (Binary *) assign->right();
+
+	if (identifier(binary->left()) == symbol)
+	    return isConstant(binary->right(), step);
+
+	if (identifier(binary->right()) == symbol)
+	    return isConstant(binary->left(), step);
+
+    } else if (dynamic_cast<Subtract *>(assign->right()) != nullptr) {
+	binary = (Binary *) assign->right();
+
+	if (identifier(binary->left()) == symbol &&
+		isConstant(binary->right(), step)) {
+	    step = -step;
+	    return true;
+	}
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	definitions
+ *
+ * Description:	Return the number of definitions of the given symbol
+ *		within the loop.
+ */
+
+unsigned definitions(const Loop &loop, const Symbol *symbol)
+{
+    unsigned count = 0;
+    Assignment *assign;
+
+
+    for (auto slot : loop.stmts)
+	if (dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr) {
+	    if (identifier(((Unary *) *slot)->expr()) == symbol)
+		count ++;
+
+	} else if ((assign = dynamic_cast<Assignment *>(*slot)) != nullptr)
+	    if (identifier(assign->left()) == symbol)
+		count ++;
+
+    for (auto slot : loop.exprs)
+	if (dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr)
+	    if (identifier(((Unary *) *slot)->expr()) == symbol)
+		count ++;
+
+    return count;
+}
@@ -0,0 +1,150 @@
+/*
+ * File:	optimizer.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		optimizer for Simple C.  The optimizer works on the
+ *		abstract syntax tree of a function after semantic checking
+ *		but before storage allocation, so any symbols that it
+ *		introduces are simply allocated along with the others.
+ *
+ *		Besides the passes themselves, a handful of utility
+ *		functions for walking and analyzing the tree are declared
+ *		here, since every pass needs them.
+ */
+
+# ifndef OPTIMIZER_H
+# define OPTIMIZER_H
+# include <map>
+# include <set>
+# include <string>
+# include <vector>
+# include <ostream>
+# include "Tree.h"
+
+typedef std::set<const Symbol *> SymbolSet;
+typedef std::map<const Statement *, SymbolSet> Liveness;
+typedef std::map<const Symbol *, Symbol *> Renaming;
+
+
+/*
+ * A summary of the statements executed on each iteration of a loop: the
+ * test expression, the statements of the body and increment, the symbols
+ * defined, the references stored to, and whether there are any stores
+ * through pointers or calls.
+ */
+
+struct Loop {
+    Expression **test;
+    std::vector<Statement **> stmts;
+    std::vector<Expression **> exprs;
+    SymbolSet defs;
+    Expressions targets;
+    bool stores, calls;
+};
+
+
+/*
+ * A plan for executing several iterations of a loop at once using SSE2:
+ * the loop variable and its bound, the type of the elements, the
+ * assignments of the body, the invariant expressions computed before the
+ * loop, and the pairs of pointers that must be checked for overlap.
+ */
+
+struct Simd {
+    const Symbol *counter;
+    Expression *bound;
+    bool inclusive;
+    Type type;
+    std::vector<Assignment *> assigns;
+    Expressions invariants;
+    std::vector<std::pair<Expression *, Expression *>> overlaps;
+};
+
+
+/*
+ * The analysis of a function shared by the passes: the symbols declared
+ * within it, those whose address is taken, and those whose address is
+ * never taken.  It is kept until a pass that does not preserve it is run.
+ */
+
+struct Analysis {
+    SymbolSet locals, escaped, privates;
+};
+
+
+bool configure(const std::string &option);
+bool enabled(const std::string &name);
+bool scheduled(const std::string &name, const std::string &unit);
+const Analysis &analyze(Function *function);
+
+void prepare(std::vector<Function *> &functions);
+void optimize(Function *function);
+void finish(std::vector<Function *> &functions);
+void writeTimings(std::ostream &ostr);
+void count(const std::string &name, unsigned amount = 1);
+void writeStatistics(std::ostream &ostr);
+
+Symbol *declare(Function *function, const std::string &name,
+	const Type &type);
+
+void children(Expression *expr, std::vector<Expression **> &slots);
+void expressions(Expression *&expr, std::vector<Expression **> &slots);
+void expressions(Statement *stmt, std::vector<Expression **> &slots);
+void statements(Statement *&stmt, std::vector<Statement **> &slots);
+
+const Symbol *identifier(Expression *expr);
+Expression *strip(Expression *expr);
+Expression *literal(int value);
+bool isConstant(Expression *expr, int &value);
+bool equal(Expression *left, Expression *right);
+bool completes(Statement *stmt);
+bool breaks(Statement *stmt);
+void rename(Statement *&stmt, const Renaming &symbols);
+void substitute(Statement *stmt, const Symbol *symbol, int value);
+
+void declarations(Statement *stmt, SymbolSet &symbols);
+void escaping(Statement *stmt, SymbolSet &symbols);
+void privates(Statement *stmt, SymbolSet &symbols);
+SymbolSet liveness(Statement *stmt, const SymbolSet &out, Liveness &live);
+
+bool aliases(Expression *left, Expression *right, const SymbolSet &privates);
+bool clobbers(Expression *target, Expression *expr, const SymbolSet &privates);
+
+bool summarize(Statement *stmt, Loop &loop);
+bool invariant(Expression *expr, const Loop &loop, const SymbolSet &privates);
+bool update(Statement *stmt, const Symbol *symbol, int &step);
+unsigned definitions(const Loop &loop, const Symbol *symbol);
+bool vectorizable(Statement *stmt, const SymbolSet &privates, Simd &plan);
+
+extern unsigned inlineThreshold;
+extern unsigned unrollFactor;
+extern std::string profileOutput;
+
+void readProfile(const std::string &path);
+void matchProfile();
+bool profiled(const Statement *stmt, unsigned which, unsigned &count);
+bool hot(unsigned count);
+double predict(If *stmt);
+unsigned counters();
+
+void numberCounters(Function *function);
+void propagateConstants(std::vector<Function *> &functions);
+void summarizeFunctions(const std::vector<Function *> &functions);
+void discardFunctions(std::vector<Function *> &functions);
+bool isPure(const Symbol *function);
+bool isReadOnly(const Symbol *function);
+
+void foldConstants(Function *function);
+void inlineCalls(Function *function);
+void unrollLoops(Function *function);
+void evaluateConstants(Function *function);
+bool evaluateConstant(Expression *expr, int &value);
+void reduceStrength(Function *function);
+void eliminateDeadCode(Function *function);
+void placeExpressions(Function *function);
+void markTailCalls(Function *function);
+void numberValues(Function *function);
+void vectorizeLoops(Function *function);
+void promoteVariables(Function *function);
+
+# endif /* OPTIMIZER_H */
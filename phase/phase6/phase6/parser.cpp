@@ -8,7 +8,11 @@
 
 # include <cstdlib>
 # include <iostream>
+# include <sstream>
+# include "assembler.h"
 # include "generator.h"
+# include "interpreter.h"
+# include "optimizer.h"
 # include "checker.h"
 # include "string.h"
 # include "tokens.h"
@@ -24,6 +28,8 @@ static string lexbuf, nextbuf;
 
 static Type returnType;
 static unsigned loopDepth;
+static unsigned switchDepth;
+static vector<Function *> functions;
 
 
 /*
@@ -181,6 +187,42 @@ static int specifier()
 }
 
 
+/*
+ * Function:	qualifier
+ *
+ * Description:	Parse an optional type qualifier and return whether it was
+ *		present.  Simple C has only the const qualifier, which
+ *		applies to the specifier, so it either declares a const
+ *		object or a pointer to const.
+ *
+ *		qualifier:
+ *		  empty
+ *		  const
+ */
+
+static bool qualifier()
+{
+    if (lookahead != CONST)
+	return false;
+
+    match(CONST);
+    return true;
+}
+
+
+/*
+ * Function:	qualify
+ *
+ * Description:	Return the type being declared, which is qualified if the
+ *		qualifier was given.
+ */
+
+static Type qualify(const Type &type, bool constant)
+{
+    return constant ? type.qualify() : type;
+}
+
+
 /*
  * Function:	pointers
  *
@@ -210,16 +252,21 @@ static unsigned pointers()
  *
  * Description:	Parse a declarator, which in Simple C is either a scalar
  *		variable or an array, with optional pointer declarators.
+ *		The assignment that initializes the variable, if any, is
+ *		added to the list.
  *
  *		declarator:
  *		  pointers identifier
+ *		  pointers identifier = expression
  *		  pointers identifier [ integer ]
  */
 
-static void declarator(int typespec)
+static void declarator(int typespec, bool constant, Statements &inits)
 {
     unsigned indirection;
     string name;
+    Symbol *symbol;
+    Type type;
 
 
     indirection = pointers();
@@ -227,10 +274,17 @@ static void declarator(int typespec)
 
     if (lookahead == '[') {
 	match('[');
-	declareVariable(name, Type(typespec, indirection, integer()));
+	type = Type(typespec, indirection, integer());
 	match(']');
     } else
-	declareVariable(name, Type(typespec, indirection));
+	type = Type(typespec, indirection);
+
+    symbol = declareVariable(name, qualify(type, constant));
+
+    if (lookahead == '=') {
+	match('=');
+	inits.push_back(checkInitializer(symbol, expression()));
+    }
 }
 
 
@@ -242,24 +296,26 @@ static void declarator(int typespec)
  *		as a special case.
  *
  *		declaration:
- *		  specifier declarator-list ;
+ *		  qualifier specifier declarator-list ;
  *
  *		declarator-list:
  *		  declarator
  *		  declarator , declarator-list
  */
 
-static void declaration()
+static void declaration(Statements &inits)
 {
     int typespec;
+    bool constant;
 
 
+    constant = qualifier();
     typespec = specifier();
-    declarator(typespec);
+    declarator(typespec, constant, inits);
 
     while (lookahead == ',') {
 	match(',');
-	declarator(typespec);
+	declarator(typespec, constant, inits);
     }
 
     match(';');
@@ -269,17 +325,23 @@ static void declaration()
 /*
  * Function:	declarations
  *
- * Description:	Parse a possibly empty sequence of declarations.
+ * Description:	Parse a possibly empty sequence of declarations, and
+ *		return the assignments that initialize the variables.
  *
  *		declarations:
  *		  empty
  *		  declaration declarations
  */
 
-static void declarations()
+static Statements declarations()
 {
-    while (isSpecifier(lookahead))
-	declaration();
+    Statements inits;
+
+
+    while (isSpecifier(lookahead) || lookahead == CONST)
+	declaration(inits);
+
+    return inits;
 }
 
 
@@ -737,6 +799,70 @@ static Statements statements()
 }
 
 
+/*
+ * Function:	cases
+ *
+ * Description:	Parse the sections of a switch statement.  Each section
+ *		is a nonempty sequence of labels followed by a possibly
+ *		empty sequence of statements, which ends at the next label
+ *		or at the closing brace of the switch statement.
+ *
+ *		cases:
+ *		  empty
+ *		  labels statements cases
+ *
+ *		labels:
+ *		  label
+ *		  label labels
+ *
+ *		label:
+ *		  case expression :
+ *		  default :
+ */
+
+static Cases cases()
+{
+    Cases sections;
+    Case section;
+    Expression *expr;
+    Statements stmts;
+    int value;
+
+
+    while (lookahead != '}') {
+	section.values.clear();
+	section.isDefault = false;
+
+	do {
+	    if (lookahead == DEFAULT) {
+		match(DEFAULT);
+		checkDefault(sections, section);
+		section.isDefault = true;
+
+	    } else {
+		match(CASE);
+		expr = expression();
+
+		if (checkCase(expr, sections, section, value))
+		    section.values.push_back(value);
+	    }
+
+	    match(':');
+	} while (lookahead == CASE || lookahead == DEFAULT);
+
+	stmts.clear();
+
+	while (lookahead != CASE && lookahead != DEFAULT && lookahead != '}')
+	    stmts.push_back(statement());
+
+	section.stmt = new Block(new Scope(), stmts);
+	sections.push_back(section);
+    }
+
+    return sections;
+}
+
+
 /*
  * Function:	Assignment
  *
@@ -776,6 +902,7 @@ static Statement *assignment()
  *		  for ( assignment ; expression ; assignment ) statement
  *		  if ( expression ) statement
  *		  if ( expression ) statement else statement
+ *		  switch ( expression ) { declarations cases }
  *		  assignment ;
  *
  *		This grammar still suffers from the "dangling-else"
@@ -789,14 +916,16 @@ static Statement *statement()
     Scope *decls;
     Expression *expr;
     Statement *stmt, *init, *incr;
-    Statements stmts;
+    Statements stmts, rest;
+    Cases sections;
 
 
     if (lookahead == '{') {
 	match('{');
 	openScope();
-	declarations();
-	stmts = statements();
+	stmts = declarations();
+	rest = statements();
+	stmts.insert(stmts.end(), rest.begin(), rest.end());
 	decls = closeScope();
 	match('}');
 	return new Block(decls, stmts);
@@ -804,7 +933,7 @@ static Statement *statement()
     
     if (lookahead == BREAK) {
 	match(BREAK);
-	checkBreak(loopDepth);
+	checkBreak(loopDepth + switchDepth);
 	match(';');
 	return new Break();
     }
@@ -861,6 +990,24 @@ static Statement *statement()
 	match(ELSE);
 	return new If(expr, stmt, statement());
     }
+
+    if (lookahead == SWITCH) {
+	match(SWITCH);
+	match('(');
+	expr = expression();
+	checkSwitch(expr);
+	match(')');
+	match('{');
+	openScope();
+	declarations();
+	switchDepth ++;
+	sections = cases();
+	switchDepth --;
+	decls = closeScope();
+	match('}');
+	stmts.push_back(new Switch(expr, sections));
+	return new Block(decls, stmts);
+    }
     
     stmt = assignment();
     match(';');
@@ -875,7 +1022,7 @@ static Statement *statement()
  *		variable with optional pointer declarators.
  *
  *		parameter:
- *		  specifier pointers identifier
+ *		  qualifier specifier pointers identifier
  */
 
 static Type parameter()
@@ -884,13 +1031,15 @@ static Type parameter()
     unsigned indirection;
     string name;
     Type type;
+    bool constant;
 
 
+    constant = qualifier();
     typespec = specifier();
     indirection = pointers();
     name = identifier();
 
-    type = Type(typespec, indirection);
+    type = qualify(Type(typespec, indirection), constant);
     declareVariable(name, type);
     return type;
 }
@@ -940,23 +1089,128 @@ static Parameters *parameters()
 }
 
 
+/*
+ * Function:	constant
+ *
+ * Description:	Parse a literal within the initializer of a global
+ *		variable.
+ *
+ *		constant:
+ *		  integer
+ *		  - integer
+ *		  real
+ *		  - real
+ *		  character
+ *		  string
+ */
+
+static Expression *constant()
+{
+    Expression *expr;
+    string sign;
+
+
+    if (lookahead == '-') {
+	match('-');
+	sign = "-";
+    }
+
+    if (lookahead == INTEGER) {
+	expr = new Integer(sign + lexbuf);
+	match(INTEGER);
+
+    } else if (lookahead == REAL) {
+	expr = new Real(sign + lexbuf);
+	match(REAL);
+
+    } else if (lookahead == CHARACTER && sign.empty()) {
+	lexbuf = lexbuf.substr(1, lexbuf.size() - 2);
+	expr = new Integer(parseString(lexbuf)[0]);
+	match(CHARACTER);
+
+    } else if (lookahead == STRING && sign.empty()) {
+	lexbuf = lexbuf.substr(1, lexbuf.size() - 2);
+	expr = new String(parseString(lexbuf));
+	match(STRING);
+
+    } else {
+	error();
+	expr = nullptr;
+    }
+
+    return expr;
+}
+
+
+/*
+ * Function:	initializer
+ *
+ * Description:	Parse the optional initializer of a global variable.
+ *
+ *		initializer:
+ *		  empty
+ *		  = constant
+ *		  = { constant-list }
+ *
+ *		constant-list:
+ *		  constant
+ *		  constant ,
+ *		  constant , constant-list
+ */
+
+static void initializer(Symbol *symbol)
+{
+    Expressions values;
+
+
+    if (lookahead != '=')
+	return;
+
+    match('=');
+
+    if (lookahead == '{') {
+	match('{');
+	values.push_back(constant());
+
+	while (lookahead == ',') {
+	    match(',');
+
+	    if (lookahead == '}')
+		break;
+
+	    values.push_back(constant());
+	}
+
+	match('}');
+
+    } else
+	values.push_back(constant());
+
+    checkInitializer(symbol, values);
+}
+
+
 /*
  * Function:	globalDeclarator
  *
  * Description:	Parse a declarator, which in Simple C is either a scalar
  *		variable, an array, or a function, with optional pointer
- *		declarators.
+ *		declarators.  The flags indicate whether the declaration
+ *		was static and const.
  *
  *		global-declarator:
- *		  pointers identifier
- *		  pointers identifier [ integer ]
+ *		  pointers identifier initializer
+ *		  pointers identifier [ integer ] initializer
  *		  pointers identifier ( parameters )
  */
 
-static void globalDeclarator(int typespec)
+static void globalDeclarator(int typespec, bool internal, bool constant)
 {
     unsigned indirection;
+    Parameters *params;
     string name;
+    Symbol *symbol;
+    Type type;
 
 
     indirection = pointers();
@@ -964,17 +1218,26 @@ static void globalDeclarator(int typespec)
 
     if (lookahead == '[') {
 	match('[');
-	declareVariable(name, Type(typespec, indirection, integer()));
+	type = Type(typespec, indirection, integer());
+	symbol = declareVariable(name, qualify(type, constant));
 	match(']');
+	initializer(symbol);
 
     } else if (lookahead == '(') {
 	match('(');
-	declareFunction(name, Type(typespec, indirection, parameters()));
+	params = parameters();
+	type = Type(typespec, indirection, params);
+	symbol = declareFunction(name, qualify(type, constant));
 	closeParamScope();
 	match(')');
 
-    } else
-	declareVariable(name, Type(typespec, indirection));
+    } else {
+	type = Type(typespec, indirection);
+	symbol = declareVariable(name, qualify(type, constant));
+	initializer(symbol);
+    }
+
+    symbol->internal |= internal;
 }
 
 
@@ -982,17 +1245,19 @@ static void globalDeclarator(int typespec)
  * Function:	remainingDeclarators
  *
  * Description:	Parse any remaining global declarators after the first.
+ *		The flags indicate whether the declaration was static and
+ *		const.
  *
  * 		remaining-declarators
  * 		  ;
  * 		  , global-declarator remaining-declarators
  */
 
-static void remainingDeclarators(int typespec)
+static void remainingDeclarators(int typespec, bool internal, bool constant)
 {
     while (lookahead == ',') {
 	match(',');
-	globalDeclarator(typespec);
+	globalDeclarator(typespec, internal, constant);
     }
 
     match(';');
@@ -1002,13 +1267,23 @@ static void remainingDeclarators(int typespec)
 /*
  * Function:	topLevelDeclaration
  *
- * Description:	Parse a global declaration or function definition.
+ * Description:	Parse a global declaration or function definition, either
+ *		of which may be static.  A const qualifier on a function is
+ *		ignored.
  *
  * 		global-or-function:
- * 		  specifier pointers identifier remaining-decls
- * 		  specifier pointers identifier [ integer ] remaining-decls
- * 		  specifier pointers identifier ( parameters ) remaining-decls 
- * 		  specifier pointers identifier ( parameters ) { ... }
+ * 		  storage qualifier specifier pointers identifier initializer
+ * 		    remaining-decls
+ * 		  storage qualifier specifier pointers identifier [ integer ]
+ * 		    initializer remaining-decls
+ * 		  storage qualifier specifier pointers identifier ( parameters )
+ * 		    remaining-decls 
+ * 		  storage qualifier specifier pointers identifier ( parameters )
+ * 		    { ... }
+ *
+ *		storage:
+ *		  empty
+ *		  static
  */
 
 static void topLevelDeclaration()
@@ -1017,21 +1292,32 @@ static void topLevelDeclaration()
     unsigned indirection;
     Parameters *params;
     string name;
-    Statements stmts;
+    Statements stmts, rest;
     Function *function;
     Symbol *symbol;
     Scope *decls;
+    bool internal, constant;
+    Type type;
+
 
+    internal = lookahead == STATIC;
 
+    if (internal)
+	match(STATIC);
+
+    constant = qualifier();
     typespec = specifier();
     indirection = pointers();
     name = identifier();
 
     if (lookahead == '[') {
 	match('[');
-	declareVariable(name, Type(typespec, indirection, integer()));
+	type = Type(typespec, indirection, integer());
+	symbol = declareVariable(name, qualify(type, constant));
+	symbol->internal |= internal;
 	match(']');
-	remainingDeclarators(typespec);
+	initializer(symbol);
+	remainingDeclarators(typespec, internal, constant);
 
     } else if (lookahead == '(') {
 	match('(');
@@ -1039,27 +1325,33 @@ static void topLevelDeclaration()
 	match(')');
 
 	if (lookahead == '{') {
-	    returnType = Type(typespec, indirection);
-	    symbol = defineFunction(name, Type(typespec, indirection, params));
+	    returnType = qualify(Type(typespec, indirection), constant);
+	    type = Type(typespec, indirection, params);
+	    symbol = defineFunction(name, qualify(type, constant));
+	    symbol->internal |= internal;
 	    match('{');
-	    declarations();
-	    stmts = statements();
+	    stmts = declarations();
+	    rest = statements();
+	    stmts.insert(stmts.end(), rest.begin(), rest.end());
 	    decls = closeScope();
 	    function = new Function(symbol, new Block(decls, stmts));
 	    match('}');
-
-	    if (numerrors == 0)
-		function->generate();
+	    functions.push_back(function);
 
 	} else {
 	    closeParamScope();
-	    declareFunction(name, Type(typespec, indirection, params));
-	    remainingDeclarators(typespec);
+	    type = Type(typespec, indirection, params);
+	    symbol = declareFunction(name, qualify(type, constant));
+	    symbol->internal |= internal;
+	    remainingDeclarators(typespec, internal, constant);
 	}
 
     } else {
-	declareVariable(name, Type(typespec, indirection));
-	remainingDeclarators(typespec);
+	type = Type(typespec, indirection);
+	symbol = declareVariable(name, qualify(type, constant));
+	symbol->internal |= internal;
+	initializer(symbol);
+	remainingDeclarators(typespec, internal, constant);
     }
 }
 
@@ -1067,17 +1359,133 @@ static void topLevelDeclaration()
 /*
  * Function:	main
  *
- * Description:	Analyze the standard input stream.
+ * Description:	Analyze the standard input stream.  The functions are only
+ *		optimized once all of them have been seen, so that the
+ *		optimizer can look at them together, and then only those
+ *		that are still needed are generated.  If the -stats option
+ *		is given, the statistics gathered by the optimizer are
+ *		written to the standard error when we are done, and the
+ *		-time-passes option does the same for the time spent in
+ *		each pass.  The -O0, -O1, and -O2 options set the
+ *		optimization level, and -fno-name turns off the named
+ *		pass, so that -fno-omit-frame-pointer keeps %ebp as a frame
+ *		pointer.  The -inline-threshold option sets the size of the
+ *		largest function that is inlined outside of any loop, and
+ *		the -unroll option sets the factor by which loops are
+ *		unrolled.  The -fprofile-generate option instruments the
+ *		program to write a profile to the given file when it exits,
+ *		and the -fprofile-use option optimizes using such a profile.
+ *		The -opt-bisect-limit option runs only the given number of
+ *		passes.  The -c option writes a relocatable object to the
+ *		standard output rather than assembly code.  Finally, the
+ *		--run option compiles the given file rather than the
+ *		standard input and runs it in memory, passing it any
+ *		remaining arguments, and the --interpret option does the
+ *		same but interprets the program as bytecode instead of
+ *		generating any code for it.  Since only the i386 can run
+ *		the code we generate, --run is rejected if we are built for
+ *		any other host.
  */
 
-int main()
+int main(int argc, char *argv[])
 {
+    string arg, threshold = "-inline-threshold=", factor = "-unroll=";
+    string generate = "-fprofile-generate=", use = "-fprofile-use=";
+    bool stats = false, object = false, interpreting = false;
+    int running = 0;
+    ostringstream text;
+    streambuf *saved;
+    Scope *globals;
+    Object result;
+
+
+    for (int i = 1; i < argc; i ++) {
+	arg = argv[i];
+
+	if (arg == "-stats")
+	    stats = true;
+	else if (arg == "-c")
+	    object = true;
+	else if (arg == "--run" && i + 1 < argc) {
+# if !defined(__i386__)
+	    cerr << "--run is not supported on this host, use --interpret";
+	    cerr << endl;
+	    exit(EXIT_FAILURE);
+# endif
+	    running = i + 1;
+	    break;
+	}
+	else if (arg == "--interpret" && i + 1 < argc) {
+	    running = i + 1;
+	    interpreting = true;
+	    break;
+	}
+	else if (arg.compare(0, threshold.size(), threshold) == 0)
+	    inlineThreshold = strtoul(arg.c_str() + threshold.size(), NULL, 0);
+	else if (arg.compare(0, factor.size(), factor) == 0)
+	    unrollFactor = strtoul(arg.c_str() + factor.size(), NULL, 0);
+	else if (arg.compare(0, generate.size(), generate) == 0)
+	    profileOutput = arg.substr(generate.size());
+	else if (arg.compare(0, use.size(), use) == 0)
+	    readProfile(arg.substr(use.size()));
+	else if (!configure(arg)) {
+	    cerr << "usage: " << argv[0] << " [-c] [-stats] [-time-passes]";
+	    cerr << " [-O0|-O1|-O2] [-fno-pass] [-opt-bisect-limit=n]";
+	    cerr << " [-inline-threshold=n] [-unroll=n]";
+	    cerr << " [-fprofile-generate=file] [-fprofile-use=file]";
+	    cerr << " [--run|--interpret file [args]]" << endl;
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    if (running > 0 && (yyin = fopen(argv[running], "r")) == nullptr) {
+	cerr << "cannot open " << argv[running] << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    saved = object || running > 0 ? cout.rdbuf(text.rdbuf()) : cout.rdbuf();
     openScope();
     lookahead = yylex();
 
     while (lookahead != DONE)
 	topLevelDeclaration();
 
-    generateGlobals(closeScope());
+    if (numerrors == 0) {
+	prepare(functions);
+
+	for (auto function : functions)
+	    optimize(function);
+
+	finish(functions);
+
+	if (!interpreting)
+	    for (auto function : functions)
+		function->generate();
+    }
+
+    globals = closeScope();
+
+    if (!interpreting)
+	generateGlobals(globals);
+
+    cout.rdbuf(saved);
+
+    if ((object || running > 0) && !interpreting && numerrors == 0)
+	assemble(text.str(), result);
+
+    if (object && numerrors == 0)
+	writeObject(result, cout);
+
+    if (stats)
+	writeStatistics(cerr);
+
+    writeTimings(cerr);
+
+    if (interpreting && numerrors == 0)
+	exit(interpret(functions, globals, argc - running, argv + running));
+
+    if (running > 0 && numerrors == 0)
+	exit(run(result, argc - running, argv + running));
+
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,453 @@
+/*
+ * File:	placer.cpp
+ *
+ * Description:	This file contains the function definitions for the
+ *		elimination of partial redundancies in Simple C.
+ *
+ *		An expression computed just after an if statement is
+ *		partially redundant if it is also computed at the end of
+ *		one part of the if statement, since it is then computed
+ *		twice along that path.  We place a computation of the
+ *		expression into a new variable at the end of each part
+ *		that can complete normally but does not compute it, which
+ *		is the same as placing it on the edge from that part to the
+ *		statements that follow.  The computation at the end of the
+ *		other part is also stored in the variable, and the
+ *		expression after the if statement simply uses it.  Every
+ *		path then computes the expression exactly once.
+ *
+ *		The value numbering pass already reuses expressions along
+ *		paths where the earlier one dominates the later one, such
+ *		as the tests of an if-else chain, so only the joins of if
+ *		statements are considered here.  A placement is only made
+ *		when the expression is computed at the end of at least one
+ *		part, so no path ever computes more than before.
+ *
+ *		Only the statements without calls, increments, or
+ *		decrements are considered, since an expression may then be
+ *		moved to the start of its statement without changing its
+ *		value.  An expression is not moved past an assignment that
+ *		might change its value, taking into account whether a store
+ *		through a pointer might change the object that it loads.
+ */
+
+# include <typeinfo>
+# include "optimizer.h"
+
+using namespace std;
+
+static Function *function;
+static SymbolSet locals;
+static unsigned eliminated, placed;
+
+
+/* Where an expression is computed at the end of a part of an if statement */
+
+struct Occurrence {
+    Statement **part;
+    unsigned index;
+    Expression **slot;
+    bool completes;
+};
+
+
+/*
+ * Function:	pure (private)
+ *
+ * Description:	Return whether the expressions of the given statement are
+ *		without any calls, increments, or decrements.
+ */
+
+static bool pure(Statement *stmt)
+{
+    vector<Expression **> exprs;
+    Expression *expr;
+
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr)
+	expressions(expr, exprs);
+    else
+	expressions(stmt, exprs);
+
+    for (auto slot : exprs)
+	if (dynamic_cast<Call *>(*slot) != nullptr ||
+		dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr)
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	simple (private)
+ *
+ * Description:	Return whether the given statement is a pure assignment or
+ *		expression statement.
+ */
+
+static bool simple(Statement *stmt)
+{
+    if (dynamic_cast<Expression *>(stmt) == nullptr &&
+	    dynamic_cast<Assignment *>(stmt) == nullptr)
+	return false;
+
+    return pure(stmt);
+}
+
+
+/*
+ * Function:	candidate (private)
+ *
+ * Description:	Return whether the given expression may be placed.  Only
+ *		integer and pointer arithmetic, comparisons, and loads are
+ *		considered, as in value numbering.
+ */
+
+static bool candidate(Expression *expr)
+{
+    vector<Expression **> slots;
+    const type_info &id = typeid(*expr);
+
+
+    if (expr->type().isReal() || expr->type().size() != 4)
+	return false;
+
+    if (id != typeid(Add) && id != typeid(Subtract) &&
+	    id != typeid(Multiply) && id != typeid(Divide) &&
+	    id != typeid(Remainder) && id != typeid(LessThan) &&
+	    id != typeid(GreaterThan) && id != typeid(LessOrEqual) &&
+	    id != typeid(GreaterOrEqual) && id != typeid(Equal) &&
+	    id != typeid(NotEqual) && id != typeid(Not) &&
+	    id != typeid(Negate) && id != typeid(Dereference))
+	return false;
+
+    expressions(expr, slots);
+
+    for (auto slot : slots)
+	if (dynamic_cast<Real *>(*slot) != nullptr ||
+		dynamic_cast<String *>(*slot) != nullptr)
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	computed (private)
+ *
+ * Description:	Append the slots of the given expression and those of its
+ *		subexpressions that are always computed to the list,
+ *		parents first.  The right operand of a logical operator is
+ *		computed conditionally, and the operand of an address
+ *		expression is not computed at all.
+ */
+
+static void computed(Expression *&expr, vector<Expression **> &slots)
+{
+    vector<Expression **> operands;
+    Expression *operand;
+
+
+    slots.push_back(&expr);
+
+    if (dynamic_cast<LogicalAnd *>(expr) != nullptr ||
+	    dynamic_cast<LogicalOr *>(expr) != nullptr)
+	computed(((Binary *) expr)->left(), slots);
+
+    else if (dynamic_cast<Address *>(expr) != nullptr) {
+	operand = ((Unary *) expr)->expr();
+
+	if (dynamic_cast<Dereference *>(operand) != nullptr)
+	    computed(((Unary *) operand)->expr(), slots);
+
+    } else {
+	children(expr, operands);
+
+	for (auto slot : operands)
+	    computed(*slot, slots);
+    }
+}
+
+
+/*
+ * Function:	computed (private)
+ *
+ * Description:	Append the slots of the expressions always computed by the
+ *		given statement before it stores anything to the list.  An
+ *		expression statement computes nothing worth keeping.
+ */
+
+static void computed(Statement *stmt, vector<Expression **> &slots)
+{
+    Assignment *assign;
+    Return *ret;
+    If *cond;
+    Switch *branch;
+
+
+    if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	computed(assign->right(), slots);
+
+	if (dynamic_cast<Dereference *>(assign->left()) != nullptr)
+	    computed(((Unary *) assign->left())->expr(), slots);
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr)
+	computed(ret->expr(), slots);
+
+    else if ((cond = dynamic_cast<If *>(stmt)) != nullptr)
+	computed(cond->expr(), slots);
+
+    else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr)
+	computed(branch->expr(), slots);
+}
+
+
+/*
+ * Function:	kills (private)
+ *
+ * Description:	Return whether the given simple statement might change the
+ *		value of the given expression.
+ */
+
+static bool kills(Statement *stmt, Expression *expr)
+{
+    Assignment *assign = dynamic_cast<Assignment *>(stmt);
+    return assign != nullptr && clobbers(assign->left(), expr, locals);
+}
+
+
+/*
+ * Function:	find (private)
+ *
+ * Description:	Find where the given expression is computed at the end of
+ *		the given part of an if statement, if anywhere.
+ */
+
+static void find(Statement *&part, Expression *expr, Occurrence &found)
+{
+    vector<Expression **> slots;
+    Block *block;
+    Statement **stmt;
+    unsigned count;
+
+
+    found.part = &part;
+    found.slot = nullptr;
+    found.completes = part != nullptr && completes(part);
+
+    if (!found.completes)
+	return;
+
+    block = dynamic_cast<Block *>(part);
+    count = block != nullptr ? block->statements().size() : 1;
+
+    for (unsigned i = count; i > 0; i --) {
+	stmt = block != nullptr ? &block->statements()[i - 1] : &part;
+
+	if (!simple(*stmt) || kills(*stmt, expr))
+	    return;
+
+	slots.clear();
+	computed(*stmt, slots);
+
+	for (auto slot : slots)
+	    if (equal(*slot, expr)) {
+		found.index = i - 1;
+		found.slot = slot;
+		return;
+	    }
+    }
+}
+
+
+/*
+ * Function:	append (private)
+ *
+ * Description:	Append the given statement to the given part of an if
+ *		statement.
+ */
+
+static void append(Statement *&part, Statement *stmt)
+{
+    Block *block;
+
+
+    if (part == nullptr)
+	part = new Block(new Scope(), Statements());
+
+    if ((block = dynamic_cast<Block *>(part)) == nullptr) {
+	block = new Block(new Scope(), Statements({part}));
+	part = block;
+    }
+
+    block->statements().push_back(stmt);
+}
+
+
+/*
+ * Function:	capture (private)
+ *
+ * Description:	Store the expression computed at the given occurrence into
+ *		the given variable just before its statement, and use the
+ *		variable in its place.
+ */
+
+static void capture(const Occurrence &found, const Symbol *symbol)
+{
+    Statement *&part = *found.part;
+    Statement *assign;
+    Block *block;
+
+
+    assign = new Assignment(new Identifier(symbol), *found.slot);
+    *found.slot = new Identifier(symbol);
+
+    if ((block = dynamic_cast<Block *>(part)) != nullptr) {
+	Statements &stmts = block->statements();
+	stmts.insert(stmts.begin() + found.index, assign);
+    } else
+	part = new Block(new Scope(), Statements({assign, part}));
+}
+
+
+/*
+ * Function:	place (private)
+ *
+ * Description:	Place the given expression, which is computed after the
+ *		given if statement, at the end of each part of it that can
+ *		complete normally, and return the variable holding its
+ *		value, or a null pointer if the expression is not partially
+ *		redundant.
+ */
+
+static Symbol *place(If *cond, Expression *expr)
+{
+    Occurrence parts[2];
+    Symbol *symbol;
+
+
+    find(cond->thenStmt(), expr, parts[0]);
+    find(cond->elseStmt(), expr, parts[1]);
+
+    if (cond->elseStmt() == nullptr)
+	parts[1].completes = true;
+
+    if (parts[0].slot == nullptr && parts[1].slot == nullptr)
+	return nullptr;
+
+    symbol = declare(function, "pre", expr->type());
+
+    for (auto &found : parts)
+	if (found.slot != nullptr) {
+	    capture(found, symbol);
+	    eliminated ++;
+
+	} else if (found.completes) {
+	    append(*found.part, new Assignment(new Identifier(symbol),
+		expr->clone()));
+	    placed ++;
+	}
+
+    return symbol;
+}
+
+
+/*
+ * Function:	visit (private)
+ *
+ * Description:	Eliminate the partial redundancies after each if statement
+ *		within the given block.  The statements after an if
+ *		statement are scanned up to and including the first one
+ *		that is not simple, and an expression computed by one of
+ *		them is placed if no earlier one changes its value.  The
+ *		test of a loop is computed more than once, so the scan
+ *		stops before a loop.
+ */
+
+static void visit(Block *block)
+{
+    Statements &stmts = block->statements();
+    vector<Expression **> slots;
+    Statement *stmt;
+    Symbol *symbol;
+    If *cond;
+    bool changed, killed;
+
+
+    for (unsigned i = 0; i < stmts.size(); i ++) {
+	if ((cond = dynamic_cast<If *>(stmts[i])) == nullptr)
+	    continue;
+
+	if (!completes(cond))
+	    continue;
+
+	for (unsigned k = i + 1; k < stmts.size(); k ++) {
+	    stmt = stmts[k];
+
+	    if (!pure(stmt) || dynamic_cast<While *>(stmt) != nullptr ||
+		    dynamic_cast<For *>(stmt) != nullptr ||
+		    dynamic_cast<Block *>(stmt) != nullptr)
+		break;
+
+	    do {
+		changed = false;
+		slots.clear();
+		computed(stmt, slots);
+
+		for (auto slot : slots) {
+		    if (!candidate(*slot))
+			continue;
+
+		    killed = false;
+
+		    for (unsigned j = i + 1; j < k; j ++)
+			killed = killed || kills(stmts[j], *slot);
+
+		    if (!killed && (symbol = place(cond, *slot)) != nullptr) {
+			*slot = new Identifier(symbol);
+			changed = true;
+			break;
+		    }
+		}
+	    } while (changed);
+
+	    if (!simple(stmt))
+		break;
+	}
+    }
+}
+
+
+/*
+ * Function:	placeExpressions
+ *
+ * Description:	Eliminate the partial redundancies within the given
+ *		function.
+ */
+
+void placeExpressions(Function *fn)
+{
+    vector<Statement **> slots;
+    vector<Block *> blocks;
+    Statement *body;
+    Block *block;
+
+
+    function = fn;
+    locals = analyze(function).privates;
+    eliminated = placed = 0;
+
+    body = function->body();
+    statements(body, slots);
+
+    for (auto slot : slots)
+	if ((block = dynamic_cast<Block *>(*slot)) != nullptr)
+	    blocks.push_back(block);
+
+    for (auto block : blocks)
+	visit(block);
+
+    count("partially redundant expressions eliminated", eliminated);
+    count("expressions placed on edges", placed);
+}
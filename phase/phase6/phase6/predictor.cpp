@@ -0,0 +1,164 @@
+/*
+ * File:	predictor.cpp
+ *
+ * Description:	This file contains the function definitions for static
+ *		branch prediction in Simple C.
+ *
+ *		Without a profile, the generator still wants to know which
+ *		part of an if statement is more likely, so that it can be
+ *		reached by falling through and an unlikely part can be
+ *		moved out of the way.  We use the heuristics of Ball and
+ *		Larus, each of which predicts a branch with a probability
+ *		found by measuring many programs:
+ *
+ *		pointer - a pointer is unlikely to be null, and two
+ *		pointers are unlikely to be equal;
+ *
+ *		opcode - an integer is unlikely to be negative, to be zero
+ *		or negative, or to equal a constant;
+ *
+ *		return - a part that returns, as when checking for an error
+ *		or a base case, is unlikely to be executed.
+ *
+ *		When more than one heuristic applies, their probabilities
+ *		are combined as evidence, following Wu and Larus.  Loops
+ *		need no prediction, since the generator always lays them
+ *		out so that the branch back to the top is taken.
+ */
+
+# include "optimizer.h"
+
+using namespace std;
+
+static const double POINTER = 0.60;
+static const double OPCODE = 0.84;
+static const double RETURN = 0.72;
+
+
+/*
+ * Function:	combine (private)
+ *
+ * Description:	Combine the two given probabilities that a branch is taken,
+ *		from independent heuristics, into a single probability.
+ */
+
+static double combine(double p, double q)
+{
+    return p * q / (p * q + (1 - p) * (1 - q));
+}
+
+
+/*
+ * Function:	pointer (private)
+ *
+ * Description:	Return the probability that the given test is true
+ *		according to the pointer heuristic.
+ */
+
+static double pointer(Expression *expr)
+{
+    Binary *binary;
+    Not *negation;
+
+
+    if (expr->type().isPointer())
+	return POINTER;
+
+    if ((negation = dynamic_cast<Not *>(expr)) != nullptr)
+	if (negation->expr()->type().isPointer())
+	    return 1 - POINTER;
+
+    if ((binary = dynamic_cast<Binary *>(expr)) != nullptr)
+	if (binary->left()->type().isPointer()) {
+	    if (dynamic_cast<Equal *>(expr) != nullptr)
+		return 1 - POINTER;
+
+	    if (dynamic_cast<NotEqual *>(expr) != nullptr)
+		return POINTER;
+	}
+
+    return 0.5;
+}
+
+
+/*
+ * Function:	opcode (private)
+ *
+ * Description:	Return the probability that the given test is true
+ *		according to the opcode heuristic.
+ */
+
+static double opcode(Expression *expr)
+{
+    Binary *binary;
+    int value;
+
+
+    if ((binary = dynamic_cast<Binary *>(expr)) == nullptr)
+	return 0.5;
+
+    if (!binary->left()->type().isInteger())
+	return 0.5;
+
+    if (!isConstant(binary->right(), value))
+	return 0.5;
+
+    if (dynamic_cast<Equal *>(expr) != nullptr)
+	return 1 - OPCODE;
+
+    if (dynamic_cast<NotEqual *>(expr) != nullptr)
+	return OPCODE;
+
+    if (value != 0)
+	return 0.5;
+
+    if (dynamic_cast<LessThan *>(expr) != nullptr ||
+	    dynamic_cast<LessOrEqual *>(expr) != nullptr)
+	return 1 - OPCODE;
+
+    if (dynamic_cast<GreaterThan *>(expr) != nullptr ||
+	    dynamic_cast<GreaterOrEqual *>(expr) != nullptr)
+	return OPCODE;
+
+    return 0.5;
+}
+
+
+/*
+ * Function:	returns (private)
+ *
+ * Description:	Return whether the given statement always leaves the
+ *		function.
+ */
+
+static bool returns(Statement *stmt)
+{
+    return stmt != nullptr && !completes(stmt) && !breaks(stmt);
+}
+
+
+/*
+ * Function:	predict
+ *
+ * Description:	Return the probability that the then part of the given if
+ *		statement is executed, or one half if nothing is known.
+ */
+
+double predict(If *stmt)
+{
+    double p;
+    bool left, right;
+
+
+    p = combine(pointer(strip(stmt->expr())), opcode(strip(stmt->expr())));
+
+    left = returns(stmt->thenStmt());
+    right = returns(stmt->elseStmt());
+
+    if (left && !right)
+	p = combine(p, 1 - RETURN);
+    else if (right && !left)
+	p = combine(p, RETURN);
+
+    return p;
+}
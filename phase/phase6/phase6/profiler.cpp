@@ -0,0 +1,187 @@
+/*
+ * File:	profiler.cpp
+ *
+ * Description:	This file contains the function definitions for
+ *		profile-guided optimization in Simple C.
+ *
+ *		Before any pass changes a function, each if statement,
+ *		loop, and call within it is given a counter, numbered in
+ *		the order in which they appear in the translation unit.  An
+ *		if statement has two counters, for its then and else parts,
+ *		and a loop has two, for entering the loop and for each
+ *		iteration of its body.  Since the numbering depends only on
+ *		the source, a later compilation finds the same counters.
+ *
+ *		In an instrumented build, the generator increments the
+ *		counters as the program runs and writes them to the profile
+ *		file when it exits.  Inlining, unrolling, and vectorization
+ *		are not done, so that the counts match the source.  When
+ *		compiling with a profile, the counts guide the layout of if
+ *		statements and whether calls are inlined and loops unrolled.
+ *
+ *		The profile is simply the number of counters followed by
+ *		the counts, all as 32-bit words.
+ */
+
+# include <fstream>
+# include <iostream>
+# include "optimizer.h"
+
+using namespace std;
+
+string profileOutput;
+
+static const unsigned HOT_RATIO = 10;
+
+static vector<unsigned> profile;
+static string profilePath;
+static unsigned maximum;
+static unsigned numbered;
+
+
+/*
+ * Function:	readProfile
+ *
+ * Description:	Read the counts from the given profile file.  A missing or
+ *		malformed profile is reported but is otherwise ignored, so
+ *		the program is compiled as if there were none.  The number
+ *		of counts must agree with the size of the file.
+ */
+
+void readProfile(const string &path)
+{
+    ifstream file(path.c_str(), ios::binary);
+    unsigned length;
+    streamoff size;
+
+
+    profile.clear();
+    profilePath = path;
+    maximum = 0;
+
+    if (!file.read((char *) &length, sizeof(length))) {
+	cerr << "cannot read profile " << path << endl;
+	return;
+    }
+
+    file.seekg(0, ios::end);
+    size = file.tellg();
+    file.seekg(sizeof(length));
+
+    if (size < 0 || (size - sizeof(length)) / sizeof(unsigned) != length) {
+	cerr << "profile " << path << " is malformed" << endl;
+	return;
+    }
+
+    profile.resize(length);
+
+    if (!file.read((char *) profile.data(), length * sizeof(unsigned))) {
+	cerr << "profile " << path << " is truncated" << endl;
+	profile.clear();
+	return;
+    }
+
+    for (auto count : profile)
+	maximum = max(maximum, count);
+}
+
+
+/*
+ * Function:	matchProfile
+ *
+ * Description:	Check that the profile has a count for each counter given
+ *		out, and otherwise ignore it with a warning, since it must
+ *		have been written by a different program.
+ */
+
+void matchProfile()
+{
+    if (profile.empty() || profile.size() == numbered)
+	return;
+
+    cerr << "warning: profile " << profilePath;
+    cerr << " does not match the program and is ignored" << endl;
+    profile.clear();
+    maximum = 0;
+}
+
+
+/*
+ * Function:	profiled
+ *
+ * Description:	Return whether the profile has a count for the given
+ *		counter of the given statement, and if so, the count.  The
+ *		counter is zero or one for an if statement or loop.
+ */
+
+bool profiled(const Statement *stmt, unsigned which, unsigned &count)
+{
+    if (stmt->counter < 0 || stmt->counter + which >= profile.size())
+	return false;
+
+    count = profile[stmt->counter + which];
+    return true;
+}
+
+
+/*
+ * Function:	hot
+ *
+ * Description:	Return whether the given count is within a small factor of
+ *		the largest count in the profile.
+ */
+
+bool hot(unsigned count)
+{
+    return count > 0 && count * HOT_RATIO >= maximum;
+}
+
+
+/*
+ * Function:	counters
+ *
+ * Description:	Return the number of counters given out so far.
+ */
+
+unsigned counters()
+{
+    return numbered;
+}
+
+
+/*
+ * Function:	numberCounters
+ *
+ * Description:	Give counters to the if statements, loops, and calls within
+ *		the given function.
+ */
+
+void numberCounters(Function *function)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    Statement *body;
+
+
+    body = function->body();
+    statements(body, stmts);
+
+    for (auto slot : stmts) {
+	if (dynamic_cast<If *>(*slot) != nullptr ||
+		dynamic_cast<While *>(*slot) != nullptr ||
+		dynamic_cast<For *>(*slot) != nullptr) {
+	    (*slot)->counter = numbered;
+	    numbered += 2;
+	}
+
+	exprs.clear();
+	expressions(*slot, exprs);
+
+	if (dynamic_cast<Call *>(*slot) != nullptr)
+	    (*slot)->counter = numbered ++;
+
+	for (auto expr : exprs)
+	    if (dynamic_cast<Call *>(*expr) != nullptr)
+		(*expr)->counter = numbered ++;
+    }
+}
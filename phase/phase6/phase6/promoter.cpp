@@ -0,0 +1,177 @@
+/*
+ * File:	promoter.cpp
+ *
+ * Description:	This file contains the function definitions for promoting
+ *		local variables to registers in Simple C.
+ *
+ *		A local integer or pointer variable whose address is never
+ *		taken can only be read or written by name, so it may live
+ *		in a register for its entire lifetime instead of in our
+ *		frame.  The callee-saved registers are used, since their
+ *		values survive any calls we make, and the generator saves
+ *		and restores those that we use.  The caller-saved registers
+ *		are left alone, since the generator needs them as scratch.
+ *
+ *		There are fewer registers than variables, so each candidate
+ *		is weighted by the number of references to it, with each
+ *		reference within a loop counting several times for each
+ *		loop around it.  Loop counters and accumulators thus come
+ *		first.  A variable with too few references is not worth the
+ *		cost of saving and restoring its register.
+ */
+
+# include <algorithm>
+# include "generator.h"
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+static const char *registers[] = {"%ebx", "%esi", "%edi", "%ebp"};
+
+static const unsigned LOOP_WEIGHT = 8;
+static const unsigned MAXIMUM_DEPTH = 4;
+static const unsigned MINIMUM_WEIGHT = 3;
+
+static SymbolSet candidates;
+static map<const Symbol *, unsigned> weights;
+
+
+/*
+ * Function:	weigh (private)
+ *
+ * Description:	Add the weight of each reference to a candidate within the
+ *		given expression, which is nested within the given number
+ *		of loops.
+ */
+
+static void weigh(Expression *expr, unsigned depth)
+{
+    vector<Expression **> slots;
+    unsigned weight;
+
+
+    weight = 1;
+
+    for (unsigned i = 0; i < min(depth, MAXIMUM_DEPTH); i ++)
+	weight *= LOOP_WEIGHT;
+
+    expressions(expr, slots);
+
+    for (auto slot : slots)
+	if (candidates.count(identifier(*slot)) > 0)
+	    weights[identifier(*slot)] += weight;
+}
+
+
+/*
+ * Function:	weigh (private)
+ *
+ * Description:	Add the weight of each reference to a candidate within the
+ *		given statement, which is nested within the given number
+ *		of loops.
+ */
+
+static void weigh(Statement *stmt, unsigned depth)
+{
+    Expression *expr;
+    Assignment *assign;
+    Return *ret;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+
+
+    if ((expr = dynamic_cast<Expression *>(stmt)) != nullptr)
+	weigh(expr, depth);
+
+    else if ((assign = dynamic_cast<Assignment *>(stmt)) != nullptr) {
+	weigh(assign->left(), depth);
+	weigh(assign->right(), depth);
+
+    } else if ((ret = dynamic_cast<Return *>(stmt)) != nullptr)
+	weigh(ret->expr(), depth);
+
+    else if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    weigh(child, depth);
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr) {
+	weigh(loop->expr(), depth + 1);
+	weigh(loop->stmt(), depth + 1);
+
+    } else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	weigh(iter->init(), depth);
+	weigh(iter->expr(), depth + 1);
+	weigh(iter->incr(), depth + 1);
+	weigh(iter->stmt(), depth + 1);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	weigh(cond->expr(), depth);
+	weigh(cond->thenStmt(), depth);
+
+	if (cond->elseStmt() != nullptr)
+	    weigh(cond->elseStmt(), depth);
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	weigh(branch->expr(), depth);
+
+	for (auto &section : branch->cases())
+	    weigh(section.stmt, depth);
+    }
+}
+
+
+/*
+ * Function:	promoteVariables
+ *
+ * Description:	Assign registers to the most heavily used local variables
+ *		of the given function whose address is never taken.  The
+ *		frame pointer is also available if it is omitted.
+ */
+
+void promoteVariables(Function *function)
+{
+    vector<pair<unsigned, const Symbol *>> ranked;
+    unsigned available, promoted;
+
+
+    candidates.clear();
+    weights.clear();
+
+    for (auto symbol : analyze(function).privates) {
+	const Type &type = symbol->type();
+
+	if (type.isScalar() && (type.isPointer() || type == Type(INT)))
+	    candidates.insert(symbol);
+    }
+
+    weigh(function->body(), 0);
+
+    for (auto &weight : weights)
+	if (weight.second >= MINIMUM_WEIGHT)
+	    ranked.push_back(make_pair(weight.second, weight.first));
+
+    stable_sort(ranked.begin(), ranked.end(),
+	[](const pair<unsigned, const Symbol *> &a,
+	   const pair<unsigned, const Symbol *> &b) {
+	    if (a.first != b.first)
+		return a.first > b.first;
+
+	    return a.second->name() < b.second->name();
+	});
+
+    available = sizeof(registers) / sizeof(*registers);
+
+    if (!scheduled("omit-frame-pointer", function->id()->name()))
+	available --;
+
+    promoted = min((unsigned) ranked.size(), available);
+
+    for (unsigned i = 0; i < promoted; i ++)
+	((Symbol *) ranked[i].second)->reg = registers[i];
+
+    count("variables promoted to registers", promoted);
+}
@@ -0,0 +1,600 @@
+/*
+ * File:	propagator.cpp
+ *
+ * Description:	This file contains the function definitions for the
+ *		interprocedural analyses in Simple C, which look at all of
+ *		the functions of the translation unit together before any
+ *		of them is optimized.  The calls between them are found
+ *		from the call expressions in their bodies.
+ *
+ *		The integer arguments of a call that are constants form its
+ *		context, considering only those parameters that the callee
+ *		never assigns and whose address it never takes.  Calls to
+ *		the same function with the same context share a clone of the
+ *		function in which those parameters are replaced with their
+ *		values and removed from the parameter list.  The original
+ *		function remains for calls from other translation units.
+ *		Only the most common few contexts of a function are cloned,
+ *		and large functions are not cloned at all.
+ *
+ *		A function is read-only if it has no side effects, meaning
+ *		that it stores only to its own local variables and calls
+ *		only read-only functions, and it is pure if it also reads
+ *		only its own local variables and const variables and calls
+ *		only pure functions.  Nothing is assumed about a function
+ *		defined elsewhere.  The summaries start out optimistic and
+ *		are weakened until they agree, so that recursive functions
+ *		may also be pure.
+ *
+ *		Finally, once every function has been optimized, a function
+ *		with internal linkage that is no longer called, perhaps
+ *		because every call to it was inlined or redirected to a
+ *		clone, is discarded.
+ */
+
+# include <algorithm>
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+typedef vector<pair<unsigned, int>> Context;
+
+
+/* A call site, which is either a statement or part of an expression */
+
+struct Site {
+    Call *call;
+    Statement **stmt;
+    Expression **expr;
+};
+
+
+/* The effects of a function on memory */
+
+struct Summary {
+    bool reads, writes;
+};
+
+static const unsigned CLONE_LIMIT = 4;
+static const unsigned CLONE_SIZE = 200;
+
+static map<const Symbol *, Function *> defined;
+static map<const Symbol *, vector<bool>> candidates;
+static map<const Symbol *, map<Context, Function *>> clones;
+static map<const Symbol *, Summary> summaries;
+
+
+/*
+ * Function:	size (private)
+ *
+ * Description:	Return the number of statements and expressions within the
+ *		given statement.
+ */
+
+static unsigned size(Statement *stmt)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+
+
+    statements(stmt, stmts);
+
+    for (auto slot : stmts)
+	expressions(*slot, exprs);
+
+    return stmts.size() + exprs.size();
+}
+
+
+/*
+ * Function:	sites (private)
+ *
+ * Description:	Append the call sites within the given function to the
+ *		list.
+ */
+
+static void sites(Function *function, vector<Site> &list)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    Statement *body;
+
+
+    body = function->body();
+    statements(body, stmts);
+
+    for (auto slot : stmts) {
+	if (dynamic_cast<Call *>(*slot) != nullptr)
+	    list.push_back({(Call *) *slot, slot, nullptr});
+
+	exprs.clear();
+	expressions(*slot, exprs);
+
+	for (auto expr : exprs)
+	    if (dynamic_cast<Call *>(*expr) != nullptr)
+		list.push_back({(Call *) *expr, nullptr, expr});
+    }
+}
+
+
+/*
+ * Function:	parameters (private)
+ *
+ * Description:	Return which parameters of the given function are integers
+ *		that are never assigned and whose address is never taken,
+ *		so that they may be replaced by constants.
+ */
+
+static const vector<bool> &parameters(Function *function)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    SymbolSet locals, assigned;
+    const Symbol *symbol;
+    Statement *body;
+    unsigned count;
+
+
+    if (candidates.count(function->id()) > 0)
+	return candidates[function->id()];
+
+    body = function->body();
+    privates(body, locals);
+    statements(body, stmts);
+
+    for (auto slot : stmts) {
+	if (dynamic_cast<Assignment *>(*slot) != nullptr)
+	    assigned.insert(identifier(((Assignment *) *slot)->left()));
+	else if (dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr)
+	    assigned.insert(identifier(((Unary *) *slot)->expr()));
+
+	expressions(*slot, exprs);
+    }
+
+    for (auto slot : exprs)
+	if (dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr)
+	    assigned.insert(identifier(((Unary *) *slot)->expr()));
+
+    vector<bool> &result = candidates[function->id()];
+    count = function->id()->type().parameters()->types.size();
+
+    for (unsigned i = 0; i < count; i ++) {
+	symbol = function->body()->declarations()->symbols()[i];
+	result.push_back(symbol->type() == Type(INT) &&
+		locals.count(symbol) > 0 && assigned.count(symbol) == 0);
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	context (private)
+ *
+ * Description:	Return the context of the given call to the given
+ *		function: the positions and values of its constant
+ *		arguments that may be propagated into the function.
+ */
+
+static Context context(Call *call, Function *function)
+{
+    const vector<bool> &params = parameters(function);
+    Context result;
+    int value;
+
+
+    if (call->args().size() != params.size())
+	return result;
+
+    for (unsigned i = 0; i < params.size(); i ++)
+	if (params[i] && isConstant(call->args()[i], value))
+	    result.push_back(make_pair(i, value));
+
+    return result;
+}
+
+
+/*
+ * Function:	specialize (private)
+ *
+ * Description:	Create a copy of the given function for the given context,
+ *		in which the constant parameters are replaced by their
+ *		values and removed.  Every variable of the copy is a new
+ *		symbol, since its storage is allocated separately.
+ */
+
+static Function *specialize(Function *function, const Context &context,
+	unsigned number)
+{
+    const Type &type = function->id()->type();
+    const Symbols &symbols = function->body()->declarations()->symbols();
+    vector<Statement **> stmts;
+    Parameters *params;
+    Renaming renamed;
+    Statement *body;
+    Function *clone;
+    Symbol *id;
+    unsigned count;
+    vector<bool> dropped;
+
+
+    count = type.parameters()->types.size();
+    dropped.assign(count, false);
+
+    for (auto &arg : context)
+	dropped[arg.first] = true;
+
+    params = new Parameters();
+    params->variadic = false;
+
+    for (unsigned i = 0; i < count; i ++)
+	if (!dropped[i])
+	    params->types.push_back(type.parameters()->types[i]);
+
+    id = new Symbol(function->id()->name() + ".constprop." +
+	    to_string(number),
+	    Type(type.specifier(), type.indirection(), params));
+
+    id->internal = true;
+    clone = new Function(id, new Block(new Scope(), Statements()));
+
+
+    /* Declare the remaining parameters first, and then the locals. */
+
+    for (unsigned i = 0; i < count; i ++)
+	if (!dropped[i])
+	    renamed[symbols[i]] = declare(clone, symbols[i]->name(),
+		    symbols[i]->type());
+
+    body = function->body()->clone();
+    statements(body, stmts);
+
+    for (auto slot : stmts)
+	if (dynamic_cast<Block *>(*slot) != nullptr)
+	    for (auto symbol : ((Block *) *slot)->declarations()->symbols())
+		if (renamed.count(symbol) == 0)
+		    renamed[symbol] = declare(clone, symbol->name(),
+			    symbol->type());
+
+    for (auto &arg : context)
+	substitute(body, symbols[arg.first], arg.second);
+
+    rename(body, renamed);
+    clone->body()->statements() = ((Block *) body)->statements();
+    return clone;
+}
+
+
+/*
+ * Function:	redirect (private)
+ *
+ * Description:	Replace each call within the given function that has a
+ *		clone for its context with a call to the clone.
+ */
+
+static void redirect(Function *function)
+{
+    vector<Site> list;
+    Expressions args;
+    Context found;
+    Function *clone;
+    Call *call;
+    unsigned next;
+
+
+    sites(function, list);
+
+    for (auto &site : list) {
+	if (clones.count(site.call->id()) == 0)
+	    continue;
+
+	found = context(site.call, defined[site.call->id()]);
+
+	if (clones[site.call->id()].count(found) == 0)
+	    continue;
+
+	clone = clones[site.call->id()][found];
+	args.clear();
+	next = 0;
+
+	for (unsigned i = 0; i < site.call->args().size(); i ++)
+	    if (next < found.size() && found[next].first == i)
+		next ++;
+	    else
+		args.push_back(site.call->args()[i]);
+
+	call = new Call(clone->id(), args, site.call->type());
+	call->counter = site.call->counter;
+
+	if (site.stmt != nullptr)
+	    *site.stmt = call;
+	else
+	    *site.expr = call;
+    }
+}
+
+
+/*
+ * Function:	propagateConstants
+ *
+ * Description:	Clone the functions in the given list for the most common
+ *		contexts of the calls to them, adding each clone after its
+ *		original, and redirect the calls to the clones.
+ */
+
+void propagateConstants(vector<Function *> &functions)
+{
+    map<const Symbol *, map<Context, unsigned>> uses;
+    vector<pair<unsigned, Context>> ranked;
+    vector<Function *> result;
+    vector<Site> list;
+    Context found;
+    Function *clone;
+    unsigned cloned;
+
+
+    defined.clear();
+    candidates.clear();
+    clones.clear();
+
+    for (auto function : functions)
+	defined[function->id()] = function;
+
+    for (auto function : functions) {
+	list.clear();
+	sites(function, list);
+
+	for (auto &site : list)
+	    if (defined.count(site.call->id()) > 0) {
+		found = context(site.call, defined[site.call->id()]);
+
+		if (!found.empty())
+		    uses[site.call->id()][found] ++;
+	    }
+    }
+
+
+    /* Clone each function for its most common contexts. */
+
+    cloned = 0;
+
+    for (auto function : functions) {
+	result.push_back(function);
+
+	if (uses.count(function->id()) == 0)
+	    continue;
+
+	if (size(function->body()) > CLONE_SIZE)
+	    continue;
+
+	ranked.clear();
+
+	for (auto &entry : uses[function->id()])
+	    ranked.push_back(make_pair(entry.second, entry.first));
+
+	stable_sort(ranked.begin(), ranked.end(),
+	    [](const pair<unsigned, Context> &a,
+	       const pair<unsigned, Context> &b) {
+		return a.first > b.first;
+	    });
+
+	for (unsigned i = 0; i < ranked.size() && i < CLONE_LIMIT; i ++) {
+	    clone = specialize(function, ranked[i].second, i);
+	    clones[function->id()][ranked[i].second] = clone;
+	    result.push_back(clone);
+	    cloned ++;
+	}
+    }
+
+    functions = result;
+
+    for (auto function : functions)
+	redirect(function);
+
+    count("functions cloned for constant arguments", cloned);
+}
+
+
+/*
+ * Function:	summary (private)
+ *
+ * Description:	Return the summary of the given function given the current
+ *		summaries of the functions that it calls.
+ */
+
+static Summary summary(Function *function)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+    SymbolSet locals;
+    Summary result;
+    Expression *target;
+    const Symbol *callee;
+    Statement *body;
+
+
+    result.reads = result.writes = false;
+    body = function->body();
+    declarations(body, locals);
+    statements(body, stmts);
+
+    for (auto slot : stmts) {
+	target = nullptr;
+
+	if (dynamic_cast<Assignment *>(*slot) != nullptr)
+	    target = ((Assignment *) *slot)->left();
+
+	if (target != nullptr && locals.count(identifier(target)) == 0)
+	    result.writes = true;
+
+	expressions(*slot, exprs);
+    }
+
+    for (auto slot : exprs) {
+	if (dynamic_cast<Increment *>(*slot) != nullptr ||
+		dynamic_cast<Decrement *>(*slot) != nullptr) {
+	    target = ((Unary *) *slot)->expr();
+
+	    if (locals.count(identifier(target)) == 0)
+		result.writes = true;
+	}
+
+	if (dynamic_cast<Dereference *>(*slot) != nullptr)
+	    result.reads = true;
+
+	else if (identifier(*slot) != nullptr) {
+	    if (locals.count(identifier(*slot)) == 0)
+		if (!identifier(*slot)->type().isConst())
+		    result.reads = true;
+
+	} else if (dynamic_cast<Call *>(*slot) != nullptr) {
+	    callee = ((Call *) *slot)->id();
+
+	    if (summaries.count(callee) > 0) {
+		result.reads |= summaries[callee].reads;
+		result.writes |= summaries[callee].writes;
+	    } else
+		result.reads = result.writes = true;
+	}
+    }
+
+    for (auto slot : stmts)
+	if (dynamic_cast<Call *>(*slot) != nullptr) {
+	    callee = ((Call *) *slot)->id();
+
+	    if (summaries.count(callee) > 0) {
+		result.reads |= summaries[callee].reads;
+		result.writes |= summaries[callee].writes;
+	    } else
+		result.reads = result.writes = true;
+	}
+
+    return result;
+}
+
+
+/*
+ * Function:	summarizeFunctions
+ *
+ * Description:	Compute the summaries of the functions in the given list.
+ */
+
+void summarizeFunctions(const vector<Function *> &functions)
+{
+    Summary current;
+    unsigned pure, readonly;
+    bool changed;
+
+
+    summaries.clear();
+
+    for (auto function : functions)
+	summaries[function->id()] = {false, false};
+
+    do {
+	changed = false;
+
+	for (auto function : functions) {
+	    current = summary(function);
+	    Summary &prior = summaries[function->id()];
+
+	    if (current.reads != prior.reads ||
+		    current.writes != prior.writes) {
+		prior = current;
+		changed = true;
+	    }
+	}
+    } while (changed);
+
+    pure = readonly = 0;
+
+    for (auto &entry : summaries)
+	if (!entry.second.writes) {
+	    readonly ++;
+
+	    if (!entry.second.reads)
+		pure ++;
+	}
+
+    count("functions found to be read-only", readonly);
+    count("functions found to be pure", pure);
+}
+
+
+/*
+ * Function:	isPure
+ *
+ * Description:	Return whether the given function is pure.
+ */
+
+bool isPure(const Symbol *function)
+{
+    if (summaries.count(function) == 0)
+	return false;
+
+    return !summaries[function].reads && !summaries[function].writes;
+}
+
+
+/*
+ * Function:	isReadOnly
+ *
+ * Description:	Return whether the given function is read-only.
+ */
+
+bool isReadOnly(const Symbol *function)
+{
+    return summaries.count(function) > 0 && !summaries[function].writes;
+}
+
+
+/*
+ * Function:	discardFunctions
+ *
+ * Description:	Remove the functions with internal linkage from the given
+ *		list that cannot be reached by calls from the functions
+ *		visible to other translation units.
+ */
+
+void discardFunctions(vector<Function *> &functions)
+{
+    vector<Function *> pending, result;
+    set<const Symbol *> reached;
+    vector<Site> list;
+    Function *function;
+
+
+    defined.clear();
+
+    for (auto function : functions) {
+	defined[function->id()] = function;
+
+	if (!function->id()->internal) {
+	    reached.insert(function->id());
+	    pending.push_back(function);
+	}
+    }
+
+    while (!pending.empty()) {
+	function = pending.back();
+	pending.pop_back();
+
+	list.clear();
+	sites(function, list);
+
+	for (auto &site : list)
+	    if (defined.count(site.call->id()) > 0)
+		if (reached.insert(site.call->id()).second)
+		    pending.push_back(defined[site.call->id()]);
+    }
+
+    for (auto function : functions)
+	if (reached.count(function->id()) > 0)
+	    result.push_back(function);
+
+    count("unused functions discarded", functions.size() - result.size());
+    functions = result;
+}
@@ -0,0 +1,495 @@
+/*
+ * File:	reducer.cpp
+ *
+ * Description:	This file contains the function definitions for strength
+ *		reduction of induction variables in loops.
+ *
+ *		An induction variable is a local integer variable whose
+ *		only definitions within a loop add a constant to it, such
+ *		as "i ++" or "i = i + 2".  Indexing an array with it, as
+ *		in "a[i]", computes "a + i * scale" on every iteration.  If
+ *		"a" does not change within the loop, we instead keep a
+ *		pointer equal to "a + i * scale", initialize it before the
+ *		loop, and add "c * scale" to it wherever the loop adds "c"
+ *		to the induction variable.
+ *
+ *		If the induction variable is not live after the loop and
+ *		its only other use is the loop test, then the test is
+ *		rewritten to compare the pointer against a pointer computed
+ *		before the loop (linear function test replacement), and the
+ *		induction variable is removed from the loop altogether.
+ */
+
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+static Function *function;
+static SymbolSet locals;
+static Liveness live;
+
+
+/* A definition of an induction variable that adds a constant step */
+
+struct Update {
+    Statement **slot;
+    int step;
+};
+
+
+/* A pointer derived from an induction variable: base + i * scale */
+
+struct Derived {
+    Expression *base;
+    Type type;
+    unsigned scale;
+    Symbol *symbol;
+};
+
+
+/*
+ * Function:	references (private)
+ *
+ * Description:	Return the number of references to the given symbol
+ *		within the given expressions.
+ */
+
+static unsigned references(const vector<Expression **> &exprs,
+	const Symbol *symbol)
+{
+    unsigned count = 0;
+
+
+    for (auto slot : exprs)
+	if (identifier(*slot) == symbol)
+	    count ++;
+
+    return count;
+}
+
+
+/*
+ * Function:	derived (private)
+ *
+ * Description:	Return whether the given expression computes "base + i *
+ *		scale" for the given induction variable, and if so, the
+ *		base and the scale.
+ */
+
+static bool derived(Expression *expr, const Symbol *symbol, const Loop &loop,
+	Expression *&base, unsigned &scale)
+{
+    Add *add;
+
+
+    if ((add = dynamic_cast<Add *>(expr)) == nullptr)
+	return false;
+
+    if (add->scaleRight > 0 && identifier(add->right()) == symbol) {
+	base = add->left();
+	scale = add->scaleRight;
+
+    } else if (add->scaleLeft > 0 && identifier(add->left()) == symbol) {
+	base = add->right();
+	scale = add->scaleLeft;
+
+    } else
+	return false;
+
+    return invariant(base, loop, locals);
+}
+
+
+/*
+ * Function:	pointer (private)
+ *
+ * Description:	Create a new local variable of the given pointer type.
+ */
+
+static Symbol *pointer(const Symbol *symbol, const Type &type)
+{
+    return declare(function, symbol->name(), type);
+}
+
+
+/*
+ * Function:	increment (private)
+ *
+ * Description:	Create a statement that adds the given step, in bytes, to
+ *		the given pointer.
+ */
+
+static Statement *increment(Symbol *symbol, int step)
+{
+    Increment *incr;
+    Decrement *decr;
+
+
+    if (step >= 0) {
+	incr = new Increment(new Identifier(symbol), symbol->type());
+	incr->scale = step;
+	return incr;
+    }
+
+    decr = new Decrement(new Identifier(symbol), symbol->type());
+    decr->scale = -step;
+    return decr;
+}
+
+
+/*
+ * Function:	point (private)
+ *
+ * Description:	Create the expression "base + index * scale".
+ */
+
+static Expression *point(Expression *base, Expression *index,
+	const Type &type, unsigned scale)
+{
+    Add *add;
+
+
+    add = new Add(base, index, type);
+    add->scaleLeft = 0;
+    add->scaleRight = scale;
+    return add;
+}
+
+
+/*
+ * Function:	replaceTest (private)
+ *
+ * Description:	Attempt to rewrite a test of the form "i op n" or "n op
+ *		i", where "n" is invariant, to compare a derived pointer
+ *		against "base + n * scale" instead.  The end pointer is
+ *		computed before the loop by the returned statement.
+ *
+ *		If the loop can be left early, it need not reach "n", and
+ *		"base + n * scale" may then lie far beyond anything the
+ *		loop touches and wrap around, so the test is left alone.
+ */
+
+static Statement *replaceTest(Expression *&test, const Symbol *symbol,
+	const Loop &loop, const Derived &ptr, bool early)
+{
+    Binary *binary;
+    Expression **bound, **index;
+    Symbol *end;
+    Statement *init;
+
+
+    if (dynamic_cast<LessThan *>(test) == nullptr &&
+	    dynamic_cast<GreaterThan *>(test) == nullptr &&
+	    dynamic_cast<LessOrEqual *>(test) == nullptr &&
+	    dynamic_cast<GreaterOrEqual *>(test) == nullptr &&
+	    dynamic_cast<NotEqual *>(test) == nullptr)
+	return nullptr;
+
+    if (early)
+	return nullptr;
+
+    binary = (Binary *) test;
+
+    if (identifier(binary->left()) == symbol) {
+	index = &binary->left();
+	bound = &binary->right();
+    } else if (identifier(binary->right()) == symbol) {
+	index = &binary->right();
+	bound = &binary->left();
+    } else
+	return nullptr;
+
+    if (!(*bound)->type().isInteger() || !invariant(*bound, loop, locals))
+	return nullptr;
+
+    end = pointer(symbol, ptr.type);
+    init = new Assignment(new Identifier(end),
+	    point(ptr.base, *bound, ptr.type, ptr.scale));
+
+    *index = new Identifier(ptr.symbol);
+    *bound = new Identifier(end);
+    return init;
+}
+
+
+/*
+ * Function:	leaves (private)
+ *
+ * Description:	Return whether the given loop can be left other than by
+ *		its test, through a break or return statement.
+ */
+
+static bool leaves(Statement *stmt, const Loop &loop)
+{
+    For *forStmt;
+
+
+    for (auto slot : loop.stmts)
+	if (dynamic_cast<Return *>(*slot) != nullptr)
+	    return true;
+
+    if ((forStmt = dynamic_cast<For *>(stmt)) != nullptr)
+	return breaks(forStmt->stmt());
+
+    return breaks(((While *) stmt)->stmt());
+}
+
+
+/*
+ * Function:	simple (private)
+ *
+ * Description:	Return whether the given expression may be evaluated
+ *		more than once in place of the variable it was assigned to,
+ *		which is true of a literal or variable.
+ */
+
+static bool simple(Expression *expr)
+{
+    return dynamic_cast<Integer *>(expr) != nullptr ||
+	identifier(expr) != nullptr;
+}
+
+
+/*
+ * Function:	reduceLoop (private)
+ *
+ * Description:	Reduce the strength of the array references within the
+ *		given loop for one induction variable, and remove that
+ *		variable if it becomes useless.  Any statements that must
+ *		be executed before the loop are added to the list.  Return
+ *		whether the loop was changed.
+ */
+
+static bool reduceLoop(Statement *stmt, Statements &inits)
+{
+    Loop loop, after;
+    vector<Update> updates;
+    vector<Derived> ptrs;
+    vector<Expression **> exprs;
+    Statements stmts;
+    Expression *base, *start;
+    Statement *test;
+    For *forStmt;
+    Assignment *assign;
+    unsigned scale, count, i;
+    const Symbol *symbol;
+    bool found;
+    int step;
+
+
+    if (!summarize(stmt, loop))
+	return false;
+
+    forStmt = dynamic_cast<For *>(stmt);
+    symbol = nullptr;
+
+    for (auto candidate : loop.defs) {
+	if (locals.count(candidate) == 0)
+	    continue;
+
+	if (candidate->type() != Type(INT))
+	    continue;
+
+
+	/* Every definition must add a constant to the variable. */
+
+	updates.clear();
+
+	for (auto slot : loop.stmts)
+	    if (update(*slot, candidate, step))
+		updates.push_back({slot, step});
+
+	if (updates.empty() || updates.size() != definitions(loop, candidate))
+	    continue;
+
+
+	/* Find the derived pointers and replace their computations. */
+
+	for (auto slot : loop.exprs) {
+	    if (!derived(*slot, candidate, loop, base, scale))
+		continue;
+
+	    found = false;
+
+	    for (i = 0; i < ptrs.size() && !found; i ++)
+		if (ptrs[i].scale == scale && equal(ptrs[i].base, base))
+		    found = true;
+
+	    if (!found) {
+		ptrs.push_back({base, (*slot)->type(), scale, nullptr});
+		ptrs.back().symbol = pointer(candidate, (*slot)->type());
+		i = ptrs.size();
+	    }
+
+	    *slot = new Identifier(ptrs[i - 1].symbol);
+	}
+
+	if (!ptrs.empty()) {
+	    symbol = candidate;
+	    break;
+	}
+    }
+
+    if (symbol == nullptr)
+	return false;
+
+
+    /* If the variable is now only used by the test, remove it. */
+
+    start = nullptr;
+    test = nullptr;
+
+    if (live[stmt].count(symbol) == 0) {
+	summarize(stmt, after);
+	count = 0;
+
+	for (auto &update : updates) {
+	    exprs.clear();
+	    expressions(*update.slot, exprs);
+	    count += references(exprs, symbol);
+	}
+
+	if (references(after.exprs, symbol) == count + 1)
+	    test = replaceTest(*loop.test, symbol, loop, ptrs[0],
+		leaves(stmt, loop));
+
+	if (test != nullptr && forStmt != nullptr) {
+	    assign = dynamic_cast<Assignment *>(forStmt->init());
+
+	    if (assign != nullptr && identifier(assign->left()) == symbol &&
+		    simple(assign->right())) {
+		start = assign->right();
+		forStmt->init() = new Block(new Scope(), Statements());
+	    }
+	}
+    }
+
+
+    /* Initialize the pointers before the loop. */
+
+    for (auto &ptr : ptrs) {
+	base = start != nullptr ? start->clone() : new Identifier(symbol);
+	base = point(ptr.base->clone(), base, ptr.type, ptr.scale);
+	inits.push_back(new Assignment(new Identifier(ptr.symbol), base));
+    }
+
+    if (test != nullptr)
+	inits.push_back(test);
+
+
+    /* Advance the pointers along with the variable. */
+
+    for (auto &update : updates) {
+	stmts.clear();
+
+	if (test == nullptr)
+	    stmts.push_back(*update.slot);
+
+	for (auto &ptr : ptrs)
+	    stmts.push_back(increment(ptr.symbol, update.step * ptr.scale));
+
+	*update.slot = new Block(new Scope(), stmts);
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	reduceLoops (private)
+ *
+ * Description:	Reduce the strength of the given loop for as many
+ *		induction variables as possible, and place any statements
+ *		needed before the loop.  A loop that will be vectorized is
+ *		left alone.
+ */
+
+static void reduceLoops(Statement *&stmt)
+{
+    Statements inits;
+    For *forStmt;
+    Simd plan;
+
+
+    if (enabled("tree-vectorize") && vectorizable(stmt, locals, plan))
+	return;
+
+    while (reduceLoop(stmt, inits))
+	continue;
+
+    if (inits.empty())
+	return;
+
+    if ((forStmt = dynamic_cast<For *>(stmt)) != nullptr) {
+	inits.insert(inits.begin(), forStmt->init());
+	forStmt->init() = new Block(new Scope(), inits);
+    } else {
+	inits.push_back(stmt);
+	stmt = new Block(new Scope(), inits);
+    }
+}
+
+
+/*
+ * Function:	reduce (private)
+ *
+ * Description:	Reduce the strength of all loops within the given
+ *		statement, innermost loops first.
+ */
+
+static void reduce(Statement *&stmt)
+{
+    Block *block;
+    While *whileStmt;
+    For *forStmt;
+    If *ifStmt;
+    Switch *switchStmt;
+
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto &child : block->statements())
+	    reduce(child);
+
+    } else if ((whileStmt = dynamic_cast<While *>(stmt)) != nullptr) {
+	reduce(whileStmt->stmt());
+	reduceLoops(stmt);
+
+    } else if ((forStmt = dynamic_cast<For *>(stmt)) != nullptr) {
+	reduce(forStmt->stmt());
+	reduceLoops(stmt);
+
+    } else if ((ifStmt = dynamic_cast<If *>(stmt)) != nullptr) {
+	reduce(ifStmt->thenStmt());
+
+	if (ifStmt->elseStmt() != nullptr)
+	    reduce(ifStmt->elseStmt());
+
+    } else if ((switchStmt = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : switchStmt->cases())
+	    reduce(section.stmt);
+    }
+}
+
+
+/*
+ * Function:	reduceStrength
+ *
+ * Description:	Reduce the strength of the array references in all loops
+ *		of the given function.
+ */
+
+void reduceStrength(Function *fn)
+{
+    Statement *body;
+
+
+    function = fn;
+    body = function->body();
+
+    locals = analyze(function).privates;
+    live.clear();
+
+    liveness(body, SymbolSet(), live);
+    reduce(body);
+}
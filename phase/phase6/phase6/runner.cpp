@@ -0,0 +1,208 @@
+/*
+ * File:	runner.cpp
+ *
+ * Description:	This file contains the function definitions for running a
+ *		Simple C program in memory, without writing an object or
+ *		running the linker.
+ *
+ *		The sections of the object assembled from the program are
+ *		copied into memory obtained with mmap, each starting on a
+ *		page of its own, followed by the storage for the common
+ *		symbols.  The relocations are then applied, with any symbol
+ *		that the program does not define, such as printf, being
+ *		looked up in the running process with dlsym.  Finally, the
+ *		code is made executable and the read-only data read-only
+ *		with mprotect, and main is called directly.  The functions
+ *		in the finalization section, such as the one that writes
+ *		the profile of an instrumented build, are called when main
+ *		returns, as exit would.
+ *
+ *		The generator only writes i386 code, so a program can only
+ *		be run this way if the compiler itself is built for the
+ *		i386.  On any other host, the program can only be
+ *		interpreted with --interpret.
+ */
+
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include <dlfcn.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include "assembler.h"
+
+using namespace std;
+
+
+/*
+ * Function:	roundup (private)
+ *
+ * Description:	Return the given size rounded up to the given alignment.
+ */
+
+static size_t roundup(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+
+/*
+ * Function:	resolve (private)
+ *
+ * Description:	Return the address of the given symbol that is not defined
+ *		in any section of the program.
+ */
+
+static char *resolve(const string &name, map<string, char *> &commons)
+{
+    void *address;
+
+
+    if (commons.count(name) > 0)
+	return commons[name];
+
+    if ((address = dlsym(RTLD_DEFAULT, name.c_str())) == nullptr) {
+	cerr << "undefined symbol " << name << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    return (char *) address;
+}
+
+
+/*
+ * Function:	load
+ *
+ * Description:	Load the given object into memory, leaving the address of
+ *		each of its sections in the given vector.
+ */
+
+void load(const Object &object, vector<char *> &addresses)
+{
+    map<string, char *> commons;
+    size_t page, size, offset;
+    unsigned field, target;
+    char *memory, *place;
+    int protection;
+
+
+    /* Lay out the sections and then the common symbols. */
+
+    page = sysconf(_SC_PAGESIZE);
+    size = 0;
+
+    for (auto &section : object.sections)
+	size += roundup(section.bytes.size(), page);
+
+    for (auto &entry : object.symbols)
+	if (entry.second.section < 0)
+	    size = roundup(size, entry.second.align) + entry.second.value;
+
+    memory = (char *) mmap(nullptr, max(size, page), PROT_READ | PROT_WRITE,
+	MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory == (char *) MAP_FAILED) {
+	cerr << "cannot allocate memory for program" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    addresses.clear();
+    offset = 0;
+
+    for (auto &section : object.sections) {
+	addresses.push_back(memory + offset);
+	memcpy(memory + offset, section.bytes.data(), section.bytes.size());
+	offset += roundup(section.bytes.size(), page);
+    }
+
+    for (auto &entry : object.symbols)
+	if (entry.second.section < 0) {
+	    offset = roundup(offset, entry.second.align);
+	    commons[entry.first] = memory + offset;
+	    offset += entry.second.value;
+	}
+
+
+    /* Apply the relocations, whose addends are already in place. */
+
+    for (unsigned i = 0; i < object.sections.size(); i ++)
+	for (auto &relocation : object.sections[i].relocations) {
+	    place = addresses[i] + relocation.offset;
+	    memcpy(&field, place, sizeof(field));
+
+	    if (relocation.section >= 0)
+		target = (size_t) addresses[relocation.section];
+	    else
+		target = (size_t) resolve(relocation.symbol, commons);
+
+	    field += target - (relocation.relative ? (size_t) place : 0);
+	    memcpy(place, &field, sizeof(field));
+	}
+
+
+    /* Finally, protect the code and read-only data. */
+
+    for (unsigned i = 0; i < object.sections.size(); i ++) {
+	const Section &section = object.sections[i];
+
+	if (section.bytes.empty() || section.flags & SECTION_WRITE)
+	    continue;
+
+	protection = PROT_READ;
+
+	if (section.flags & SECTION_EXEC)
+	    protection |= PROT_EXEC;
+
+	if (mprotect(addresses[i], section.bytes.size(), protection) != 0) {
+	    cerr << "cannot protect section " << section.name << endl;
+	    exit(EXIT_FAILURE);
+	}
+    }
+}
+
+
+/*
+ * Function:	run
+ *
+ * Description:	Load the given object and call its main function with the
+ *		given arguments, followed by its finalization functions,
+ *		and return the status returned by main.
+ */
+
+int run(const Object &object, int argc, char *argv[])
+{
+# if defined(__i386__)
+
+    vector<char *> addresses;
+    int status;
+    unsigned word;
+
+
+    if (object.symbols.count("main") == 0 ||
+	    object.symbols.at("main").section < 0) {
+	cerr << "no main function" << endl;
+	return EXIT_FAILURE;
+    }
+
+    load(object, addresses);
+
+    const Definition &entry = object.symbols.at("main");
+    status = ((int (*)(int, char **))
+	(addresses[entry.section] + entry.value))(argc, argv);
+
+    for (unsigned i = 0; i < object.sections.size(); i ++)
+	if (object.sections[i].name == ".fini_array")
+	    for (unsigned j = 0; j < object.sections[i].bytes.size(); j += 4) {
+		memcpy(&word, addresses[i] + j, sizeof(word));
+		((void (*)()) word)();
+	    }
+
+    return status;
+
+# else
+
+    cerr << "cannot run i386 code on this host" << endl;
+    return EXIT_FAILURE;
+
+# endif
+}
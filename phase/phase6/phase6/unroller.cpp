@@ -0,0 +1,366 @@
+/*
+ * File:	unroller.cpp
+ *
+ * Description:	This file contains the function definitions for unrolling
+ *		counted loops in Simple C.
+ *
+ *		A counted loop is a for statement of the form "for (i = a;
+ *		i < n; i = i + c) s", where "i" is a local integer variable
+ *		whose address is never taken, "c" is a constant, "n" is
+ *		invariant, and "s" neither assigns "i" nor breaks out of
+ *		the loop.  The test may also be "<=", or ">" or ">=" when
+ *		"c" is negative.
+ *
+ *		If "a" and "n" are both constants and the loop is small
+ *		enough, it is fully unrolled into a copy of its body for
+ *		each iteration, with "i" replaced by its value.  Otherwise,
+ *		an innermost loop is unrolled by the given factor "k" into
+ *		a loop whose test checks that "k" more iterations remain,
+ *		followed by a remainder loop for the last few iterations.
+ *		The remainder loop is omitted when the trip count is known
+ *		to be a multiple of "k".  So that the check cannot
+ *		overflow, it compares "i" against "n - (k - 1) * c", and
+ *		the unrolled loop is skipped if that would overflow.
+ *
+ *		If there is a profile, a loop whose body was never executed
+ *		is left alone, and a hot loop may have a larger body.
+ */
+
+# include <climits>
+# include <typeinfo>
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+unsigned unrollFactor = 4;
+
+static const unsigned FULL_SIZE = 64;
+static const unsigned BODY_SIZE = 40;
+static const unsigned HOT_FACTOR = 2;
+
+static SymbolSet locals;
+static unsigned unrolled, flattened;
+
+
+/* The shape of a counted loop */
+
+struct Counted {
+    const Symbol *symbol;
+    Binary *test;
+    int step;
+    bool known;
+    long long trips;
+};
+
+
+/*
+ * Function:	size (private)
+ *
+ * Description:	Return the number of statements and expressions within the
+ *		given statement, and whether it contains any loops.
+ */
+
+static unsigned size(Statement *stmt, bool &loops)
+{
+    vector<Statement **> stmts;
+    vector<Expression **> exprs;
+
+
+    loops = false;
+    statements(stmt, stmts);
+
+    for (auto slot : stmts) {
+	if (dynamic_cast<While *>(*slot) || dynamic_cast<For *>(*slot))
+	    loops = true;
+
+	expressions(*slot, exprs);
+    }
+
+    return stmts.size() + exprs.size();
+}
+
+
+/*
+ * Function:	counted (private)
+ *
+ * Description:	Return whether the given loop is a counted loop, and if so,
+ *		its shape.  If the initial value and the bound are both
+ *		constants, the number of iterations is computed as well.
+ */
+
+static bool counted(For *loop, Counted &shape)
+{
+    Loop summary;
+    Assignment *init;
+    Expression *bound;
+    const type_info *id;
+    long long start, end, step;
+    int value;
+
+
+    if ((init = dynamic_cast<Assignment *>(loop->init())) == nullptr)
+	return false;
+
+    shape.symbol = identifier(init->left());
+
+    if (locals.count(shape.symbol) == 0)
+	return false;
+
+    if (shape.symbol->type() != Type(INT))
+	return false;
+
+    if (!update(loop->incr(), shape.symbol, shape.step) || shape.step == 0)
+	return false;
+
+
+    /* The test must compare the variable against an invariant bound. */
+
+    shape.test = dynamic_cast<Binary *>(loop->expr());
+
+    if (shape.test == nullptr || identifier(shape.test->left()) != shape.symbol)
+	return false;
+
+    id = &typeid(*shape.test);
+
+    if (*id == typeid(LessThan) || *id == typeid(LessOrEqual)) {
+	if (shape.step < 0)
+	    return false;
+
+    } else if (*id == typeid(GreaterThan) || *id == typeid(GreaterOrEqual)) {
+	if (shape.step > 0)
+	    return false;
+
+    } else
+	return false;
+
+    bound = shape.test->right();
+    summarize(loop, summary);
+
+    if (!bound->type().isInteger() || !invariant(bound, summary, locals))
+	return false;
+
+    if (definitions(summary, shape.symbol) != 1 || breaks(loop->stmt()))
+	return false;
+
+
+    /* Compute the number of iterations if we can. */
+
+    shape.known = isConstant(init->right(), value);
+    start = value;
+    shape.known = shape.known && isConstant(bound, value);
+    end = value;
+
+    if (!shape.known)
+	return true;
+
+    step = shape.step;
+
+    if (*id == typeid(LessOrEqual))
+	end ++;
+    else if (*id == typeid(GreaterOrEqual))
+	end --;
+
+    if (step > 0)
+	shape.trips = start < end ? (end - start + step - 1) / step : 0;
+    else
+	shape.trips = start > end ? (start - end - step - 1) / -step : 0;
+
+    return true;
+}
+
+
+/*
+ * Function:	flatten (private)
+ *
+ * Description:	Replace the given counted loop with a copy of its body for
+ *		each iteration, followed by the final assignment to the
+ *		variable, which is removed later if it is not needed.
+ */
+
+static Statement *flatten(For *loop, const Counted &shape)
+{
+    Statements stmts;
+    Statement *body;
+    int value;
+
+
+    stmts.push_back(loop->init());
+    isConstant(((Assignment *) loop->init())->right(), value);
+
+    for (long long i = 0; i < shape.trips; i ++) {
+	body = loop->stmt()->clone();
+	substitute(body, shape.symbol, value);
+	stmts.push_back(body);
+	value += shape.step;
+    }
+
+    stmts.push_back(new Assignment(new Identifier(shape.symbol),
+	literal(value)));
+
+    return new Block(new Scope(), stmts);
+}
+
+
+/*
+ * Function:	unroll (private)
+ *
+ * Description:	Unroll the given counted loop by the given factor, adding
+ *		a remainder loop if necessary.  The bound of the unrolled
+ *		loop is reduced by the distance that it looks ahead, which
+ *		is guarded to not overflow unless the bound is a constant.
+ */
+
+static Statement *unroll(For *loop, const Counted &shape, unsigned factor)
+{
+    Statements stmts, body;
+    Expression *bound, *guard;
+    Binary *test;
+    Statement *rest, *main;
+    long long ahead, limit;
+    int value;
+
+
+    for (unsigned i = 0; i < factor; i ++) {
+	if (i > 0)
+	    body.push_back(loop->incr()->clone());
+
+	body.push_back(loop->stmt()->clone());
+    }
+
+    if (shape.known && shape.trips % factor == 0) {
+	loop->stmt() = new Block(new Scope(), body);
+	return loop;
+    }
+
+    ahead = (long long) (factor - 1) * shape.step;
+    limit = ahead > 0 ? INT_MIN + ahead : INT_MAX + ahead;
+    bound = shape.test->right();
+    guard = nullptr;
+
+    if (isConstant(bound, value)) {
+	if (ahead > 0 ? value < limit : value > limit)
+	    return loop;
+
+	bound = literal(value - ahead);
+
+    } else {
+	if (ahead > 0)
+	    guard = new GreaterOrEqual(bound->clone(), literal(limit),
+		Type(INT));
+	else
+	    guard = new LessOrEqual(bound->clone(), literal(limit),
+		Type(INT));
+
+	bound = new Subtract(bound->clone(), literal(ahead), Type(INT));
+    }
+
+    test = (Binary *) shape.test->clone();
+    test->right() = bound;
+
+    rest = new For(new Block(new Scope(), Statements()), shape.test,
+	    loop->incr()->clone(), loop->stmt());
+
+    main = new For(new Block(new Scope(), Statements()), test, loop->incr(),
+	    new Block(new Scope(), body));
+
+    stmts.push_back(loop->init());
+    stmts.push_back(guard != nullptr ? new If(guard, main, nullptr) : main);
+    stmts.push_back(rest);
+    return new Block(new Scope(), stmts);
+}
+
+
+/*
+ * Function:	visit (private)
+ *
+ * Description:	Unroll the counted loops within the given statement,
+ *		innermost loops first.
+ */
+
+static void visit(Statement *&stmt)
+{
+    Counted shape;
+    Simd plan;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+    unsigned body, limit, count;
+    bool loops;
+
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto &child : block->statements())
+	    visit(child);
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr)
+	visit(loop->stmt());
+
+    else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	visit(cond->thenStmt());
+
+	if (cond->elseStmt() != nullptr)
+	    visit(cond->elseStmt());
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : branch->cases())
+	    visit(section.stmt);
+
+    } else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	visit(iter->stmt());
+
+	if (!counted(iter, shape))
+	    return;
+
+	if (enabled("tree-vectorize") && vectorizable(iter, locals, plan))
+	    return;
+
+	limit = BODY_SIZE;
+
+	if (profiled(iter, 1, count)) {
+	    if (count == 0)
+		return;
+
+	    if (hot(count))
+		limit *= HOT_FACTOR;
+	}
+
+	body = size(iter->incr(), loops);
+	body += size(iter->stmt(), loops);
+
+	if (shape.known && shape.trips * body <= FULL_SIZE) {
+	    stmt = flatten(iter, shape);
+	    flattened ++;
+
+	} else if (unrollFactor > 1 && !loops && body <= limit) {
+	    if (!shape.known || shape.trips >= unrollFactor) {
+		stmt = unroll(iter, shape, unrollFactor);
+		unrolled ++;
+	    }
+	}
+    }
+}
+
+
+/*
+ * Function:	unrollLoops
+ *
+ * Description:	Unroll the counted loops within the given function.
+ */
+
+void unrollLoops(Function *function)
+{
+    Statement *body;
+
+
+    locals = analyze(function).privates;
+    unrolled = flattened = 0;
+
+    body = function->body();
+    visit(body);
+
+    count("loops unrolled", unrolled);
+    count("loops fully unrolled", flattened);
+}
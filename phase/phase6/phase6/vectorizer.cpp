@@ -0,0 +1,518 @@
+/*
+ * File:	vectorizer.cpp
+ *
+ * Description:	This file contains the function definitions for
+ *		vectorizing simple loops in Simple C using SSE2.
+ *
+ *		A loop can be vectorized if its test is "i < n" or "i <= n",
+ *		where "i" is a local integer variable whose address is never
+ *		taken and that is incremented by one at the end of each
+ *		iteration, and "n" is invariant, and if the rest of its body
+ *		is a sequence of assignments of the form "p[i] = e" or
+ *		"s = s + e".  The elements must be all integers or all
+ *		doubles, and "e" may add and subtract elements "q[i]",
+ *		invariant values, and "i" itself.  Doubles may also be
+ *		multiplied and divided, but integers cannot, since SSE2 has
+ *		no instruction to do so.  A sum "s" must be a local integer
+ *		variable not otherwise used in the loop, since adding
+ *		doubles in a different order may change the result.
+ *
+ *		A vector holds four integers or two doubles, and the
+ *		generator executes that many iterations at once for as long
+ *		as it can, leaving the rest to the original loop.  A pointer
+ *		"p" may be loaded from memory, as in "a[i][j]", and still be
+ *		invariant if no store in the loop may change it, as is
+ *		always the case when the loop stores only integers and
+ *		doubles.  However, two pointers may refer to the same
+ *		array, so the generator first checks that the pointers
+ *		stored through are either equal to or at least a vector
+ *		apart from every other pointer, and otherwise executes only
+ *		the original loop.
+ */
+
+# include <algorithm>
+# include <typeinfo>
+# include "machine.h"
+# include "optimizer.h"
+# include "tokens.h"
+
+using namespace std;
+
+static const SymbolSet *locals;
+static Loop summary;
+static Expressions stores, loads;
+static unsigned vectorized;
+
+
+/*
+ * Function:	fixed (private)
+ *
+ * Description:	Return whether the given pointer has the same value on
+ *		every iteration of the loop.  Unlike an invariant, it may be
+ *		loaded from memory, as long as no store in the loop may
+ *		change it.  The load is then done before the loop, which is
+ *		safe since the loop is known to execute.
+ */
+
+static bool fixed(Expression *expr)
+{
+    const Symbol *symbol;
+    Binary *binary;
+
+
+    expr = strip(expr);
+
+    if (invariant(expr, summary, *locals))
+	return true;
+
+    if ((symbol = identifier(expr)) != nullptr)
+	return expr->type().isPointer() && summary.defs.count(symbol) == 0;
+
+    if (dynamic_cast<Dereference *>(expr) != nullptr) {
+	for (auto target : summary.targets)
+	    if (aliases(target, expr, *locals))
+		return false;
+
+	return fixed(((Unary *) expr)->expr());
+    }
+
+    if (dynamic_cast<Add *>(expr) != nullptr ||
+	    dynamic_cast<Subtract *>(expr) != nullptr) {
+	binary = (Binary *) expr;
+
+	if (binary->type().isReal())
+	    return false;
+
+	return fixed(binary->left()) && fixed(binary->right());
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	hoist (private)
+ *
+ * Description:	Add the given expression to the list if it is not already
+ *		there.
+ */
+
+static void hoist(Expression *expr, Expressions &exprs)
+{
+    if (find(exprs.begin(), exprs.end(), expr) == exprs.end())
+	exprs.push_back(expr);
+}
+
+
+/*
+ * Function:	element (private)
+ *
+ * Description:	Return the pointer "p" if the given expression is an
+ *		element "p[i]" and "p" is fixed, and a null pointer
+ *		otherwise.
+ */
+
+static Expression *element(Expression *expr, const Simd &plan)
+{
+    Add *add;
+
+
+    expr = strip(expr);
+
+    if (dynamic_cast<Dereference *>(expr) == nullptr)
+	return nullptr;
+
+    if (expr->type() != plan.type)
+	return nullptr;
+
+    add = dynamic_cast<Add *>(strip(((Unary *) expr)->expr()));
+
+    if (add == nullptr || add->scaleRight != plan.type.size())
+	return nullptr;
+
+    if (identifier(add->right()) != plan.counter)
+	return nullptr;
+
+    if (!add->left()->type().isPointer() || !fixed(add->left()))
+	return nullptr;
+
+    return strip(add->left());
+}
+
+
+/*
+ * Function:	registers (private)
+ *
+ * Description:	Return the number of registers needed to compute the given
+ *		expression for a vector of elements, or zero if it cannot be
+ *		vectorized.  The invariant values are added to the plan,
+ *		and the pointers loaded through to the list.
+ */
+
+static unsigned registers(Expression *expr, Simd &plan)
+{
+    Expression *base;
+    Binary *binary;
+    unsigned left, right;
+
+
+    expr = strip(expr);
+
+    if (expr->type() != plan.type)
+	return 0;
+
+    if (identifier(expr) == plan.counter)
+	return 1;
+
+    if (invariant(expr, summary, *locals)) {
+	hoist(expr, plan.invariants);
+	return 1;
+    }
+
+    if ((base = element(expr, plan)) != nullptr) {
+	hoist(base, plan.invariants);
+	hoist(base, loads);
+	return 1;
+    }
+
+    if (dynamic_cast<Add *>(expr) == nullptr &&
+	    dynamic_cast<Subtract *>(expr) == nullptr) {
+	if (!plan.type.isReal())
+	    return 0;
+
+	if (dynamic_cast<Multiply *>(expr) == nullptr &&
+		dynamic_cast<Divide *>(expr) == nullptr)
+	    return 0;
+    }
+
+    binary = (Binary *) expr;
+    left = registers(binary->left(), plan);
+    right = registers(binary->right(), plan);
+
+    if (left == 0 || right == 0)
+	return 0;
+
+    return max(left, right + 1);
+}
+
+
+/*
+ * Function:	uses (private)
+ *
+ * Description:	Return the number of references to the given symbol
+ *		within the loop.
+ */
+
+static unsigned uses(const Symbol *symbol)
+{
+    unsigned count = 0;
+
+
+    for (auto slot : summary.exprs)
+	if (identifier(*slot) == symbol)
+	    count ++;
+
+    return count;
+}
+
+
+/*
+ * Function:	registers (private)
+ *
+ * Description:	Return the number of registers needed to execute the given
+ *		assignment for a vector of elements, or zero if it cannot be
+ *		vectorized.  The pointers stored through are added to the
+ *		list.
+ */
+
+static unsigned registers(Assignment *assign, Simd &plan)
+{
+    const Symbol *symbol;
+    Expression *base;
+    Binary *add;
+
+
+    if ((symbol = identifier(assign->left())) == nullptr) {
+	if ((base = element(assign->left(), plan)) == nullptr)
+	    return 0;
+
+	hoist(base, plan.invariants);
+	hoist(base, stores);
+	return registers(assign->right(), plan);
+    }
+
+    if (symbol == plan.counter || locals->count(symbol) == 0)
+	return 0;
+
+    if (symbol->type() != Type(INT) || plan.type != Type(INT))
+	return 0;
+
+    if ((add = dynamic_cast<Add *>(assign->right())) == nullptr)
+	return 0;
+
+    if (uses(symbol) != 2)
+	return 0;
+
+    if (identifier(add->left()) == symbol)
+	return registers(add->right(), plan);
+
+    if (identifier(add->right()) == symbol)
+	return registers(add->left(), plan);
+
+    return 0;
+}
+
+
+/*
+ * Function:	flatten (private)
+ *
+ * Description:	Append the statements of the given statement to the list,
+ *		flattening any blocks, and return whether they are all
+ *		simple statements.
+ */
+
+static bool flatten(Statement *stmt, Statements &stmts)
+{
+    Block *block;
+
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    if (!flatten(child, stmts))
+		return false;
+
+	return true;
+    }
+
+    if (dynamic_cast<Assignment *>(stmt) == nullptr &&
+	    dynamic_cast<Expression *>(stmt) == nullptr)
+	return false;
+
+    stmts.push_back(stmt);
+    return true;
+}
+
+
+/*
+ * Function:	disjoint (private)
+ *
+ * Description:	Return whether the given pointers are known to refer to
+ *		different arrays, which is the case if they are the
+ *		addresses of different variables.
+ */
+
+static bool disjoint(Expression *left, Expression *right)
+{
+    left = strip(left);
+    right = strip(right);
+
+    if (dynamic_cast<Address *>(left) == nullptr ||
+	    dynamic_cast<Address *>(right) == nullptr)
+	return false;
+
+    left = ((Unary *) left)->expr();
+    right = ((Unary *) right)->expr();
+
+    if (identifier(left) == nullptr || identifier(right) == nullptr)
+	return false;
+
+    return identifier(left) != identifier(right);
+}
+
+
+/*
+ * Function:	vectorizable
+ *
+ * Description:	Return whether the given loop can be vectorized, and if
+ *		so, the plan for doing so.  The set of local variables that
+ *		do not escape is given.
+ */
+
+bool vectorizable(Statement *stmt, const SymbolSet &privates, Simd &plan)
+{
+    Statements stmts;
+    Expression *test;
+    Assignment *assign;
+    unsigned needed, sums, used;
+    bool typed;
+    int step;
+
+
+    locals = &privates;
+    summary = Loop();
+    stores.clear();
+    loads.clear();
+
+    if (!summarize(stmt, summary) || summary.calls)
+	return false;
+
+
+    /* The loop must count up by one to an invariant bound. */
+
+    test = *summary.test;
+
+    if (typeid(*test) != typeid(LessThan) &&
+	    typeid(*test) != typeid(LessOrEqual))
+	return false;
+
+    plan.counter = identifier(((Binary *) test)->left());
+    plan.bound = ((Binary *) test)->right();
+    plan.inclusive = typeid(*test) == typeid(LessOrEqual);
+
+    if (locals->count(plan.counter) == 0)
+	return false;
+
+    if (plan.counter->type() != Type(INT) || plan.bound->type() != Type(INT))
+	return false;
+
+    if (!invariant(plan.bound, summary, *locals))
+	return false;
+
+    if (definitions(summary, plan.counter) != 1)
+	return false;
+
+    if (dynamic_cast<For *>(stmt) != nullptr) {
+	if (!update(((For *) stmt)->incr(), plan.counter, step) || step != 1)
+	    return false;
+
+	if (!flatten(((For *) stmt)->stmt(), stmts))
+	    return false;
+
+    } else {
+	if (!flatten(((While *) stmt)->stmt(), stmts) || stmts.empty())
+	    return false;
+
+	if (!update(stmts.back(), plan.counter, step) || step != 1)
+	    return false;
+
+	stmts.pop_back();
+    }
+
+
+    /* The elements must all have the same type. */
+
+    plan.type = Type(INT);
+    typed = false;
+
+    for (auto child : stmts) {
+	if ((assign = dynamic_cast<Assignment *>(child)) == nullptr)
+	    return false;
+
+	if (!typed && dynamic_cast<Dereference *>(assign->left()) != nullptr) {
+	    plan.type = assign->left()->type();
+	    typed = true;
+	}
+    }
+
+    if (plan.type != Type(INT) && plan.type != Type(DOUBLE))
+	return false;
+
+
+    /* Each assignment must be vectorizable with the registers we have. */
+
+    needed = sums = 0;
+
+    for (auto child : stmts) {
+	assign = (Assignment *) child;
+	used = registers(assign, plan);
+
+	if (used == 0)
+	    return false;
+
+	needed = max(needed, used);
+
+	if (identifier(assign->left()) != nullptr)
+	    sums ++;
+
+	plan.assigns.push_back(assign);
+    }
+
+    if (plan.assigns.empty() || needed + sums > VECTOR_REGISTERS)
+	return false;
+
+
+    /* Each pointer stored through must be checked against the others. */
+
+    for (unsigned i = 0; i < stores.size(); i ++) {
+	for (unsigned j = i + 1; j < stores.size(); j ++)
+	    if (!equal(stores[i], stores[j]) && !disjoint(stores[i], stores[j]))
+		plan.overlaps.push_back(make_pair(stores[i], stores[j]));
+
+	for (auto load : loads)
+	    if (!equal(stores[i], load) && !disjoint(stores[i], load))
+		plan.overlaps.push_back(make_pair(stores[i], load));
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	visit (private)
+ *
+ * Description:	Vectorize the loops within the given statement.
+ */
+
+static void visit(Statement *stmt, const SymbolSet &symbols)
+{
+    Simd *plan;
+    Block *block;
+    While *loop;
+    For *iter;
+    If *cond;
+    Switch *branch;
+
+
+    if ((block = dynamic_cast<Block *>(stmt)) != nullptr) {
+	for (auto child : block->statements())
+	    visit(child, symbols);
+
+    } else if ((cond = dynamic_cast<If *>(stmt)) != nullptr) {
+	visit(cond->thenStmt(), symbols);
+
+	if (cond->elseStmt() != nullptr)
+	    visit(cond->elseStmt(), symbols);
+
+    } else if ((branch = dynamic_cast<Switch *>(stmt)) != nullptr) {
+	for (auto &section : branch->cases())
+	    visit(section.stmt, symbols);
+
+    } else if ((loop = dynamic_cast<While *>(stmt)) != nullptr) {
+	plan = new Simd();
+
+	if (vectorizable(loop, symbols, *plan)) {
+	    loop->simd = plan;
+	    vectorized ++;
+	} else {
+	    delete plan;
+	    visit(loop->stmt(), symbols);
+	}
+
+    } else if ((iter = dynamic_cast<For *>(stmt)) != nullptr) {
+	plan = new Simd();
+
+	if (vectorizable(iter, symbols, *plan)) {
+	    iter->simd = plan;
+	    vectorized ++;
+	} else {
+	    delete plan;
+	    visit(iter->stmt(), symbols);
+	}
+    }
+}
+
+
+/*
+ * Function:	vectorizeLoops
+ *
+ * Description:	Vectorize the loops within the given function.  This must
+ *		be the last pass to change any loops, since the generator
+ *		follows the plan for each loop exactly.
+ */
+
+void vectorizeLoops(Function *function)
+{
+    vectorized = 0;
+    visit(function->body(), analyze(function).privates);
+    count("loops vectorized", vectorized);
+}
@@ -171,6 +171,11 @@ void LogicalOr::write(ostream &ostr) const
     ostr << "(|| " << _left << " " << _right << ")";
 }
 
+void Common::write(ostream &ostr) const
+{
+    ostr << _expr;
+}
+
 void Assignment::write(ostream &ostr) const
 {
     ostr << "(= " << _left << " " << _right << ")";
@@ -217,6 +222,22 @@ void If::write(ostream &ostr) const
     ostr << ")";
 }
 
+void Switch::write(ostream &ostr) const
+{
+    ostr << "(switch " << _expr;
+
+    for (auto &section : _cases) {
+	ostr << (section.isDefault ? " (default" : " (case");
+
+	for (auto value : section.values)
+	    ostr << " " << value;
+
+	ostr << " " << section.stmt << ")";
+    }
+
+    ostr << ")";
+}
+
 void Function::write(ostream &ostr) const
 {
     unsigned num = _id->type().parameters()->types.size();